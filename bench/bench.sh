@@ -23,6 +23,7 @@ STRATEGIES_DEFAULT=(rust)
 JOBS_DEFAULT=(rust)
 EXEC_DEFAULT=(linux)
 SORTED_DEFAULT=(chromium)
+DEEP_DEFAULT=(1024 4096)
 
 usage() {
     printf 'Usage: tailfin run %s\n' "${BASH_SOURCE[0]}"
@@ -65,6 +66,10 @@ usage() {
     printf '      Sorted traversal benchmark.\n'
     printf '      Default corpus is --sorted=%s\n\n' "${SORTED_DEFAULT[*]}"
 
+    printf '  --deep[=DEPTH]\n'
+    printf '      Deep tree benchmark with -L.\n'
+    printf '      Default depth is --deep="%s"\n\n' "${DEEP_DEFAULT[*]}"
+
     printf '  --build=COMMIT\n'
     printf '      Build this bfs commit and benchmark it.  Specify multiple times to\n'
     printf '      compare, e.g. --build=3.0.1 --build=3.0.2\n\n'
@@ -99,6 +104,21 @@ import_array() {
     eval "$cmd"
 }
 
+# Create a directory tree with a single deep path
+make-deep() {
+    # Stay under PATH_MAX by creating the path in chunks
+    local chunk=$(printf 'd/%.0s' {1..256})
+
+    as-user mkdir -p "$1"
+    (
+        cd "$1"
+        for ((i = 0; i < $2; i += 256)); do
+            as-user mkdir -p "$chunk"
+            cd "$chunk"
+        done
+    )
+}
+
 # Set up the benchmarks
 setup() {
     ROOT=$(realpath -- "$(dirname -- "${BASH_SOURCE[0]}")/..")
@@ -127,6 +147,7 @@ setup() {
     JOBS=()
     EXEC=()
     SORTED=()
+    DEEP=()
 
     for arg; do
         case "$arg" in
@@ -207,6 +228,12 @@ setup() {
             --sorted=*)
                 read -ra SORTED <<<"${arg#*=}"
                 ;;
+            --deep)
+                DEEP=("${DEEP_DEFAULT[@]}")
+                ;;
+            --deep=*)
+                read -ra DEEP <<<"${arg#*=}"
+                ;;
             --default)
                 COMPLETE=("${COMPLETE_DEFAULT[@]}")
                 EARLY_QUIT=("${EARLY_QUIT_DEFAULT[@]}")
@@ -216,6 +243,7 @@ setup() {
                 JOBS=("${JOBS_DEFAULT[@]}")
                 EXEC=("${EXEC_DEFAULT[@]}")
                 SORTED=("${SORTED_DEFAULT[@]}")
+                DEEP=("${DEEP_DEFAULT[@]}")
                 ;;
             --help)
                 usage
@@ -252,6 +280,14 @@ setup() {
         fi
     done
 
+    for depth in "${DEEP[@]}"; do
+        dir="bench/corpus/deep-$depth"
+        if ((CLEAN)) || ! [ -e "$dir" ]; then
+            as-user rm -rf "$dir"
+            make-deep "$dir" "$depth"
+        fi
+    done
+
     if ((${#BUILD[@]} > 0)); then
         echo "Creating bfs worktree ..."
 
@@ -297,6 +333,7 @@ setup() {
     export_array JOBS
     export_array EXEC
     export_array SORTED
+    export_array DEEP
 
     if ((UID == 0)); then
         turbo-off
@@ -492,6 +529,26 @@ bench-print-color() {
     do-hyperfine "${cmds[@]}"
 }
 
+# Benchmark printing NUL-separated paths through a pipe
+bench-print-pipe() {
+    subsubgroup '%s' "$1"
+
+    cmds=()
+    for bfs in "${BFS[@]}"; do
+        cmds+=("$bfs $2 -print0 | cat >/dev/null")
+    done
+
+    for find in "${FIND[@]}"; do
+        cmds+=("$find $2 -print0 | cat >/dev/null")
+    done
+
+    for fd in "${FD[@]}"; do
+        cmds+=("$fd -u0 --search-path $2 | cat >/dev/null")
+    done
+
+    do-hyperfine "${cmds[@]}"
+}
+
 # All printing benchmarks
 bench-print() {
     if (($#)); then
@@ -506,6 +563,11 @@ bench-print() {
         for corpus; do
             bench-print-color "$corpus ${TAGS[$corpus]}" "bench/corpus/$corpus"
         done
+
+        subgroup "Through a pipe"
+        for corpus; do
+            bench-print-pipe "$corpus ${TAGS[$corpus]}" "bench/corpus/$corpus"
+        done
     fi
 }
 
@@ -612,6 +674,27 @@ bench-exec-single() {
     do-hyperfine "${cmds[@]}"
 }
 
+# One file/process, with a long $PATH to search
+bench-exec-path() {
+    subsubgroup 'One file per process (long `$PATH`)'
+
+    # Put the real $PATH behind some directories that don't have `true`
+    local path
+    path=$(printf '/nonexistent/%d:' {1..16})
+    path+="$PATH"
+
+    cmds=()
+    for cmd in "${BFS[@]}" "${FIND[@]}"; do
+        cmds+=("env PATH='$path' $cmd $1 -maxdepth 2 -exec true -- {} \;")
+    done
+
+    for fd in "${FD[@]}"; do
+        cmds+=("env PATH='$path' $fd -j1 -u --search-path $1 --max-depth=2 -x true --")
+    done
+
+    do-hyperfine "${cmds[@]}"
+}
+
 # Many files/process
 bench-exec-multi() {
     subsubgroup "Many files per process"
@@ -649,6 +732,7 @@ bench-exec-corpus() {
     subgroup '%s' "$1"
 
     bench-exec-single "$2"
+    bench-exec-path "$2"
     bench-exec-multi "$2"
     bench-exec-chdir "$2"
 }
@@ -687,6 +771,33 @@ bench-sorted() {
     fi
 }
 
+# Benchmark following symlinks in a deep tree
+bench-deep-corpus() {
+    subgroup '%s' "$1"
+
+    cmds=()
+    for cmd in "${BFS[@]}" "${FIND[@]}"; do
+        cmds+=("$cmd -L $2 -false")
+    done
+
+    for fd in "${FD[@]}"; do
+        cmds+=("$fd -uL '^$' $2")
+    done
+
+    do-hyperfine "${cmds[@]}"
+}
+
+# All deep tree benchmarks
+bench-deep() {
+    if (($#)); then
+        group "Deep trees"
+
+        for depth; do
+            bench-deep-corpus "Depth $depth" "bench/corpus/deep-$depth"
+        done
+    fi
+}
+
 # Print benchmarked versions
 bench-versions() {
     subgroup "Versions"
@@ -736,6 +847,7 @@ bench() {
     import_array JOBS
     import_array EXEC
     import_array SORTED
+    import_array DEEP
 
     bench-complete "${COMPLETE[@]}"
     bench-early-quit "${EARLY_QUIT[@]}"
@@ -745,5 +857,6 @@ bench() {
     bench-jobs "${JOBS[@]}"
     bench-exec "${EXEC[@]}"
     bench-sorted "${SORTED[@]}"
+    bench-deep "${DEEP[@]}"
     bench-details
 }
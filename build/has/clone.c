@@ -0,0 +1,14 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+#include <sched.h>
+#include <signal.h>
+
+static int fn(void *arg) {
+	return arg != (void *)0;
+}
+
+int main(void) {
+	char stack[1024];
+	return clone(fn, stack + sizeof(stack), CLONE_VM | CLONE_VFORK | SIGCHLD, (void *)0);
+}
@@ -21,6 +21,7 @@ HEADERS := \
     gen/has/acl-is-trivial-np.h \
     gen/has/acl-trivial.h \
     gen/has/builtin-riscv-pause.h \
+    gen/has/clone.h \
     gen/has/confstr.h \
     gen/has/ctermid.h \
     gen/has/dprintf.h \
@@ -30,6 +31,8 @@ HEADERS := \
     gen/has/extattr-list-link.h \
     gen/has/fchdir.h \
     gen/has/fdclosedir.h \
+    gen/has/fopencookie.h \
+    gen/has/funopen.h \
     gen/has/getdents.h \
     gen/has/getdents64-syscall.h \
     gen/has/getdents64.h \
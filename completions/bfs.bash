@@ -13,15 +13,20 @@ _bfs() {
         -D
         -S
         -exec
+        -exec-filter
+        -exec-stream
         -execdir
         -fprintf
         -fstype
         -gid
         -group
+        -hash
         -j
         -ok
         -okdir
         -regextype
+        -sort-by
+        -summarize
         -type
         -uid
         -user
@@ -32,8 +37,12 @@ _bfs() {
     # (e.g. because they are numeric, glob, regexp, time, etc.)
     local nocomp=(
         -{a,B,c,m}{min,since,time}
+        -contains
         -context
+        -exec-filter-timeout
+        -exec-jobs
         -flags
+        -icontains
         -ilname
         -iname
         -inum
@@ -50,9 +59,11 @@ _bfs() {
         -path
         -perm
         -printf
+        -prune-if-contains
         -regex
         -since
         -size
+        -top
         -used
         -wholename
         -xattrname
@@ -66,6 +77,8 @@ _bfs() {
         -fls
         -fprint
         -fprint0
+        -fprintbin
+        -fprintjson
         -newer
         -newer{a,B,c,m}{a,B,c,m}
         -samefile
@@ -98,6 +111,7 @@ _bfs() {
         -daystart
         -depth
         -follow
+        -ignore-vcs
         -ignore_readdir_race
         -mount
         -nocolor
@@ -135,11 +149,14 @@ _bfs() {
         --help
         --version
         -delete
+        -du
+        -duplicates
         -exit
         -help
         -ls
         -print
         -print0
+        -printjson
         -printx
         -prune
         -quit
@@ -166,7 +183,7 @@ _bfs() {
         fi
 
         case "${words[i]}" in
-            -exec|-execdir|-ok|-okdir)
+            -exec|-exec-filter|-exec-stream|-execdir|-ok|-okdir)
                 offset=$((i + 1))
                 ;;
             \\\;|+)
@@ -192,6 +209,12 @@ _bfs() {
                 _filedir
                 return
                 ;;
+            -top)
+                # -top N KEY
+                #     Print the N files with the largest KEY at the end
+                COMPREPLY=($(compgen -W 'size blocks mtime atime ctime depth' -- "$cur"))
+                return
+                ;;
         esac
     fi
 
@@ -252,12 +275,33 @@ _bfs() {
             COMPREPLY=($(compgen -u -- "$cur"))
             return
             ;;
+        -hash)
+            # -hash ALGO
+            #     Print the hash of each regular file's contents, like sha256sum.  ALGO is
+            #     one of sha256 or xxh64
+            COMPREPLY=($(compgen -W 'sha256 xxh64' -- "$cur"))
+            return
+            ;;
         -regextype)
             # -regextype TYPE
             #     Use TYPE-flavored regexes (default: posix-basic; see -regextype help)
             COMPREPLY=($(compgen -W 'help posix-basic posix-extended' -- "$cur"))
             return
             ;;
+        -sort-by)
+            # -sort-by KEY
+            #     Print the path to the found file at the end, with all the output sorted
+            #     by KEY
+            COMPREPLY=($(compgen -W 'path size blocks mtime atime ctime depth' -- "$cur"))
+            return
+            ;;
+        -summarize)
+            # -summarize KEY
+            #     Print per-group totals at the end, grouped by ext, user, group, size,
+            #     age, or prefix[:N]
+            COMPREPLY=($(compgen -W 'ext user group size age prefix prefix:' -- "$cur"))
+            return
+            ;;
         -type|-xtype)
             # -type [bcdlpfswD]
             #     Find files of the given type
@@ -37,7 +37,10 @@ complete -c bfs -o exclude -d "Exclude all paths matching the expression from th
 complete -c bfs -o color -d "Turn colors on"
 complete -c bfs -o nocolor -d "Turn colors off"
 complete -c bfs -o daystart -d "Measure time relative to the start of today"
+complete -c bfs -o exec-filter-timeout -d "Give up if an -exec-filter command doesn't answer within specified number of seconds" -x
+complete -c bfs -o exec-jobs -d "Run up to specified number of -exec ... {} + batches at once" -x
 complete -c bfs -o files0-from -d "Treat the NUL-separated paths in specified file as starting points for the search" -F
+complete -c bfs -o ignore-vcs -d "Skip files ignored by .gitignore and .ignore files"
 complete -c bfs -o ignore_readdir_race -d "Don't report an error if the file tree is modified during the search"
 complete -c bfs -o noignore_readdir_race -d "Report an error if the file tree is modified during the search"
 complete -c bfs -o maxdepth -d "Ignore files deeper than specified number" -x
@@ -45,7 +48,8 @@ complete -c bfs -o mindepth -d "Ignore files shallower than specified number" -x
 complete -c bfs -o mount -d "Exclude mount points"
 complete -c bfs -o noerror -d "Ignore any errors that occur during traversal"
 complete -c bfs -o nohidden -d "Exclude hidden files and directories"
-complete -c bfs -o noleaf -d "Ignored; for compatibility with GNU find"
+complete -c bfs -o noleaf -d "Don't use directory link counts to skip some stat() calls"
+complete -c bfs -o prune-if-contains -d "Don't descend into directories that contain the specified file" -x
 complete -c bfs -o regextype -d "Use specified flavored regex" -a $regex_type_comp -x
 complete -c bfs -o status -d "Display a status bar while searching"
 complete -c bfs -o unique -d "Skip any files that have already been seen"
@@ -72,6 +76,7 @@ complete -c bfs -o Btime -d "Find files birthed specified number of days ago" -x
 complete -c bfs -o ctime -d "Find files changed specified number of days ago" -x
 complete -c bfs -o mtime -d "Find files modified specified number of days ago" -x
 complete -c bfs -o capable -d "Find files with capabilities set"
+complete -c bfs -o contains -d "Find files whose contents include the string" -x
 complete -c bfs -o context -d "Find files by SELinux context" -x
 complete -c bfs -o depth -d "Find files with specified number of depth" -x
 complete -c bfs -o empty -d "Find empty files/directories"
@@ -86,6 +91,7 @@ complete -c bfs -o uid -d "Find files owned by user ID" -a "(__fish_complete_use
 complete -c bfs -o group -d "Find files owned by the group" -a "(__fish_complete_groups)" -x
 complete -c bfs -o user -d "Find files owned by the user" -a "(__fish_complete_users)" -x
 complete -c bfs -o hidden -d "Find hidden files"
+complete -c bfs -o icontains -d "Case-insensitive versions of -contains" -x
 complete -c bfs -o ilname -d "Case-insensitive versions of -lname" -x
 complete -c bfs -o iname -d "Case-insensitive versions of -name" -x
 complete -c bfs -o ipath -d "Case-insensitive versions of -path" -x
@@ -127,7 +133,11 @@ complete -c bfs -o xtype -d "Find files of the given type, following links when
 # Actions
 
 complete -c bfs -o rm -o delete -d "Delete any found files"
+complete -c bfs -o du -d "Print the disk usage of the found file and everything under it"
+complete -c bfs -o duplicates -d "Print groups of files with identical contents at the end"
 complete -c bfs -o exec -d "Execute a command" -r
+complete -c bfs -o exec-stream -d "Write the paths of found files to a single command's standard input" -r
+complete -c bfs -o exec-filter -d "Like -exec-stream, but read a verdict for each file from the command" -r
 complete -c bfs -o ok -d "Prompt the user whether to execute a command" -r
 complete -c bfs -o execdir -d "Like -exec, but run the command in the same directory as the found file(s)" -r
 complete -c bfs -o okdir -d "Like -ok, but run the command in the same directory as the found file(s)" -r
@@ -135,14 +145,21 @@ complete -c bfs -o exit -d "Exit immediately with the given status" -x
 complete -c bfs -o fls -d "Like -ls, but write to specified file" -F
 complete -c bfs -o fprint -d "Like -print, but write to specified file" -F
 complete -c bfs -o fprint0 -d "Like -print0, but write to specified file" -F
+complete -c bfs -o fprintbin -d "Write the path and metadata of the found file as binary records to specified file" -F
 complete -c bfs -o fprintf -d "Like -printf, but write to specified file" -F
+complete -c bfs -o fprintjson -d "Like -printjson, but write to specified file" -F
+complete -c bfs -o hash -d "Print the hash of the file contents" -a "sha256 xxh64" -x
 complete -c bfs -o limit -d "Limit the number of results" -x
 complete -c bfs -o ls -d "List files like ls -dils"
 complete -c bfs -o print -d "Print the path to the found file"
 complete -c bfs -o print0 -d "Like -print, but use the null character as a separator rather than newlines"
 complete -c bfs -o printf -d "Print according to a format string" -x
+complete -c bfs -o printjson -d "Print the path and metadata of the found file as JSON"
 complete -c bfs -o printx -d "Like -print, but escape whitespace and quotation characters"
 complete -c bfs -o prune -d "Don't descend into this directory"
 complete -c bfs -o quit -d "Quit immediately"
+complete -c bfs -o sort-by -d "Print the path to the found file at the end, sorted by the specified key" -a "path size blocks mtime atime ctime depth" -x
+complete -c bfs -o top -d "Print the files with the largest key at the end" -x
+complete -c bfs -o summarize -d "Print per-group totals at the end" -a "ext user group size age prefix" -x
 complete -c bfs -o version -l version -d "Print version information"
 complete -c bfs -o help -l help -d "Print usage information"
@@ -0,0 +1 @@
+ 0x61, 0x72, 0x00,
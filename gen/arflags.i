@@ -0,0 +1 @@
+ 0x72, 0x63, 0x73, 0x20, 0x00,
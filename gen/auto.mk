@@ -0,0 +1,12 @@
+# gen/auto.mk
+_CFLAGS += -std=c2x
+_LDFLAGS += -Wl,-z,now
+_CPPFLAGS += -MD -MP
+_CFLAGS += -pthread
+_CFLAGS += -Wformat=2
+_CFLAGS += -Wimplicit-fallthrough
+_CFLAGS += -Werror=implicit
+_CFLAGS += -Wmissing-declarations
+_CFLAGS += -Wshadow
+_CFLAGS += -Wsign-compare
+_CFLAGS += -Wstrict-prototypes
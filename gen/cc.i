@@ -0,0 +1 @@
+ 0x63, 0x63, 0x00,
@@ -0,0 +1,6 @@
+# gen/config.mk
+include gen/vars.mk
+include gen/early.mk
+include gen/auto.mk
+include gen/pkgs.mk
+include gen/late.mk
@@ -0,0 +1,7 @@
+# gen/early.mk
+_CPPFLAGS := -Isrc -Igen -include src/prelude.h
+_CFLAGS := 
+_ARFLAGS := 
+_LDFLAGS := 
+_LDLIBS := -lrt
+NOLIBS := 
@@ -0,0 +1 @@
+_CFLAGS += -Wformat=2
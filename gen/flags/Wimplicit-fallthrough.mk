@@ -0,0 +1 @@
+_CFLAGS += -Wimplicit-fallthrough
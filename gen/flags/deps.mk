@@ -0,0 +1 @@
+_CPPFLAGS += -MD -MP
@@ -0,0 +1 @@
+_CFLAGS += -std=c2x
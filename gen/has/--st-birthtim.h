@@ -0,0 +1 @@
+#define BFS_HAS___ST_BIRTHTIM false
@@ -0,0 +1 @@
+#define BFS_HAS__FORK true
@@ -0,0 +1 @@
+#define BFS_HAS_ACL_GET_FILE false
@@ -0,0 +1 @@
+#define BFS_HAS_ACL_IS_TRIVIAL_NP false
@@ -0,0 +1 @@
+#define BFS_HAS_BUILTIN_RISCV_PAUSE false
@@ -0,0 +1 @@
+#define BFS_HAS_GETDENTS64_SYSCALL true
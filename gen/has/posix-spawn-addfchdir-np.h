@@ -0,0 +1 @@
+#define BFS_HAS_POSIX_SPAWN_ADDFCHDIR_NP true
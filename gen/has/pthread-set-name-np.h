@@ -0,0 +1 @@
+#define BFS_HAS_PTHREAD_SET_NAME_NP false
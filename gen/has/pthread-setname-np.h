@@ -0,0 +1 @@
+#define BFS_HAS_PTHREAD_SETNAME_NP true
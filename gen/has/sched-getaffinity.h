@@ -0,0 +1 @@
+#define BFS_HAS_SCHED_GETAFFINITY true
@@ -0,0 +1 @@
+#define BFS_HAS_ST_ACMTIMESPEC false
@@ -0,0 +1 @@
+#define BFS_HAS_STRERROR_R_POSIX false
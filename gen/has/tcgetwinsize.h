@@ -0,0 +1 @@
+#define BFS_HAS_TCGETWINSIZE false
@@ -0,0 +1 @@
+#define BFS_HAS_TIMER_CREATE true
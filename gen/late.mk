@@ -0,0 +1,6 @@
+# gen/late.mk
+_CPPFLAGS +=  
+_CFLAGS += -g -Wall 
+_ARFLAGS += rcs 
+_LDFLAGS +=  
+_LDLIBS :=   ${_LDLIBS}
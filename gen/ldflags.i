@@ -0,0 +1 @@
+ 0x2d, 0x57, 0x6c, 0x2c, 0x2d, 0x7a, 0x2c, 0x6e, 0x6f, 0x77, 0x00,
@@ -0,0 +1,4 @@
+# gen/pkgs.mk
+_CFLAGS += 
+_LDFLAGS += 
+_LDLIBS :=  ${_LDLIBS}
@@ -0,0 +1,10 @@
+# gen/vars.mk
+PREFIX := /usr
+MANDIR := /usr/share/man
+OS := Linux
+CC := cc
+AR := ar
+INSTALL := install
+MKDIR := mkdir -p
+PKG_CONFIG := pkg-config
+RM := rm -f
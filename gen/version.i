@@ -0,0 +1 @@
+ 0x30, 0x30, 0x66, 0x36, 0x64, 0x34, 0x31, 0x2d, 0x64, 0x69, 0x72, 0x74, 0x79, 0x00,
@@ -0,0 +1 @@
+#define BFS_WITH_LIBURING false
@@ -25,6 +25,7 @@
 #include <string.h>
 #include <sys/ioctl.h>
 #include <sys/resource.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -718,6 +719,24 @@ int pipe_cloexec(int pipefd[2]) {
 #endif
 }
 
+int socketpair_cloexec(int domain, int type, int protocol, int sv[2]) {
+#ifdef SOCK_CLOEXEC
+	return socketpair(domain, type | SOCK_CLOEXEC, protocol, sv);
+#else
+	if (socketpair(domain, type, protocol, sv) != 0) {
+		return -1;
+	}
+
+	if (fcntl(sv[0], F_SETFD, FD_CLOEXEC) == -1 || fcntl(sv[1], F_SETFD, FD_CLOEXEC) == -1) {
+		close_quietly(sv[1]);
+		close_quietly(sv[0]);
+		return -1;
+	}
+
+	return 0;
+#endif
+}
+
 size_t xread(int fd, void *buf, size_t nbytes) {
 	size_t count = 0;
 
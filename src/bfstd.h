@@ -412,6 +412,16 @@ int dup_cloexec(int fd);
  */
 int pipe_cloexec(int pipefd[2]);
 
+/**
+ * Like socketpair(), but set the FD_CLOEXEC flag.
+ *
+ * @sv
+ *         The array to hold the two file descriptors.
+ * @return
+ *         0 on success, -1 on failure.
+ */
+int socketpair_cloexec(int domain, int type, int protocol, int sv[2]);
+
 /**
  * A safe version of read() that handles interrupted system calls and partial
  * reads.
@@ -14,6 +14,8 @@
  * - struct bftw_cache: An LRU list of bftw_file's with open file descriptors,
  *   used for openat() to minimize the amount of path re-traversals.
  *
+ * - struct bftw_unlink: An asynchronous unlink request from bftw_unlink().
+ *
  * - struct bftw_state: Represents the current state of the traversal, allowing
  *   various helper functions to take fewer parameters.
  */
@@ -26,6 +28,8 @@
 #include "diag.h"
 #include "dir.h"
 #include "dstring.h"
+#include "idset.h"
+#include "ignore.h"
 #include "ioq.h"
 #include "list.h"
 #include "mtab.h"
@@ -38,6 +42,7 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 /** Initialize a bftw_stat cache. */
 static void bftw_stat_init(struct bftw_stat *bufs, struct bfs_stat *stat_buf, struct bfs_stat *lstat_buf) {
@@ -166,7 +171,9 @@ const struct bfs_stat *bftw_cached_stat(const struct BFTW *ftwbuf, enum bfs_stat
 }
 
 enum bfs_type bftw_type(const struct BFTW *ftwbuf, enum bfs_stat_flags flags) {
-	if (flags & BFS_STAT_NOFOLLOW) {
+	if (ftwbuf->type == BFS_UNKNOWN) {
+		// bftw() skipped the stat() call, so we have to do it now
+	} else if (flags & BFS_STAT_NOFOLLOW) {
 		if (ftwbuf->type == BFS_LNK || (ftwbuf->stat_flags & BFS_STAT_NOFOLLOW)) {
 			return ftwbuf->type;
 		}
@@ -235,6 +242,8 @@ struct bftw_file {
 	int fd;
 	/** Whether this file has a pending ioq request. */
 	bool ioqueued;
+	/** The number of pending asynchronous unlinks of children. */
+	size_t unlinks;
 	/** An open directory for this file, if any. */
 	struct bfs_dir *dir;
 
@@ -244,6 +253,15 @@ struct bftw_file {
 	dev_t dev;
 	/** The inode number, for cycle detection. */
 	ino_t ino;
+	/** The number of subdirectories not yet visited, or -1 if unknown. */
+	long long subdirs;
+
+	/** The ignore files found in this directory, for BFTW_IGNORE_VCS. */
+	enum bfs_ignore_files ignore_files;
+	/** The ignore rules loaded from this directory, if any. */
+	struct bfs_ignore *ignore;
+	/** Whether this directory contains a prune marker. */
+	bool pruned;
 
 	/** Cached bfs_stat() info. */
 	struct bftw_stat stat_bufs;
@@ -745,11 +763,17 @@ static struct bftw_file *bftw_file_new(struct bftw_cache *cache, struct bftw_fil
 	file->pincount = 0;
 	file->fd = -1;
 	file->ioqueued = false;
+	file->unlinks = 0;
 	file->dir = NULL;
 
 	file->type = BFS_UNKNOWN;
 	file->dev = -1;
 	file->ino = -1;
+	file->subdirs = -1;
+
+	file->ignore_files = 0;
+	file->ignore = NULL;
+	file->pruned = false;
 
 	bftw_stat_init(&file->stat_bufs, NULL, NULL);
 
@@ -796,10 +820,44 @@ static void bftw_file_free(struct bftw_cache *cache, struct bftw_file *file) {
 	}
 
 	bftw_stat_recycle(cache, file);
+	bfs_ignore_free(file->ignore);
 
 	varena_free(&cache->files, file, file->namelen + 1);
 }
 
+/**
+ * An asynchronous unlink.
+ */
+struct bftw_unlink {
+	/** The parent directory, which is pinned until the unlink completes. */
+	struct bftw_file *parent;
+	/** List node for bftw_state::unlink_errors. */
+	struct bftw_unlink *next;
+
+	/** The depth of the file. */
+	size_t depth;
+	/** The string offset of the filename. */
+	size_t nameoff;
+	/** The type of the file. */
+	enum bfs_type type;
+	/** The error that occurred, if any. */
+	int error;
+
+	/** The length of the path. */
+	size_t len;
+	/** The full path to the file. */
+	// [[_counted_by(len + 1)]]
+	char path[];
+};
+
+/**
+ * A linked list of bftw_unlink's.
+ */
+struct bftw_unlink_list {
+	struct bftw_unlink *head;
+	struct bftw_unlink **tail;
+};
+
 /**
  * Holds the current state of the bftw() traversal.
  */
@@ -812,12 +870,18 @@ struct bftw_state {
 	bftw_callback *callback;
 	/** bftw() callback data. */
 	void *ptr;
+	/** bftw() unlink error callback. */
+	bftw_unlink_callback *unlink_error;
 	/** bftw() flags. */
 	enum bftw_flags flags;
 	/** Search strategy. */
 	enum bftw_strategy strategy;
 	/** The mount table. */
 	const struct bfs_mtab *mtab;
+	/** Marker names that prune their parent directories. */
+	const char **prune_markers;
+	/** The number of marker names. */
+	size_t nprune_markers;
 	/** bfs_opendir() flags. */
 	enum bfs_dir_flags dir_flags;
 
@@ -834,11 +898,18 @@ struct bftw_state {
 
 	/** The queue of unpinned directories to unwrap. */
 	struct bftw_list to_close;
+	/** Storage for asynchronous unlinks. */
+	struct varena unlinks;
+	/** Asynchronous unlinks that failed, waiting to be reported. */
+	struct bftw_unlink_list unlink_errors;
 	/** The queue of files to visit. */
 	struct bftw_queue fileq;
 	/** The queue of directories to open/read. */
 	struct bftw_queue dirq;
 
+	/** The directories in the current path, by (dev, ino) (for cycle detection). */
+	struct idmap dirs;
+
 	/** The current path. */
 	dchar *path;
 	/** The current file. */
@@ -870,6 +941,16 @@ static bool bftw_must_buffer(const struct bftw_state *state) {
 		return true;
 	}
 
+	if (state->flags & BFTW_IGNORE_VCS) {
+		// Have to see the whole directory to find any ignore files
+		return true;
+	}
+
+	if (state->nprune_markers > 0) {
+		// Have to hold the children back until we know there's no marker
+		return true;
+	}
+
 	if (state->strategy == BFTW_DFS && state->nthreads == 0) {
 		// Without buffering, we would get a not-quite-depth-first
 		// ordering:
@@ -901,9 +982,12 @@ static int bftw_state_init(struct bftw_state *state, const struct bftw_args *arg
 	state->npaths = args->npaths;
 	state->callback = args->callback;
 	state->ptr = args->ptr;
+	state->unlink_error = args->unlink_error;
 	state->flags = args->flags;
 	state->strategy = args->strategy;
 	state->mtab = args->mtab;
+	state->prune_markers = args->prune_markers;
+	state->nprune_markers = args->nprune_markers;
 	state->dir_flags = 0;
 	state->error = 0;
 
@@ -945,6 +1029,8 @@ static int bftw_state_init(struct bftw_state *state, const struct bftw_args *arg
 	}
 
 	SLIST_INIT(&state->to_close);
+	VARENA_INIT(&state->unlinks, struct bftw_unlink, path);
+	SLIST_INIT(&state->unlink_errors);
 
 	enum bftw_qflags qflags = 0;
 	if (state->strategy != BFTW_BFS) {
@@ -967,6 +1053,8 @@ static int bftw_state_init(struct bftw_state *state, const struct bftw_args *arg
 	}
 	bftw_queue_init(&state->dirq, qflags);
 
+	idmap_init(&state->dirs);
+
 	state->path = NULL;
 	state->file = NULL;
 	state->previous = NULL;
@@ -987,17 +1075,42 @@ static void bftw_delayed_unwrap(struct bftw_state *state, struct bftw_file *file
 	}
 }
 
+/** Unpin a directory. */
+static void bftw_unpin_dir(struct bftw_state *state, struct bftw_file *dir, bool unwrap) {
+	bftw_cache_unpin(&state->cache, dir);
+
+	if (unwrap && dir->dir && dir->pincount == 0) {
+		bftw_delayed_unwrap(state, dir);
+	}
+}
+
 /** Unpin a file's parent. */
 static void bftw_unpin_parent(struct bftw_state *state, struct bftw_file *file, bool unwrap) {
 	struct bftw_file *parent = file->parent;
-	if (!parent) {
-		return;
+	if (parent) {
+		bftw_unpin_dir(state, parent, unwrap);
 	}
+}
+
+/** Free an asynchronous unlink. */
+static void bftw_unlink_free(struct bftw_state *state, struct bftw_unlink *req) {
+	varena_free(&state->unlinks, req, req->len + 1);
+}
 
-	bftw_cache_unpin(&state->cache, parent);
+/** Handle the completion of an asynchronous unlink. */
+static void bftw_unlink_done(struct bftw_state *state, struct bftw_unlink *req, int result) {
+	struct bftw_file *parent = req->parent;
+	bfs_assert(parent->unlinks > 0);
+	--parent->unlinks;
+	bftw_unpin_dir(state, parent, true);
 
-	if (unwrap && parent->dir && parent->pincount == 0) {
-		bftw_delayed_unwrap(state, parent);
+	if (result < 0) {
+		// Report the error later, from a safe point
+		req->parent = NULL;
+		req->error = -result;
+		SLIST_APPEND(&state->unlink_errors, req);
+	} else {
+		bftw_unlink_free(state, req);
 	}
 }
 
@@ -1015,12 +1128,19 @@ static int bftw_ioq_pop(struct bftw_state *state, bool block) {
 		return -1;
 	}
 
+	enum ioq_op op = ent->op;
+	if (op == IOQ_UNLINK) {
+		// ent->ptr is a bftw_unlink, not a bftw_file
+		bftw_unlink_done(state, ent->ptr, ent->result);
+		ioq_free(ioq, ent);
+		return op;
+	}
+
 	struct bftw_file *file = ent->ptr;
 	if (file) {
 		bftw_unpin_parent(state, file, true);
 	}
 
-	enum ioq_op op = ent->op;
 	switch (op) {
 	case IOQ_CLOSE:
 		++cache->capacity;
@@ -1425,18 +1545,23 @@ static enum bfs_stat_flags bftw_stat_flags(const struct bftw_state *state, size_
 }
 
 /** Check if a stat() call is necessary. */
-static bool bftw_must_stat(const struct bftw_state *state, size_t depth, enum bfs_type type, const char *name) {
+static bool bftw_must_stat(const struct bftw_state *state, const struct bftw_file *parent, size_t depth, enum bfs_type type, const char *name) {
 	if (state->flags & BFTW_STAT) {
 		return true;
 	}
 
 	switch (type) {
-	case BFS_UNKNOWN:
-		return true;
-
 	case BFS_DIR:
 		return state->flags & (BFTW_DETECT_CYCLES | BFTW_SKIP_MOUNTS | BFTW_PRUNE_MOUNTS);
 
+	case BFS_UNKNOWN:
+		// Once we've seen every subdirectory, the rest must be leaves
+		if (!parent || parent->subdirs != 0) {
+			return true;
+		}
+		// But they could still be symbolic links
+		[[fallthrough]];
+
 	case BFS_LNK:
 		if (!(bftw_stat_flags(state, depth) & BFS_STAT_NOFOLLOW)) {
 			return true;
@@ -1500,7 +1625,7 @@ static bool bftw_should_ioq_stat(struct bftw_state *state, struct bftw_file *fil
 	}
 #endif
 
-	return bftw_must_stat(state, file->depth, file->type, file->name);
+	return bftw_must_stat(state, file->parent, file->depth, file->type, file->name);
 }
 
 /** Call stat() on files that need it. */
@@ -1531,7 +1656,11 @@ static void bftw_stat_files(struct bftw_state *state) {
 /** Push a file onto the queue. */
 static void bftw_push_file(struct bftw_state *state, struct bftw_file *file) {
 	bftw_queue_push(&state->fileq, file);
-	bftw_stat_files(state);
+
+	// Keep the children buffered until we know the directory isn't pruned
+	if (state->nprune_markers == 0) {
+		bftw_stat_files(state);
+	}
 }
 
 /** Pop a file to visit from the queue. */
@@ -1548,9 +1677,35 @@ static void bftw_prepend_path(char *path, size_t nameoff, size_t namelen, const
 	memcpy(path + nameoff, name, namelen);
 }
 
+/** Add a directory to the current path, for cycle detection. */
+static int bftw_path_push(struct bftw_state *state, struct bftw_file *file) {
+	if (!(state->flags & BFTW_DETECT_CYCLES) || file->type != BFS_DIR) {
+		return 0;
+	}
+
+	struct idmap_entry *entry = idmap_ref(&state->dirs, file->dev, file->ino);
+	if (!entry) {
+		return -1;
+	}
+
+	// Remember the shallowest directory with this ID
+	const struct bftw_file *prev = entry->ptr;
+	if (!prev || file->depth < prev->depth) {
+		entry->ptr = file;
+	}
+	return 0;
+}
+
+/** Remove a directory from the current path. */
+static void bftw_path_pop(struct bftw_state *state, const struct bftw_file *file) {
+	if ((state->flags & BFTW_DETECT_CYCLES) && file->type == BFS_DIR) {
+		idmap_unref(&state->dirs, file->dev, file->ino);
+	}
+}
+
 /** Build the path to the current file. */
 static int bftw_build_path(struct bftw_state *state, const char *name) {
-	const struct bftw_file *file = state->file;
+	struct bftw_file *file = state->file;
 
 	size_t nameoff, namelen;
 	if (name) {
@@ -1567,21 +1722,27 @@ static int bftw_build_path(struct bftw_state *state, const char *name) {
 		return -1;
 	}
 
-	// Try to find a common ancestor with the existing path
+	// Find the common ancestor with the existing path, leaving the rest of it
 	const struct bftw_file *ancestor = state->previous;
-	while (ancestor && ancestor->depth > file->depth) {
-		ancestor = ancestor->parent;
+	const struct bftw_file *cursor = file;
+	while (ancestor != cursor) {
+		if (ancestor && (!cursor || ancestor->depth >= cursor->depth)) {
+			bftw_path_pop(state, ancestor);
+			ancestor = ancestor->parent;
+		} else {
+			cursor = cursor->parent;
+		}
 	}
 
 	// Build the path backwards
 	if (name) {
 		bftw_prepend_path(state->path, nameoff, namelen, name);
 	}
-	while (file && file != ancestor) {
+	while (file != ancestor) {
 		bftw_prepend_path(state->path, file->nameoff, file->namelen, file->name);
-
-		if (ancestor && ancestor->depth == file->depth) {
-			ancestor = ancestor->parent;
+		if (bftw_path_push(state, file) != 0) {
+			state->error = errno;
+			return -1;
 		}
 		file = file->parent;
 	}
@@ -1648,9 +1809,18 @@ static int bftw_readdir(struct bftw_state *state) {
 		return -1;
 	}
 
+	if (state->file->pruned) {
+		// No need to read the rest of a pruned directory
+		state->de = NULL;
+		return 0;
+	}
+
 	int ret = bfs_readdir(state->dir, &state->de_storage);
 	if (ret > 0) {
 		state->de = &state->de_storage;
+		if ((state->flags & BFTW_NO_DTYPE) && state->de->type != BFS_WHT) {
+			state->de->type = BFS_UNKNOWN;
+		}
 	} else if (ret == 0) {
 		state->de = NULL;
 	} else {
@@ -1678,6 +1848,30 @@ static int bftw_ensure_open(struct bftw_state *state, struct bftw_file *file, co
 	return ret;
 }
 
+/**
+ * Find an ancestor of a directory with the same (dev, ino).  Every directory in
+ * the current path is in state->dirs, so this is a single lookup.
+ */
+static const struct bftw_file *bftw_find_ancestor(const struct bftw_state *state, const struct bftw_file *parent, const struct bfs_stat *statbuf) {
+	if (!parent) {
+		return NULL;
+	}
+
+	const struct idmap_entry *entry = idmap_get(&state->dirs, statbuf->dev, statbuf->ino);
+	if (!entry) {
+		return NULL;
+	}
+
+	// The current path may end with the directory itself, rather than its
+	// parent, but then the match is only an ancestor if it's shallower
+	const struct bftw_file *ancestor = entry->ptr;
+	if (ancestor->depth > parent->depth) {
+		return NULL;
+	}
+
+	return ancestor;
+}
+
 /** Initialize the buffers with data about the current path. */
 static void bftw_init_ftwbuf(struct bftw_state *state, enum bftw_visit visit) {
 	struct bftw_file *file = state->file;
@@ -1732,7 +1926,7 @@ static void bftw_init_ftwbuf(struct bftw_state *state, enum bftw_visit visit) {
 	}
 
 	const struct bfs_stat *statbuf = NULL;
-	if (bftw_must_stat(state, ftwbuf->depth, ftwbuf->type, ftwbuf->path + ftwbuf->nameoff)) {
+	if (bftw_must_stat(state, parent, ftwbuf->depth, ftwbuf->type, ftwbuf->path + ftwbuf->nameoff)) {
 		statbuf = bftw_stat(ftwbuf, ftwbuf->stat_flags);
 		if (statbuf) {
 			ftwbuf->type = bfs_mode_to_type(statbuf->mode);
@@ -1743,14 +1937,17 @@ static void bftw_init_ftwbuf(struct bftw_state *state, enum bftw_visit visit) {
 		}
 	}
 
+	if (visit == BFTW_PRE && parent && parent->subdirs > 0 && ftwbuf->type == BFS_DIR) {
+		--parent->subdirs;
+	}
+
 	if (ftwbuf->type == BFS_DIR && (state->flags & BFTW_DETECT_CYCLES)) {
-		for (const struct bftw_file *ancestor = parent; ancestor; ancestor = ancestor->parent) {
-			if (ancestor->dev == statbuf->dev && ancestor->ino == statbuf->ino) {
-				ftwbuf->type = BFS_ERROR;
-				ftwbuf->error = ELOOP;
-				ftwbuf->loopoff = ancestor->nameoff + ancestor->namelen;
-				return;
-			}
+		const struct bftw_file *ancestor = bftw_find_ancestor(state, parent, statbuf);
+		if (ancestor) {
+			ftwbuf->type = BFS_ERROR;
+			ftwbuf->error = ELOOP;
+			ftwbuf->loopoff = ancestor->nameoff + ancestor->namelen;
+			return;
 		}
 	}
 }
@@ -1772,13 +1969,153 @@ static bool bftw_is_mount(struct bftw_state *state, const char *name) {
 	return statbuf && statbuf->dev != parent->dev;
 }
 
+/** Find the nearest ignore rules that apply to a directory's children. */
+static const struct bfs_ignore *bftw_find_ignore(const struct bftw_file *dir) {
+	for (; dir; dir = dir->parent) {
+		if (dir->ignore) {
+			return dir->ignore;
+		}
+	}
+
+	return NULL;
+}
+
+/** Check if the current file is ignored by BFTW_IGNORE_VCS. */
+static bool bftw_is_ignored(const struct bftw_state *state, const char *name, enum bftw_visit visit) {
+	if (visit != BFTW_PRE) {
+		return false;
+	}
+
+	const struct bftw_file *parent = state->file;
+	if (!name) {
+		parent = parent->parent;
+	}
+
+	const struct bfs_ignore *ignore = bftw_find_ignore(parent);
+	if (!ignore) {
+		return false;
+	}
+
+	const struct BFTW *ftwbuf = &state->ftwbuf;
+	enum bfs_type type = ftwbuf->type;
+	if (type == BFS_UNKNOWN) {
+		// Only stat() the file if a directory-only rule makes a difference
+		bool ret = bfs_ignore_match(ignore, ftwbuf->path, false);
+		if (ret == bfs_ignore_match(ignore, ftwbuf->path, true)) {
+			return ret;
+		}
+		type = bftw_type(ftwbuf, ftwbuf->stat_flags);
+	}
+
+	return bfs_ignore_match(ignore, ftwbuf->path, type == BFS_DIR);
+}
+
+/** Load the ignore rules for the current directory, for BFTW_IGNORE_VCS. */
+static int bftw_load_ignore(struct bftw_state *state) {
+	struct bftw_file *file = state->file;
+	if (!file->ignore_files || !state->dir || file->pruned) {
+		return 0;
+	}
+
+	const struct bfs_ignore *parent = bftw_find_ignore(file->parent);
+	int dfd = bfs_dirfd(state->dir);
+	file->ignore = bfs_ignore_load(parent, dfd, file->ignore_files, bftw_child_nameoff(file));
+	if (!file->ignore) {
+		state->error = errno;
+		return -1;
+	}
+
+	return 0;
+}
+
 /** Check if bfs_stat() was called from the main thread. */
 static bool bftw_stat_was_sync(const struct bftw_state *state, const struct bfs_stat *buf) {
 	return buf == &state->stat_buf || buf == &state->lstat_buf;
 }
 
+/** Unlink the current file asynchronously. */
+static int bftw_ioq_unlink(struct bftw_state *state, int flags) {
+	const struct BFTW *ftwbuf = &state->ftwbuf;
+	if (!state->unlink_error || ftwbuf->depth == 0) {
+		return -1;
+	}
+
+	if (bftw_ioq_reserve(state) != 0) {
+		return -1;
+	}
+
+	// Only queue the unlink if it's relative to an open parent that we can pin
+	struct bftw_file *file = state->file;
+	struct bftw_file *parent = state->de ? file : file->parent;
+	if (!parent || parent->fd < 0 || parent->fd != ftwbuf->at_fd) {
+		return -1;
+	}
+
+	size_t len = strlen(ftwbuf->path);
+	struct bftw_unlink *req = varena_alloc(&state->unlinks, len + 1);
+	if (!req) {
+		return -1;
+	}
+
+	req->parent = parent;
+	SLIST_ITEM_INIT(req);
+	req->depth = ftwbuf->depth;
+	req->nameoff = ftwbuf->nameoff;
+	req->type = ftwbuf->type;
+	req->error = 0;
+	req->len = len;
+	memcpy(req->path, ftwbuf->path, len + 1);
+
+	bftw_cache_pin(&state->cache, parent);
+
+	const char *at_path = req->path + (ftwbuf->at_path - ftwbuf->path);
+	if (ioq_unlink(state->ioq, parent->fd, at_path, flags, req) != 0) {
+		bftw_unpin_dir(state, parent, false);
+		bftw_unlink_free(state, req);
+		return -1;
+	}
+
+	++parent->unlinks;
+	return 0;
+}
+
+int bftw_unlink(const struct BFTW *ftwbuf, int flags) {
+	struct bftw_state *state = container_of(ftwbuf, struct bftw_state, ftwbuf);
+	if (bftw_ioq_unlink(state, flags) == 0) {
+		return 0;
+	}
+
+	return unlinkat(ftwbuf->at_fd, ftwbuf->at_path, flags);
+}
+
+/** Report any asynchronous unlink errors. */
+static void bftw_unlink_errors(struct bftw_state *state) {
+	drain_slist (struct bftw_unlink, req, &state->unlink_errors) {
+		struct bfs_stat stat_buf, lstat_buf;
+
+		struct BFTW ftwbuf = {
+			.path = req->path,
+			.nameoff = req->nameoff,
+			.root = req->path,
+			.depth = req->depth,
+			.visit = BFTW_PRE,
+			.type = req->type,
+			.error = req->error,
+			.at_fd = AT_FDCWD,
+			.at_path = req->path,
+			.stat_flags = BFS_STAT_NOFOLLOW,
+		};
+		bftw_stat_init(&ftwbuf.stat_bufs, &stat_buf, &lstat_buf);
+
+		state->unlink_error(&ftwbuf, state->ptr);
+		bftw_unlink_free(state, req);
+	}
+}
+
 /** Invoke the callback. */
 static enum bftw_action bftw_call_back(struct bftw_state *state, const char *name, enum bftw_visit visit) {
+	bftw_unlink_errors(state);
+
 	if (visit == BFTW_POST && !(state->flags & BFTW_POST_ORDER)) {
 		return BFTW_PRUNE;
 	}
@@ -1800,6 +2137,9 @@ static enum bftw_action bftw_call_back(struct bftw_state *state, const char *nam
 	if ((state->flags & BFTW_SKIP_MOUNTS) && bftw_is_mount(state, name)) {
 		goto done;
 	}
+	if ((state->flags & BFTW_IGNORE_VCS) && bftw_is_ignored(state, name, visit)) {
+		goto done;
+	}
 
 	ret = state->callback(ftwbuf, state->ptr);
 	switch (ret) {
@@ -1890,6 +2230,9 @@ static int bftw_gc(struct bftw_state *state, enum bftw_gc_flags flags) {
 			break;
 		}
 
+		// Wait for any children to be unlinked, e.g. before rmdir()
+		while (file->unlinks > 0 && bftw_ioq_pop(state, true) >= 0);
+
 		if (flags & visit) {
 			if (bftw_call_back(state, NULL, BFTW_POST) == BFTW_STOP) {
 				ret = -1;
@@ -1900,6 +2243,7 @@ static int bftw_gc(struct bftw_state *state, enum bftw_gc_flags flags) {
 
 		struct bftw_file *parent = file->parent;
 		if (state->previous == file) {
+			bftw_path_pop(state, file);
 			state->previous = parent;
 		}
 		state->file = parent;
@@ -1967,8 +2311,43 @@ static void bftw_flush(struct bftw_state *state) {
 	}
 }
 
+/** Check if a directory entry is a prune marker. */
+static bool bftw_is_marker(const struct bftw_state *state, const char *name) {
+	for (size_t i = 0; i < state->nprune_markers; ++i) {
+		if (strcmp(name, state->prune_markers[i]) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/** Drop the buffered children of a pruned directory without visiting them. */
+static void bftw_drop_children(struct bftw_state *state) {
+	struct bftw_file *parent = state->file;
+	if (!parent || !parent->pruned) {
+		return;
+	}
+
+	struct bftw_queue *queue = &state->fileq;
+	drain_slist (struct bftw_file, file, &queue->buffer) {
+		bfs_assert(file->parent == parent);
+		--queue->size;
+		--parent->refcount;
+		--file->refcount;
+		bftw_file_free(&state->cache, file);
+	}
+}
+
 /** Close the current directory. */
 static int bftw_closedir(struct bftw_state *state) {
+	bftw_drop_children(state);
+
+	// The children are all buffered, so load the rules before visiting them
+	if (bftw_load_ignore(state) != 0) {
+		return -1;
+	}
+
 	if (bftw_gc(state, BFTW_VISIT_ALL) != 0) {
 		return -1;
 	}
@@ -1977,15 +2356,78 @@ static int bftw_closedir(struct bftw_state *state) {
 	return 0;
 }
 
+/** Check if a filesystem type is known to give directories POSIX link counts. */
+static bool bftw_nlink_fstype(const char *type) {
+	static const char *const types[] = {
+		"ext2",
+		"ext3",
+		"ext4",
+		"jfs",
+		"reiserfs",
+		"tmpfs",
+		"xfs",
+	};
+
+	for (size_t i = 0; i < countof(types); ++i) {
+		if (strcmp(type, types[i]) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/** Count a directory's subdirectories from its link count, if possible. */
+static void bftw_count_subdirs(const struct bftw_state *state, struct bftw_file *file, const struct bfs_stat *statbuf) {
+	if (!(state->flags & BFTW_NLINK) || (state->flags & BFTW_STAT) || !state->mtab) {
+		return;
+	}
+
+	// Links to subdirectories don't contribute to the link count
+	if (!(bftw_stat_flags(state, file->depth + 1) & BFS_STAT_NOFOLLOW)) {
+		return;
+	}
+
+	// Each subdirectory has a ".." link, plus one from the parent and one
+	// from ".".  Some filesystems use 1 to mean "too many to count".
+	if (statbuf->nlink < 2) {
+		return;
+	}
+
+	const char *type = bfs_fstype(state->mtab, statbuf);
+	if (!type || !bftw_nlink_fstype(type)) {
+		return;
+	}
+
+	file->subdirs = statbuf->nlink - 2;
+}
+
 /** Fill file identity information from an ftwbuf. */
-static void bftw_save_ftwbuf(struct bftw_file *file, const struct BFTW *ftwbuf) {
+static int bftw_save_ftwbuf(struct bftw_state *state, struct bftw_file *file) {
+	// A buffered file is already in the current path, under its old identity
+	bool in_path = file == state->previous;
+	if (in_path) {
+		bftw_path_pop(state, file);
+	}
+
+	const struct BFTW *ftwbuf = &state->ftwbuf;
 	file->type = ftwbuf->type;
 
 	const struct bfs_stat *statbuf = bftw_cached_stat(ftwbuf, ftwbuf->stat_flags);
 	if (statbuf) {
 		file->dev = statbuf->dev;
 		file->ino = statbuf->ino;
+
+		if (file->type == BFS_DIR) {
+			bftw_count_subdirs(state, file, statbuf);
+		}
 	}
+
+	if (in_path) {
+		return bftw_path_push(state, file);
+	}
+
+	return 0;
 }
 
 /** Check if we should buffer a file instead of visiting it. */
@@ -2011,7 +2453,7 @@ static bool bftw_buffer_file(const struct bftw_state *state, const struct bftw_f
 
 	size_t depth = file ? file->depth + 1 : 1;
 	enum bfs_type type = state->de ? state->de->type : BFS_UNKNOWN;
-	return bftw_must_stat(state, depth, type, name);
+	return bftw_must_stat(state, file, depth, type, name);
 }
 
 /** Visit and/or enqueue the current file. */
@@ -2020,6 +2462,15 @@ static int bftw_visit(struct bftw_state *state, const char *name) {
 	struct bftw_file *file = state->file;
 
 	if (bftw_buffer_file(state, file, name)) {
+		if (file && (state->flags & BFTW_IGNORE_VCS)) {
+			file->ignore_files |= bfs_ignore_file(name);
+		}
+
+		if (file && bftw_is_marker(state, name)) {
+			file->pruned = true;
+			return 0;
+		}
+
 		file = bftw_file_new(cache, file, name);
 		if (!file) {
 			state->error = errno;
@@ -2046,10 +2497,14 @@ static int bftw_visit(struct bftw_state *state, const char *name) {
 			return -1;
 		}
 
-		bftw_save_ftwbuf(file, &state->ftwbuf);
+		// Push the directory even on failure, so it gets cleaned up
+		int ret = bftw_save_ftwbuf(state, file);
+		if (ret != 0) {
+			state->error = errno;
+		}
 		bftw_stat_recycle(cache, file);
 		bftw_push_dir(state, file);
-		return 0;
+		return ret;
 
 	case BFTW_PRUNE:
 		if (file && !name) {
@@ -2091,12 +2546,16 @@ static int bftw_state_destroy(struct bftw_state *state) {
 		state->ioq = NULL;
 	}
 
+	bftw_unlink_errors(state);
+
 	bftw_gc(state, BFTW_VISIT_NONE);
 	bftw_drain(state, &state->dirq);
 	bftw_drain(state, &state->fileq);
 
 	ioq_destroy(ioq);
 
+	idmap_destroy(&state->dirs);
+	varena_destroy(&state->unlinks);
 	bftw_cache_destroy(&state->cache);
 
 	errno = state->error;
@@ -2164,6 +2623,8 @@ struct bftw_ids_state {
 	bftw_callback *delegate;
 	/** The wrapped callback arguments. */
 	void *ptr;
+	/** The wrapped unlink error callback. */
+	bftw_unlink_callback *unlink_delegate;
 	/** Which visit this search corresponds to. */
 	enum bftw_visit visit;
 	/** Whether to override the bftw_visit. */
@@ -2236,10 +2697,17 @@ static enum bftw_action bftw_ids_callback(const struct BFTW *ftwbuf, void *ptr)
 	return ret;
 }
 
+/** Iterative deepening unlink error callback. */
+static void bftw_ids_unlink_error(const struct BFTW *ftwbuf, void *ptr) {
+	struct bftw_ids_state *state = ptr;
+	state->unlink_delegate(ftwbuf, state->ptr);
+}
+
 /** Initialize iterative deepening state. */
 static int bftw_ids_init(struct bftw_ids_state *state, const struct bftw_args *args) {
 	state->delegate = args->callback;
 	state->ptr = args->ptr;
+	state->unlink_delegate = args->unlink_error;
 	state->visit = BFTW_PRE;
 	state->force_visit = false;
 	state->min_depth = 0;
@@ -2250,6 +2718,9 @@ static int bftw_ids_init(struct bftw_ids_state *state, const struct bftw_args *a
 	struct bftw_args ids_args = *args;
 	ids_args.callback = bftw_ids_callback;
 	ids_args.ptr = state;
+	if (args->unlink_error) {
+		ids_args.unlink_error = bftw_ids_unlink_error;
+	}
 	ids_args.flags &= ~BFTW_POST_ORDER;
 	return bftw_state_init(&state->nested, &ids_args);
 }
@@ -53,7 +53,10 @@ struct BFTW {
 	/** Which visit this is. */
 	enum bftw_visit visit;
 
-	/** The file type. */
+	/**
+	 * The file type.  May be BFS_UNKNOWN for files that are known not to
+	 * be directories (see BFTW_NLINK); use bftw_type() to get the full type.
+	 */
 	enum bfs_type type;
 	/** The errno that occurred, if type == BFS_ERROR. */
 	int error;
@@ -111,6 +114,23 @@ const struct bfs_stat *bftw_cached_stat(const struct BFTW *ftwbuf, enum bfs_stat
  */
 enum bfs_type bftw_type(const struct BFTW *ftwbuf, enum bfs_stat_flags flags);
 
+/**
+ * Unlink a file encountered during bftw(), asynchronously if possible.  Must
+ * only be called from the bftw() callback.
+ *
+ * If the unlink is asynchronous, any error will be reported later through
+ * bftw_args::unlink_error.  A directory's own BFTW_POST visit is delayed until
+ * all the asynchronous unlinks of its children have completed.
+ *
+ * @ftwbuf
+ *         bftw() data for the file to unlink.
+ * @flags
+ *         Flags for unlinkat(), e.g. AT_REMOVEDIR.
+ * @return
+ *         0 on success (or if the unlink was queued), -1 on failure.
+ */
+int bftw_unlink(const struct BFTW *ftwbuf, int flags);
+
 /**
  * Walk actions returned by the bftw() callback.
  */
@@ -135,6 +155,17 @@ enum bftw_action {
  */
 typedef enum bftw_action bftw_callback(const struct BFTW *ftwbuf, void *ptr);
 
+/**
+ * Callback function type for asynchronous bftw_unlink() errors.
+ *
+ * @ftwbuf
+ *         Data about the file that couldn't be unlinked.  The error is in
+ *         ftwbuf->error.
+ * @ptr
+ *         The pointer passed to bftw().
+ */
+typedef void bftw_unlink_callback(const struct BFTW *ftwbuf, void *ptr);
+
 /**
  * Flags that control bftw() behavior.
  */
@@ -161,6 +192,12 @@ enum bftw_flags {
 	BFTW_BUFFER        = 1 << 9,
 	/** Include whiteouts in the search results. */
 	BFTW_WHITEOUTS     = 1 << 10,
+	/** Use directory link counts to avoid stat()ing non-directories. */
+	BFTW_NLINK         = 1 << 11,
+	/** Skip files matched by .gitignore and .ignore files. */
+	BFTW_IGNORE_VCS    = 1 << 12,
+	/** Ignore the file types returned by readdir() (for testing). */
+	BFTW_NO_DTYPE      = 1 << 13,
 };
 
 /**
@@ -190,6 +227,8 @@ struct bftw_args {
 	bftw_callback *callback;
 	/** A pointer which is passed to the callback. */
 	void *ptr;
+	/** The callback for asynchronous unlink errors, if any. */
+	bftw_unlink_callback *unlink_error;
 
 	/** The maximum number of file descriptors to keep open. */
 	int nopenfd;
@@ -203,6 +242,11 @@ struct bftw_args {
 
 	/** The parsed mount table, if available. */
 	const struct bfs_mtab *mtab;
+
+	/** Directories containing any of these names have their children skipped. */
+	const char **prune_markers;
+	/** The number of marker names. */
+	size_t nprune_markers;
 };
 
 /**
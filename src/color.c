@@ -7,11 +7,13 @@
 #include "bfs.h"
 #include "bfstd.h"
 #include "bftw.h"
+#include "bit.h"
 #include "diag.h"
 #include "dir.h"
 #include "dstring.h"
 #include "expr.h"
 #include "fsade.h"
+#include "outq.h"
 #include "stat.h"
 #include "trie.h"
 
@@ -53,6 +55,34 @@ struct ext_color {
 	char ext[];
 };
 
+/**
+ * A slot in an extension table.
+ */
+struct ext_slot {
+	/** The hash of the reversed extension. */
+	uint64_t hash;
+	/** The length of the extension. */
+	size_t len;
+	/** The reversed extension. */
+	const char *key;
+	/** The matching extension, or NULL for an empty slot. */
+	const struct ext_color *ext;
+};
+
+/**
+ * A precompiled table of extensions, bucketed by length.
+ */
+struct ext_table {
+	/** Open-addressed hash table of extensions. */
+	struct ext_slot *slots;
+	/** The table capacity minus one. */
+	size_t mask;
+	/** Longest extension. */
+	size_t max_len;
+	/** Whether there are any extensions of each length. */
+	bool *lens;
+};
+
 struct colors {
 	/** esc_seq allocator. */
 	struct varena esc_arena;
@@ -112,12 +142,14 @@ struct colors {
 
 	/** Number of extensions. */
 	size_t ext_count;
-	/** Longest extension. */
-	size_t ext_len;
 	/** Case-sensitive extension trie. */
 	struct trie ext_trie;
 	/** Case-insensitive extension trie. */
 	struct trie iext_trie;
+	/** Case-sensitive extension table, built from ext_trie. */
+	struct ext_table ext_table;
+	/** Case-insensitive extension table, built from iext_trie. */
+	struct ext_table iext_table;
 };
 
 /** Allocate an escape sequence. */
@@ -202,20 +234,23 @@ static void ext_reverse(char *ext, size_t len) {
 	}
 }
 
+/** Convert a character to lowercase for case-insensitive matching. */
+static char ext_lower(char c) {
+	// What's internationalization?  Doesn't matter, this is what
+	// GNU ls does.  Luckily, since there's no standard C way to
+	// casefold.  Not using tolower() here since it respects the
+	// current locale, which GNU ls doesn't do.
+	if (c >= 'A' && c <= 'Z') {
+		c += 'a' - 'A';
+	}
+
+	return c;
+}
+
 /** Convert a string to lowercase for case-insensitive matching. */
 static void ext_tolower(char *ext, size_t len) {
 	for (size_t i = 0; i < len; ++i) {
-		char c = ext[i];
-
-		// What's internationalization?  Doesn't matter, this is what
-		// GNU ls does.  Luckily, since there's no standard C way to
-		// casefold.  Not using tolower() here since it respects the
-		// current locale, which GNU ls doesn't do.
-		if (c >= 'A' && c <= 'Z') {
-			c += 'a' - 'A';
-		}
-
-		ext[i] = c;
+		ext[i] = ext_lower(ext[i]);
 	}
 }
 
@@ -267,10 +302,6 @@ static int set_ext(struct colors *colors, dchar *key, dchar *value) {
 		goto fail;
 	}
 
-	if (colors->ext_len < len) {
-		colors->ext_len = len;
-	}
-
 	return 0;
 
 fail:
@@ -363,42 +394,157 @@ static int build_iext_trie(struct colors *colors) {
 	return 0;
 }
 
+/** Initialize an extension table. */
+static void ext_table_init(struct ext_table *table) {
+	table->slots = NULL;
+	table->mask = 0;
+	table->max_len = 0;
+	table->lens = NULL;
+}
+
+/** Add a character to an extension hash (FNV-1a). */
+static uint64_t ext_hash(uint64_t hash, char c) {
+	return (hash ^ (unsigned char)c) * UINT64_C(0x100000001b3);
+}
+
+/** The initial extension hash. */
+#define EXT_HASH_INIT UINT64_C(0xcbf29ce484222325)
+
 /**
- * Find a color by an extension.
+ * Build an extension table from a trie of reversed extensions.
+ *
+ * Suffix lookups in the trie need a reversed copy of the file name, while the
+ * table can be probed directly by hashing the name backwards, one length at a
+ * time.
  */
-static const struct esc_seq *get_ext(const struct colors *colors, const char *filename, size_t name_len) {
-	size_t ext_len = colors->ext_len;
-	if (name_len < ext_len) {
-		ext_len = name_len;
+static int ext_table_build(struct ext_table *table, const struct trie *trie) {
+	size_t count = 0;
+	for_trie (leaf, trie) {
+		size_t len = leaf->length - 1;
+		if (table->max_len < len) {
+			table->max_len = len;
+		}
+		++count;
 	}
-	const char *suffix = filename + name_len - ext_len;
 
-	char buf[256];
-	char *copy;
-	if (ext_len < sizeof(buf)) {
-		copy = memcpy(buf, suffix, ext_len);
-		copy[ext_len] = '\0';
-	} else {
-		copy = strndup(suffix, ext_len);
-		if (!copy) {
-			return NULL;
+	if (count == 0) {
+		return 0;
+	}
+
+	table->lens = ZALLOC_ARRAY(bool, table->max_len + 1);
+	if (!table->lens) {
+		return -1;
+	}
+
+	size_t capacity = bit_ceil(2 * count);
+	table->slots = ZALLOC_ARRAY(struct ext_slot, capacity);
+	if (!table->slots) {
+		return -1;
+	}
+	table->mask = capacity - 1;
+
+	for_trie (leaf, trie) {
+		size_t len = leaf->length - 1;
+		table->lens[len] = true;
+
+		uint64_t hash = EXT_HASH_INIT;
+		for (size_t i = 0; i < len; ++i) {
+			hash = ext_hash(hash, leaf->key[i]);
+		}
+
+		size_t i = hash & table->mask;
+		while (table->slots[i].ext) {
+			i = (i + 1) & table->mask;
 		}
+
+		struct ext_slot *slot = &table->slots[i];
+		slot->hash = hash;
+		slot->len = len;
+		slot->key = leaf->key;
+		slot->ext = leaf->value;
 	}
 
-	ext_reverse(copy, ext_len);
-	const struct trie_leaf *leaf = trie_find_prefix(&colors->ext_trie, copy);
-	const struct ext_color *ext = leaf ? leaf->value : NULL;
+	return 0;
+}
 
-	ext_tolower(copy, ext_len);
-	const struct trie_leaf *ileaf = trie_find_prefix(&colors->iext_trie, copy);
-	const struct ext_color *iext = ileaf ? ileaf->value : NULL;
+/** Look up a file name suffix in an extension table. */
+static const struct ext_color *ext_table_find(const struct ext_table *table, uint64_t hash, const char *suffix, size_t len, bool icase) {
+	for (size_t i = hash & table->mask; table->slots[i].ext; i = (i + 1) & table->mask) {
+		const struct ext_slot *slot = &table->slots[i];
+		if (slot->hash != hash || slot->len != len) {
+			continue;
+		}
 
-	if (iext && (!ext || ext->priority < iext->priority)) {
-		ext = iext;
+		size_t j;
+		for (j = 0; j < len; ++j) {
+			char c = suffix[len - j - 1];
+			if (icase) {
+				c = ext_lower(c);
+			}
+			if (c != slot->key[j]) {
+				break;
+			}
+		}
+		if (j == len) {
+			return slot->ext;
+		}
+	}
+
+	return NULL;
+}
+
+/** Destroy an extension table. */
+static void ext_table_destroy(struct ext_table *table) {
+	free(table->lens);
+	free(table->slots);
+}
+
+/**
+ * Find a color by an extension.
+ */
+static const struct esc_seq *get_ext(const struct colors *colors, const char *filename, size_t name_len) {
+	const struct ext_table *table = &colors->ext_table;
+	const struct ext_table *itable = &colors->iext_table;
+
+	size_t max_len = table->max_len;
+	if (max_len < itable->max_len) {
+		max_len = itable->max_len;
+	}
+	if (max_len > name_len) {
+		max_len = name_len;
+	}
+
+	// Hash the name backwards, checking for the longest matching
+	// extension of each length along the way
+	const struct ext_color *ext = NULL, *iext = NULL;
+	uint64_t hash = EXT_HASH_INIT, ihash = EXT_HASH_INIT;
+	for (size_t len = 1; len <= max_len; ++len) {
+		const char *suffix = filename + name_len - len;
+		char c = *suffix;
+
+		if (len <= table->max_len) {
+			hash = ext_hash(hash, c);
+			if (table->lens[len]) {
+				const struct ext_color *match = ext_table_find(table, hash, suffix, len, false);
+				if (match) {
+					ext = match;
+				}
+			}
+		}
+
+		if (len <= itable->max_len) {
+			ihash = ext_hash(ihash, ext_lower(c));
+			if (itable->lens[len]) {
+				const struct ext_color *match = ext_table_find(itable, ihash, suffix, len, true);
+				if (match) {
+					iext = match;
+				}
+			}
+		}
 	}
 
-	if (copy != buf) {
-		free(copy);
+	if (iext && (!ext || ext->priority < iext->priority)) {
+		ext = iext;
 	}
 
 	return ext ? ext->esc : NULL;
@@ -730,9 +876,10 @@ struct colors *parse_colors(void) {
 	VARENA_INIT(&colors->ext_arena, struct ext_color, ext);
 	trie_init(&colors->names);
 	colors->ext_count = 0;
-	colors->ext_len = 0;
 	trie_init(&colors->ext_trie);
 	trie_init(&colors->iext_trie);
+	ext_table_init(&colors->ext_table);
+	ext_table_init(&colors->iext_table);
 
 	bool fail = false;
 
@@ -810,6 +957,12 @@ struct colors *parse_colors(void) {
 	if (build_iext_trie(colors) != 0) {
 		goto fail;
 	}
+	if (ext_table_build(&colors->ext_table, &colors->ext_trie) != 0) {
+		goto fail;
+	}
+	if (ext_table_build(&colors->iext_table, &colors->iext_trie) != 0) {
+		goto fail;
+	}
 
 	if (colors->link && esc_eq(colors->link, "target", strlen("target"))) {
 		colors->link_as_target = true;
@@ -842,6 +995,8 @@ void free_colors(struct colors *colors) {
 		return;
 	}
 
+	ext_table_destroy(&colors->iext_table);
+	ext_table_destroy(&colors->ext_table);
 	trie_destroy(&colors->iext_trie);
 	trie_destroy(&colors->ext_trie);
 	trie_destroy(&colors->names);
@@ -851,6 +1006,23 @@ void free_colors(struct colors *colors) {
 	free(colors);
 }
 
+/**
+ * State for asynchronous output.
+ */
+struct cfasync {
+	/** The synchronous stream we replaced. */
+	FILE *file;
+	/** The queue that the asynchronous stream writes to. */
+	struct outq *outq;
+	/** The stdio buffer for the asynchronous stream. */
+	char *iobuf;
+};
+
+/** The size of the stdio buffer for non-terminal output. */
+#define CFILE_IOBUF_SIZE (128 << 10)
+/** Alignment for the stdio buffer (typical page size). */
+#define CFILE_IOBUF_ALIGN 4096
+
 CFILE *cfwrap(FILE *file, const struct colors *colors, bool close) {
 	CFILE *cfile = ALLOC(CFILE);
 	if (!cfile) {
@@ -865,6 +1037,8 @@ CFILE *cfwrap(FILE *file, const struct colors *colors, bool close) {
 
 	cfile->file = file;
 	cfile->fd = fileno(file);
+	cfile->iobuf = NULL;
+	cfile->async = NULL;
 	cfile->need_reset = false;
 	cfile->close = close;
 
@@ -872,6 +1046,18 @@ CFILE *cfwrap(FILE *file, const struct colors *colors, bool close) {
 		cfile->colors = colors;
 	} else {
 		cfile->colors = NULL;
+
+		// Output to files and pipes can be large, so batch it into
+		// fewer write() calls.  Leave stderr unbuffered though.
+		if (file != stderr) {
+			cfile->iobuf = alloc(CFILE_IOBUF_ALIGN, CFILE_IOBUF_SIZE);
+			if (!cfile->iobuf) {
+				dstrfree(cfile->buffer);
+				free(cfile);
+				return NULL;
+			}
+			setvbuf(file, cfile->iobuf, _IOFBF, CFILE_IOBUF_SIZE);
+		}
 	}
 
 	return cfile;
@@ -883,8 +1069,22 @@ int cfclose(CFILE *cfile) {
 	if (cfile) {
 		dstrfree(cfile->buffer);
 
-		if (cfile->close) {
+		struct cfasync *async = cfile->async;
+		if (async) {
+			// Closing the asynchronous stream drains its queue
 			ret = fclose(cfile->file);
+			free(async->iobuf);
+			cfile->file = async->file;
+			free(async);
+		}
+
+		// Streams we don't close may still be flushed by exit(), so
+		// their buffers must stay alive
+		if (cfile->close) {
+			if (fclose(cfile->file) != 0) {
+				ret = -1;
+			}
+			free(cfile->iobuf);
 		}
 
 		free(cfile);
@@ -893,6 +1093,116 @@ int cfclose(CFILE *cfile) {
 	return ret;
 }
 
+/** The capacity of the queue for asynchronous output. */
+#define CFILE_OUTQ_SIZE (8 * CFILE_IOBUF_SIZE)
+
+#if BFS_HAS_FOPENCOOKIE
+
+/** fopencookie() write callback. */
+static ssize_t cfasync_write(void *cookie, const char *buf, size_t size) {
+	if (outq_write(cookie, buf, size) != 0) {
+		return 0;
+	}
+	return size;
+}
+
+/** fopencookie() close callback. */
+static int cfasync_close(void *cookie) {
+	return outq_destroy(cookie);
+}
+
+/** Open a stream that writes to an output queue. */
+static FILE *cfasync_open(struct outq *outq) {
+	cookie_io_functions_t funcs = {
+		.write = cfasync_write,
+		.close = cfasync_close,
+	};
+	return fopencookie(outq, "w", funcs);
+}
+
+#elif BFS_HAS_FUNOPEN
+
+/** funopen() write callback. */
+static int cfasync_write(void *cookie, const char *buf, int size) {
+	if (outq_write(cookie, buf, size) != 0) {
+		return -1;
+	}
+	return size;
+}
+
+/** funopen() close callback. */
+static int cfasync_close(void *cookie) {
+	return outq_destroy(cookie);
+}
+
+/** Open a stream that writes to an output queue. */
+static FILE *cfasync_open(struct outq *outq) {
+	return funopen(outq, NULL, cfasync_write, NULL, cfasync_close);
+}
+
+#endif
+
+int cfasync(CFILE *cfile) {
+#if BFS_HAS_FOPENCOOKIE || BFS_HAS_FUNOPEN
+	if (cfile->async) {
+		return 0;
+	}
+
+	if (fflush(cfile->file) != 0) {
+		return -1;
+	}
+
+	struct cfasync *async = ALLOC(struct cfasync);
+	if (!async) {
+		return -1;
+	}
+
+	async->iobuf = alloc(CFILE_IOBUF_ALIGN, CFILE_IOBUF_SIZE);
+	if (!async->iobuf) {
+		goto fail;
+	}
+
+	async->outq = outq_create(cfile->fd, CFILE_OUTQ_SIZE);
+	if (!async->outq) {
+		goto fail_iobuf;
+	}
+
+	FILE *file = cfasync_open(async->outq);
+	if (!file) {
+		goto fail_outq;
+	}
+	setvbuf(file, async->iobuf, _IOFBF, CFILE_IOBUF_SIZE);
+
+	async->file = cfile->file;
+	cfile->file = file;
+	cfile->async = async;
+	return 0;
+
+fail_outq:
+	outq_destroy(async->outq);
+fail_iobuf:
+	free(async->iobuf);
+fail:
+	free(async);
+	return -1;
+#else
+	errno = ENOTSUP;
+	return -1;
+#endif
+}
+
+int cfflush(CFILE *cfile) {
+	if (fflush(cfile->file) != 0) {
+		return -1;
+	}
+
+	if (cfile->async) {
+		return outq_drain(cfile->async->outq);
+	}
+
+	return 0;
+}
+
 bool colors_need_stat(const struct colors *colors) {
 	return colors->setuid || colors->setgid || colors->executable || colors->multi_hard
 		|| colors->sticky_other_writable || colors->other_writable || colors->sticky;
@@ -1345,7 +1655,7 @@ static int print_name(CFILE *cfile, const struct BFTW *ftwbuf) {
 	}
 
 	enum bfs_stat_flags flags = ftwbuf->stat_flags;
-	if (colors->link_as_target && ftwbuf->type == BFS_LNK) {
+	if (colors->link_as_target && bftw_type(ftwbuf, ftwbuf->stat_flags) == BFS_LNK) {
 		flags = BFS_STAT_TRYFOLLOW;
 	}
 
@@ -1360,7 +1670,7 @@ static int print_path(CFILE *cfile, const struct BFTW *ftwbuf) {
 	}
 
 	enum bfs_stat_flags flags = ftwbuf->stat_flags;
-	if (colors->link_as_target && ftwbuf->type == BFS_LNK) {
+	if (colors->link_as_target && bftw_type(ftwbuf, ftwbuf->stat_flags) == BFS_LNK) {
 		flags = BFS_STAT_TRYFOLLOW;
 	}
 
@@ -1688,6 +1998,34 @@ int cfprintf(CFILE *cfile, const char *format, ...) {
 	return ret;
 }
 
+int cfputpath(CFILE *cfile, const char *path) {
+	if (!cfile->colors) {
+		return cfprintf(cfile, "%s\n", path);
+	}
+
+	struct bfs_stat stat_buf, lstat_buf;
+	const struct BFTW ftwbuf = {
+		.path = path,
+		.nameoff = xbaseoff(path),
+		.root = path,
+		.depth = 0,
+		.visit = BFTW_PRE,
+		.type = BFS_UNKNOWN,
+		.error = 0,
+		.at_fd = AT_FDCWD,
+		.at_path = path,
+		.stat_flags = BFS_STAT_NOFOLLOW,
+		.stat_bufs = {
+			.stat_buf = &stat_buf,
+			.lstat_buf = &lstat_buf,
+			.stat_err = -1,
+			.lstat_err = -1,
+		},
+	};
+
+	return cfprintf(cfile, "%pP\n", &ftwbuf);
+}
+
 int cfreset(CFILE *cfile) {
 	const struct colors *colors = cfile->colors;
 	if (!colors) {
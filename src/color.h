@@ -43,6 +43,10 @@ typedef struct CFILE {
 	const struct colors *colors;
 	/** A buffer for colored formatting. */
 	dchar *buffer;
+	/** The stdio buffer for the underlying stream, if we allocated it. */
+	char *iobuf;
+	/** State for asynchronous output, if enabled (see cfasync()). */
+	struct cfasync *async;
 	/** Cached file descriptor number. */
 	int fd;
 	/** Whether the next ${rs} is actually necessary. */
@@ -75,6 +79,27 @@ CFILE *cfwrap(FILE *file, const struct colors *colors, bool close);
  */
 int cfclose(CFILE *cfile);
 
+/**
+ * Hand off writes to a colored file to a background thread.  Afterwards, only
+ * cfflush() guarantees that previous output has actually been written.
+ *
+ * @cfile
+ *         The colored file to make asynchronous.
+ * @return
+ *         0 on success, -1 on failure (including if it's not supported).
+ */
+int cfasync(CFILE *cfile);
+
+/**
+ * Flush a colored file, waiting for any asynchronous output to be written.
+ *
+ * @cfile
+ *         The colored file to flush.
+ * @return
+ *         0 on success, -1 on failure.
+ */
+int cfflush(CFILE *cfile);
+
 /**
  * Colored, formatted output.
  *
@@ -112,6 +137,19 @@ int cfprintf(CFILE *cfile, const char *format, ...);
 [[_printf(2, 0)]]
 int cvfprintf(CFILE *cfile, const char *format, va_list args);
 
+/**
+ * Print a saved path and a newline, colored like %pP.  The file is stat()ed
+ * again without following links, since only the path was kept.
+ *
+ * @cfile
+ *         The colored stream to print to.
+ * @path
+ *         The path to print.
+ * @return
+ *         0 on success, -1 on failure.
+ */
+int cfputpath(CFILE *cfile, const char *path);
+
 /**
  * Reset the TTY state when terminating abnormally (async-signal-safe).
  */
@@ -0,0 +1,179 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+#include "contains.h"
+
+#include "alloc.h"
+#include "bfs.h"
+#include "bfstd.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/** The size of each read. */
+#define CONTAINS_BUFSIZE (64 << 10)
+
+struct bfs_contains {
+	/** Whether to ignore case. */
+	bool icase;
+	/** Maps each byte to its case-folded equivalent. */
+	unsigned char fold[256];
+	/** How far to shift the window, given its (folded) last byte. */
+	size_t skip[256];
+	/** The length of the needle. */
+	size_t len;
+	/** The (folded) needle itself. */
+	unsigned char needle[];
+};
+
+struct bfs_contains *bfs_contains_new(const char *needle, bool icase) {
+	size_t len = strlen(needle);
+	struct bfs_contains *contains = ALLOC_FLEX(struct bfs_contains, needle, len + 1);
+	if (!contains) {
+		return NULL;
+	}
+
+	contains->icase = icase;
+	contains->len = len;
+
+	for (size_t i = 0; i < countof(contains->fold); ++i) {
+		unsigned char c = i;
+		if (icase && c >= 'A' && c <= 'Z') {
+			c += 'a' - 'A';
+		}
+		contains->fold[i] = c;
+	}
+
+	for (size_t i = 0; i <= len; ++i) {
+		contains->needle[i] = contains->fold[(unsigned char)needle[i]];
+	}
+
+	// Horspool's bad character rule
+	for (size_t i = 0; i < countof(contains->skip); ++i) {
+		contains->skip[i] = len;
+	}
+	for (size_t i = 0; i + 1 < len; ++i) {
+		contains->skip[contains->needle[i]] = len - 1 - i;
+	}
+
+	return contains;
+}
+
+/** Search a buffer for the needle. */
+static bool contains_search(const struct bfs_contains *contains, const unsigned char *buf, size_t size) {
+	const unsigned char *needle = contains->needle;
+	size_t len = contains->len;
+	if (size < len) {
+		return false;
+	}
+
+	// Windows start anywhere in [buf, end)
+	size_t last = len - 1;
+	const unsigned char *end = buf + size - last;
+
+	if (!contains->icase) {
+		// Let memchr(), which is usually vectorized, find the candidates
+		// for the last byte
+		unsigned char c = needle[last];
+		for (const unsigned char *ptr = buf; ptr < end;) {
+			const unsigned char *match = memchr(ptr + last, c, end - ptr);
+			if (!match) {
+				break;
+			}
+
+			ptr = match - last;
+			if (memcmp(ptr, needle, last) == 0) {
+				return true;
+			}
+			ptr += contains->skip[c];
+		}
+
+		return false;
+	}
+
+	const unsigned char *fold = contains->fold;
+	for (const unsigned char *ptr = buf; ptr < end;) {
+		unsigned char c = fold[ptr[last]];
+		if (c == needle[last]) {
+			size_t i = 0;
+			while (i < last && fold[ptr[i]] == needle[i]) {
+				++i;
+			}
+			if (i == last) {
+				return true;
+			}
+		}
+		ptr += contains->skip[c];
+	}
+
+	return false;
+}
+
+int bfs_contains_file(const struct bfs_contains *contains, int at_fd, const char *at_path) {
+	// O_NONBLOCK so we don't hang on FIFOs
+	int fd = openat(at_fd, at_path, O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK);
+	if (fd < 0) {
+		return -1;
+	}
+
+	int ret = -1;
+	unsigned char *buf = NULL;
+
+	struct stat sb;
+	if (fstat(fd, &sb) != 0) {
+		goto done;
+	}
+
+	if (!S_ISREG(sb.st_mode)) {
+		ret = 0;
+		goto done;
+	}
+
+	size_t len = contains->len;
+	if (len == 0) {
+		ret = 1;
+		goto done;
+	}
+
+	// Keep the last len - 1 bytes of each chunk, in case a match spans two reads
+	size_t keep = len - 1;
+	buf = malloc(keep + CONTAINS_BUFSIZE);
+	if (!buf) {
+		goto done;
+	}
+
+	size_t size = 0;
+	while (true) {
+		size_t nread = xread(fd, buf + size, CONTAINS_BUFSIZE);
+		size += nread;
+
+		if (contains_search(contains, buf, size)) {
+			ret = 1;
+			break;
+		}
+
+		if (nread < CONTAINS_BUFSIZE) {
+			if (errno == 0) {
+				ret = 0;
+			}
+			break;
+		}
+
+		if (size > keep) {
+			memmove(buf, buf + size - keep, keep);
+			size = keep;
+		}
+	}
+
+done:
+	free(buf);
+	close_quietly(fd);
+	return ret;
+}
+
+void bfs_contains_free(struct bfs_contains *contains) {
+	free(contains);
+}
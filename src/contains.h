@@ -0,0 +1,48 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+/**
+ * Substring search in file contents, for -contains and -icontains.
+ */
+
+#ifndef BFS_CONTAINS_H
+#define BFS_CONTAINS_H
+
+/**
+ * A compiled search string.
+ */
+struct bfs_contains;
+
+/**
+ * Compile a search string.
+ *
+ * @needle
+ *         The string to search for.
+ * @icase
+ *         Whether to ignore (ASCII) case.
+ * @return
+ *         The compiled search string, or NULL on failure.
+ */
+struct bfs_contains *bfs_contains_new(const char *needle, bool icase);
+
+/**
+ * Search a regular file for a string, stopping at the first match.
+ *
+ * @contains
+ *         The compiled search string.
+ * @at_fd
+ *         The base directory for the path.
+ * @at_path
+ *         The path to the file, relative to at_fd.
+ * @return
+ *         1 if the file contains the string, 0 if it doesn't, or -1 on
+ *         failure.
+ */
+int bfs_contains_file(const struct bfs_contains *contains, int at_fd, const char *at_path);
+
+/**
+ * Free a compiled search string.
+ */
+void bfs_contains_free(struct bfs_contains *contains);
+
+#endif // BFS_CONTAINS_H
@@ -34,7 +34,7 @@ struct bfs_ctx *bfs_ctx_new(void) {
 	ARENA_INIT(&ctx->expr_arena, struct bfs_expr);
 
 	ctx->maxdepth = INT_MAX;
-	ctx->flags = BFTW_RECOVER;
+	ctx->flags = BFTW_RECOVER | BFTW_NLINK;
 	ctx->strategy = BFTW_BFS;
 	ctx->optlevel = 3;
 
@@ -43,6 +43,8 @@ struct bfs_ctx *bfs_ctx_new(void) {
 		// Not much speedup after 8 threads
 		ctx->threads = 8;
 	}
+	ctx->exec_jobs = 1;
+	ctx->filter_timeout = BFS_FILTER_TIMEOUT;
 
 	trie_init(&ctx->files);
 
@@ -167,7 +169,7 @@ void bfs_ctx_flush(const struct bfs_ctx *ctx) {
 	for_trie (leaf, &ctx->files) {
 		struct bfs_ctx_file *ctx_file = leaf->value;
 		CFILE *cfile = ctx_file->cfile;
-		if (fflush(cfile->file) == 0) {
+		if (cfflush(cfile) == 0) {
 			continue;
 		}
 
@@ -195,7 +197,7 @@ static int bfs_ctx_fflush(CFILE *cfile) {
 		ret = -1;
 		error = EIO;
 	}
-	if (fflush(cfile->file) != 0) {
+	if (cfflush(cfile) != 0) {
 		ret = -1;
 		error = errno;
 	}
@@ -286,6 +288,12 @@ int bfs_ctx_free(struct bfs_ctx *ctx) {
 		}
 		free(ctx->paths);
 
+		for (size_t i = 0; i < ctx->nprefixes; ++i) {
+			free(ctx->prefixes[i]);
+		}
+		free(ctx->prefixes);
+		free(ctx->prune_markers);
+
 		free(ctx->kinds);
 		free(ctx->argv);
 		free(ctx);
@@ -21,6 +21,11 @@
 
 struct CFILE;
 
+/**
+ * The default -exec-filter-timeout, in seconds.
+ */
+#define BFS_FILTER_TIMEOUT 60
+
 /**
  * The execution context for bfs.
  */
@@ -50,6 +55,14 @@ struct bfs_ctx {
 	int mindepth;
 	/** -maxdepth option. */
 	int maxdepth;
+	/** Literal -path prefixes that directories must be compatible with. */
+	char **prefixes;
+	/** The number of -path prefixes. */
+	size_t nprefixes;
+	/** Marker files that prune their parent directories (-prune-if-contains). */
+	const char **prune_markers;
+	/** The number of marker files. */
+	size_t nprune_markers;
 
 	/** bftw() flags. */
 	enum bftw_flags flags;
@@ -58,10 +71,16 @@ struct bfs_ctx {
 
 	/** Threads (-j). */
 	int threads;
+	/** Concurrent -exec ... + batches (-exec-jobs). */
+	int exec_jobs;
+	/** Seconds to wait for each -exec-filter verdict, or 0 for no limit (-exec-filter-timeout). */
+	int filter_timeout;
 	/** Optimization level (-O). */
 	int optlevel;
 	/** Debugging flags (-D). */
 	enum debug_flags debug;
+	/** Whether to add up directory disk usage (-du). */
+	bool du;
 	/** Whether to ignore deletions that race with bfs (-ignore_readdir_race). */
 	bool ignore_races;
 	/** Whether to follow POSIXisms more closely ($POSIXLY_CORRECT). */
@@ -111,6 +130,13 @@ struct bfs_ctx {
 	/** The current file creation mask. */
 	mode_t umask;
 
+	/** Whether -readable etc. may be denied based on the permission bits. */
+	bool fast_access;
+	/** Whether -readable etc. may also be granted based on the permission bits. */
+	bool fast_grant;
+	/** The real user ID (for fast_access). */
+	uid_t ruid;
+
 	/** The initial RLIMIT_NOFILE limits. */
 	struct rlimit orig_nofile;
 	/** The current RLIMIT_NOFILE limits. */
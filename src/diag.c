@@ -59,8 +59,13 @@ const char *debug_flag_name(enum debug_flags flag) {
 		return "stat";
 	case DEBUG_TREE:
 		return "tree";
+	case DEBUG_ACCESS:
+		return "access";
+	case DEBUG_DTYPE:
+		return "dtype";
 
 	case DEBUG_ALL:
+	case DEBUG_HOOKS:
 		break;
 	}
 
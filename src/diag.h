@@ -131,6 +131,13 @@ enum debug_flags {
 	DEBUG_TREE   = 1 << 6,
 	/** All debug flags. */
 	DEBUG_ALL    = (1 << 7) - 1,
+
+	/** Test hook: answer -readable etc. from the permission bits. */
+	DEBUG_ACCESS = 1 << 7,
+	/** Test hook: pretend readdir() doesn't return file types. */
+	DEBUG_DTYPE  = 1 << 8,
+	/** All test hooks (not included in DEBUG_ALL). */
+	DEBUG_HOOKS  = DEBUG_ACCESS | DEBUG_DTYPE,
 };
 
 /**
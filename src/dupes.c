@@ -0,0 +1,353 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+#include "dupes.h"
+
+#include "alloc.h"
+#include "bfs.h"
+#include "bfstd.h"
+#include "bftw.h"
+#include "color.h"
+#include "ctx.h"
+#include "diag.h"
+#include "expr.h"
+#include "hash.h"
+#include "idset.h"
+#include "stat.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** The size of the first block, which is compared before the full contents. */
+#define DUPES_HEAD (4 << 10)
+
+/** The number of candidates to read at once. */
+#define DUPES_NFILES 32
+
+/**
+ * A candidate file.
+ */
+struct dupes_entry {
+	/** The size of the file. */
+	uintmax_t size;
+	/** Whether this file starts a new group of duplicates. */
+	bool first;
+	/** The length of the path. */
+	size_t len;
+	/** The path itself. */
+	char path[];
+};
+
+/**
+ * A candidate whose contents are being compared.
+ */
+struct dupes_cand {
+	/** The candidate file. */
+	struct dupes_entry *entry;
+	/** The hash of (part of) its contents. */
+	char hex[BFS_HASH_MAX];
+};
+
+struct bfs_dupes {
+	/** The bfs context, for error reporting. */
+	const struct bfs_ctx *ctx;
+	/** The files with more than one path that have been seen already. */
+	struct idset ids;
+	/** Interns the candidate paths. */
+	struct varena entries;
+	/** The candidate files. */
+	struct dupes_entry **files;
+	/** The number of candidates. */
+	size_t nfiles;
+	/** The confirmed duplicates, grouped together. */
+	struct dupes_entry **found;
+	/** The number of confirmed duplicates. */
+	size_t nfound;
+	/** Hashes the candidates' contents. */
+	struct bfs_hasher *hasher;
+	/** Whether any candidates couldn't be compared. */
+	bool failed;
+};
+
+int bfs_dupes_parse(const struct bfs_ctx *ctx, struct bfs_expr *expr) {
+	struct bfs_dupes *dupes = ZALLOC(struct bfs_dupes);
+	if (!dupes) {
+		bfs_perror(ctx, "zalloc()");
+		return -1;
+	}
+
+	// The traversal is over by the time we compare the candidates, so
+	// read them with as many background threads as bftw() used
+	size_t nthreads = ctx->threads > 1 ? ctx->threads - 1 : 0;
+	dupes->hasher = bfs_hasher_new(nthreads, DUPES_NFILES);
+	if (!dupes->hasher) {
+		bfs_perror(ctx, "bfs_hasher_new()");
+		free(dupes);
+		return -1;
+	}
+
+	dupes->ctx = ctx;
+	idset_init(&dupes->ids);
+	VARENA_INIT(&dupes->entries, struct dupes_entry, path);
+	expr->dupes = dupes;
+	return 0;
+}
+
+int bfs_dupes_add(struct bfs_dupes *dupes, const struct BFTW *ftwbuf, const struct bfs_stat *statbuf) {
+	// Empty files are trivially identical, so don't bother reporting them
+	if (statbuf->size == 0) {
+		return 0;
+	}
+
+	// Hard links to the same file aren't duplicates of each other, and
+	// neither are paths that only reach the same file through symlinks
+	if (statbuf->nlink > 1 || !(ftwbuf->stat_flags & BFS_STAT_NOFOLLOW)) {
+		int ret = idset_insert(&dupes->ids, statbuf->dev, statbuf->ino);
+		if (ret <= 0) {
+			return ret;
+		}
+	}
+
+	const char *path = ftwbuf->path;
+	size_t len = strlen(path);
+	struct dupes_entry *entry = varena_alloc(&dupes->entries, len + 1);
+	if (!entry) {
+		return -1;
+	}
+
+	entry->size = statbuf->size;
+	entry->first = false;
+	entry->len = len;
+	memcpy(entry->path, path, len + 1);
+
+	struct dupes_entry **slot = RESERVE(struct dupes_entry *, &dupes->files, &dupes->nfiles);
+	if (!slot) {
+		varena_free(&dupes->entries, entry, len + 1);
+		return -1;
+	}
+
+	*slot = entry;
+	return 0;
+}
+
+/** qsort() comparator for candidates, to group them by size. */
+static int dupes_size_cmp(const void *a, const void *b) {
+	const struct dupes_entry *lhs = *(const struct dupes_entry *const *)a;
+	const struct dupes_entry *rhs = *(const struct dupes_entry *const *)b;
+
+	// Print the biggest duplicates first
+	if (lhs->size != rhs->size) {
+		return lhs->size > rhs->size ? -1 : 1;
+	}
+
+	return strcmp(lhs->path, rhs->path);
+}
+
+/** qsort() comparator for candidates, to group them by hash. */
+static int dupes_hash_cmp(const void *a, const void *b) {
+	const struct dupes_cand *lhs = a;
+	const struct dupes_cand *rhs = b;
+
+	int ret = strcmp(lhs->hex, rhs->hex);
+	if (ret != 0) {
+		return ret;
+	}
+
+	return strcmp(lhs->entry->path, rhs->entry->path);
+}
+
+/** Report an error hashing a candidate. */
+static void dupes_error(struct bfs_dupes *dupes, const char *path) {
+	const struct bfs_ctx *ctx = dupes->ctx;
+
+	if (ctx->ignore_races && errno_is_like(ENOENT)) {
+		return;
+	}
+
+	if (!ctx->ignore_errors) {
+		bfs_error(ctx, "%pq: %s.\n", path, errstr());
+		dupes->failed = true;
+	}
+}
+
+/** Hash some candidates, dropping the ones that can't be read, and sort them by hash. */
+static size_t dupes_hash_cands(struct bfs_dupes *dupes, struct dupes_cand *cands, size_t n, bool head) {
+	struct bfs_hasher *hasher = dupes->hasher;
+
+	// Prefer a fast hash for the first block, since it only filters
+	// candidates, and a strong one for the full contents
+	enum bfs_hash_algo algo = head ? BFS_XXH64 : BFS_SHA256;
+	uintmax_t limit = head ? DUPES_HEAD : UINTMAX_MAX;
+
+	// Keep several candidates in flight, so their reads overlap with
+	// each other and with hashing
+	size_t window = bfs_hasher_capacity(hasher);
+	struct dupes_cand *retry[DUPES_NFILES];
+	size_t nretry = 0;
+
+	for (size_t i = 0, pending = 0; i < n || nretry > 0 || pending > 0;) {
+		if (pending < window && (nretry > 0 || i < n)) {
+			struct dupes_cand *cand = nretry > 0 ? retry[--nretry] : &cands[i++];
+			bfs_everify(bfs_hasher_push(hasher, algo, AT_FDCWD, cand->entry->path, limit, cand) == 0);
+			++pending;
+			continue;
+		}
+
+		void *ptr;
+		char hex[BFS_HASH_MAX];
+		int ret = bfs_hasher_pop(hasher, &ptr, hex);
+		--pending;
+
+		struct dupes_cand *cand = ptr;
+		if (ret == 0) {
+			memcpy(cand->hex, hex, sizeof(hex));
+		} else if ((errno == EMFILE || errno == ENFILE) && pending > 0) {
+			// Too many open files, so try again with fewer at once
+			window = pending;
+			retry[nretry++] = cand;
+		} else {
+			dupes_error(dupes, cand->entry->path);
+			cand->entry = NULL;
+		}
+	}
+
+	size_t j = 0;
+	for (size_t i = 0; i < n; ++i) {
+		if (cands[i].entry) {
+			cands[j++] = cands[i];
+		}
+	}
+
+	qsort(cands, j, sizeof(*cands), dupes_hash_cmp);
+	return j;
+}
+
+/** Find the end of a run of candidates with the same hash. */
+static size_t dupes_run(const struct dupes_cand *cands, size_t i, size_t n) {
+	size_t j = i + 1;
+	while (j < n && strcmp(cands[i].hex, cands[j].hex) == 0) {
+		++j;
+	}
+	return j;
+}
+
+/** Drop the candidates whose hash is unique. */
+static size_t dupes_keep_runs(struct dupes_cand *cands, size_t n) {
+	size_t k = 0;
+
+	for (size_t i = 0, j; i < n; i = j) {
+		j = dupes_run(cands, i, n);
+		if (j - i < 2) {
+			continue;
+		}
+
+		for (size_t m = i; m < j; ++m) {
+			cands[k++] = cands[m];
+		}
+	}
+
+	return k;
+}
+
+/** Compare a group of candidates with the same size. */
+static int dupes_group(struct bfs_dupes *dupes, struct dupes_entry **files, size_t n) {
+	struct dupes_cand *cands = ALLOC_ARRAY(struct dupes_cand, n);
+	if (!cands) {
+		return -1;
+	}
+
+	for (size_t i = 0; i < n; ++i) {
+		cands[i].entry = files[i];
+	}
+
+	// If the files are small, the first block is the whole file
+	if (files[0]->size > DUPES_HEAD) {
+		n = dupes_hash_cands(dupes, cands, n, true);
+		n = dupes_keep_runs(cands, n);
+	}
+
+	n = dupes_hash_cands(dupes, cands, n, false);
+
+	int ret = 0;
+	for (size_t i = 0, j; i < n; i = j) {
+		j = dupes_run(cands, i, n);
+		if (j - i < 2) {
+			continue;
+		}
+
+		for (size_t k = i; k < j; ++k) {
+			struct dupes_entry **slot = RESERVE(struct dupes_entry *, &dupes->found, &dupes->nfound);
+			if (!slot) {
+				ret = -1;
+				goto done;
+			}
+
+			struct dupes_entry *entry = cands[k].entry;
+			entry->first = k == i;
+			*slot = entry;
+		}
+	}
+
+done:
+	free(cands);
+	return ret;
+}
+
+int bfs_dupes_hash(struct bfs_dupes *dupes) {
+	struct dupes_entry **files = dupes->files;
+	size_t nfiles = dupes->nfiles;
+	qsort(files, nfiles, sizeof(*files), dupes_size_cmp);
+
+	for (size_t i = 0, j; i < nfiles; i = j) {
+		j = i + 1;
+		while (j < nfiles && files[j]->size == files[i]->size) {
+			++j;
+		}
+
+		// Files with a unique size can't have any duplicates
+		if (j - i < 2) {
+			continue;
+		}
+
+		if (dupes_group(dupes, files + i, j - i) != 0) {
+			bfs_perror(dupes->ctx, "-duplicates");
+			return -1;
+		}
+	}
+
+	return dupes->failed ? -1 : 0;
+}
+
+int bfs_dupes_print(const struct bfs_dupes *dupes, CFILE *cfile) {
+	for (size_t i = 0; i < dupes->nfound; ++i) {
+		const struct dupes_entry *entry = dupes->found[i];
+
+		if (entry->first && i > 0) {
+			if (cfprintf(cfile, "\n") != 0) {
+				return -1;
+			}
+		}
+
+		if (cfputpath(cfile, entry->path) != 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+void bfs_dupes_free(struct bfs_dupes *dupes) {
+	if (!dupes) {
+		return;
+	}
+
+	bfs_hasher_free(dupes->hasher);
+	free(dupes->found);
+	free(dupes->files);
+	varena_destroy(&dupes->entries);
+	idset_destroy(&dupes->ids);
+	free(dupes);
+}
@@ -0,0 +1,83 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+/**
+ * Implementation of -duplicates.
+ *
+ * Regular files are collected during the traversal, skipping extra hard links
+ * to files that were already seen.  At the end, only files with the same size
+ * are compared, first by a hash of their first block, and then by a hash of
+ * their full contents.  Several candidates are read in parallel while they're
+ * hashed.
+ */
+
+#ifndef BFS_DUPES_H
+#define BFS_DUPES_H
+
+#include "color.h"
+
+struct BFTW;
+struct bfs_ctx;
+struct bfs_expr;
+struct bfs_stat;
+
+/**
+ * The candidates for -duplicates.
+ */
+struct bfs_dupes;
+
+/**
+ * Set up the -duplicates state.
+ *
+ * @ctx
+ *         The bfs context.
+ * @expr
+ *         The expression to fill in.
+ * @return
+ *         0 on success, -1 on failure.
+ */
+int bfs_dupes_parse(const struct bfs_ctx *ctx, struct bfs_expr *expr);
+
+/**
+ * Add a regular file to the candidates.
+ *
+ * @dupes
+ *         The -duplicates state.
+ * @ftwbuf
+ *         The bftw() data for the current file.
+ * @statbuf
+ *         The stat() buffer for the current file.
+ * @return
+ *         0 on success, -1 on failure.
+ */
+int bfs_dupes_add(struct bfs_dupes *dupes, const struct BFTW *ftwbuf, const struct bfs_stat *statbuf);
+
+/**
+ * Compare the contents of the candidates.
+ *
+ * @dupes
+ *         The -duplicates state.
+ * @return
+ *         0 on success, -1 if any files couldn't be compared.  Errors are
+ *         reported as they happen.
+ */
+int bfs_dupes_hash(struct bfs_dupes *dupes);
+
+/**
+ * Print the groups of duplicate files, separated by blank lines.
+ *
+ * @dupes
+ *         The -duplicates state, after bfs_dupes_hash().
+ * @cfile
+ *         The stream to print to.
+ * @return
+ *         0 on success, -1 on failure.
+ */
+int bfs_dupes_print(const struct bfs_dupes *dupes, CFILE *cfile);
+
+/**
+ * Free the -duplicates state.
+ */
+void bfs_dupes_free(struct bfs_dupes *dupes);
+
+#endif // BFS_DUPES_H
@@ -7,25 +7,35 @@
 
 #include "eval.h"
 
+#include "alloc.h"
 #include "atomic.h"
 #include "bar.h"
 #include "bfs.h"
 #include "bfstd.h"
 #include "bftw.h"
 #include "color.h"
+#include "contains.h"
 #include "ctx.h"
 #include "diag.h"
 #include "dir.h"
 #include "dstring.h"
+#include "dupes.h"
 #include "exec.h"
 #include "expr.h"
 #include "fsade.h"
+#include "hash.h"
+#include "idset.h"
 #include "mtab.h"
+#include "printbin.h"
+#include "printjson.h"
 #include "printf.h"
 #include "pwcache.h"
 #include "sanity.h"
 #include "sighook.h"
+#include "sort.h"
 #include "stat.h"
+#include "summary.h"
+#include "top.h"
 #include "trie.h"
 #include "xregex.h"
 #include "xtime.h"
@@ -43,6 +53,7 @@
 #include <string.h>
 #include <strings.h>
 #include <sys/resource.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <time.h>
@@ -66,6 +77,8 @@ struct bfs_eval {
 	size_t *nerrors;
 	/** Whether to quit immediately. */
 	bool quit;
+	/** The disk usage of the current file and its descendants, for -du. */
+	uintmax_t du;
 };
 
 /**
@@ -188,11 +201,115 @@ bool eval_false(const struct bfs_expr *expr, struct bfs_eval *state) {
 	return false;
 }
 
+/**
+ * Check whether a filesystem's permissions are fully described by the mode
+ * bits and POSIX ACLs.  Network and FUSE filesystems may make their own
+ * decisions, so we only trust a few local ones.
+ */
+static bool eval_posix_fstype(const char *type) {
+	static const char *const types[] = {
+		"btrfs",
+		"ext2",
+		"ext3",
+		"ext4",
+		"f2fs",
+		"tmpfs",
+		"xfs",
+	};
+
+	for (size_t i = 0; i < countof(types); ++i) {
+		if (strcmp(type, types[i]) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Try to answer an access check from the cached stat() info.
+ *
+ * @return
+ *         1 if access is granted, 0 if denied, or -1 if we can't tell.
+ */
+static int eval_access_fast(const struct bfs_ctx *ctx, const struct BFTW *ftwbuf, int amode) {
+	if (!ctx->fast_access) {
+		return -1;
+	}
+
+	// faccessat() follows symlinks
+	const struct bfs_stat *statbuf = bftw_cached_stat(ftwbuf, BFS_STAT_FOLLOW);
+	if (!statbuf) {
+		return -1;
+	}
+
+	const struct bfs_mtab *mtab = bfs_ctx_mtab(ctx);
+	if (!mtab) {
+		return -1;
+	}
+
+	const char *type = bfs_fstype(mtab, statbuf);
+	if (!type || !eval_posix_fstype(type)) {
+		return -1;
+	}
+
+	mode_t want = 0;
+	if (amode & R_OK) {
+		want |= S_IROTH;
+	}
+	if (amode & W_OK) {
+		want |= S_IWOTH;
+	}
+	if (amode & X_OK) {
+		want |= S_IXOTH;
+	}
+
+	mode_t mode = statbuf->mode;
+	if (statbuf->uid != ctx->ruid) {
+		// With an ACL, named users and groups are limited by the group
+		// bits (the ACL mask), and everyone else gets the other bits.
+		// But we don't know which entry applies without reading the
+		// ACL, so we can only prove that access is denied.
+		mode_t group = (mode >> 3) & want;
+		mode_t other = mode & want;
+		if (group != want && other != want) {
+			return 0;
+		} else {
+			return -1;
+		}
+	}
+
+	// The owner bits apply to the owner even if there is an ACL
+	mode_t owner = (mode >> 6) & want;
+	if (owner != want) {
+		return 0;
+	}
+
+	if (amode & W_OK) {
+		// Read-only mounts and immutable files deny writes
+		return -1;
+	}
+
+	if ((amode & X_OK) && !S_ISDIR(mode)) {
+		// noexec mounts deny execution
+		return -1;
+	}
+
+	// A security module may still deny access
+	return ctx->fast_grant ? 1 : -1;
+}
+
 /**
  * -executable, -readable, -writable tests.
  */
 bool eval_access(const struct bfs_expr *expr, struct bfs_eval *state) {
 	const struct BFTW *ftwbuf = state->ftwbuf;
+
+	int ret = eval_access_fast(state->ctx, ftwbuf, expr->num);
+	if (ret >= 0) {
+		return ret;
+	}
+
 	return xfaccessat(ftwbuf->at_fd, ftwbuf->at_path, expr->num) == 0;
 }
 
@@ -222,6 +339,22 @@ bool eval_capable(const struct bfs_expr *expr, struct bfs_eval *state) {
 	}
 }
 
+/**
+ * -i?contains test.
+ */
+bool eval_contains(const struct bfs_expr *expr, struct bfs_eval *state) {
+	const struct BFTW *ftwbuf = state->ftwbuf;
+	if (bftw_type(ftwbuf, ftwbuf->stat_flags) != BFS_REG) {
+		return false;
+	}
+
+	int ret = bfs_contains_file(expr->contains, ftwbuf->at_fd, ftwbuf->at_path);
+	if (ret < 0) {
+		eval_report_error(state);
+	}
+	return ret > 0;
+}
+
 /**
  * -context test.
  */
@@ -397,7 +530,15 @@ bool eval_delete(const struct bfs_expr *expr, struct bfs_eval *state) {
 		return false;
 	}
 
-	if (unlinkat(ftwbuf->at_fd, ftwbuf->at_path, flag) != 0) {
+	int ret;
+	if (expr->delete_async) {
+		// Errors from the background are reported by eval_unlink_error()
+		ret = bftw_unlink(ftwbuf, flag);
+	} else {
+		ret = unlinkat(ftwbuf->at_fd, ftwbuf->at_path, flag);
+	}
+
+	if (ret != 0) {
 		eval_report_error(state);
 		return false;
 	}
@@ -405,6 +546,29 @@ bool eval_delete(const struct bfs_expr *expr, struct bfs_eval *state) {
 	return true;
 }
 
+/**
+ * -du action.
+ */
+bool eval_du(const struct bfs_expr *expr, struct bfs_eval *state) {
+	CFILE *cfile = expr->cfile;
+
+	// Round up to KiB, like du
+	uintmax_t kib = (state->du + 1023) / 1024;
+	if (fprintf(cfile->file, "%ju\t", kib) < 0) {
+		goto error;
+	}
+
+	if (cfprintf(cfile, "%pP\n", state->ftwbuf) < 0) {
+		goto error;
+	}
+
+	return true;
+
+error:
+	eval_io_error(expr, state);
+	return true;
+}
+
 /** Finish any pending -exec ... + operations. */
 static int eval_exec_finish(const struct bfs_expr *expr, const struct bfs_ctx *ctx) {
 	int ret = 0;
@@ -463,7 +627,7 @@ bool eval_empty(const struct bfs_expr *expr, struct bfs_eval *state) {
 	const struct bfs_stat *statbuf;
 	struct bfs_dir *dir;
 
-	switch (ftwbuf->type) {
+	switch (bftw_type(ftwbuf, ftwbuf->stat_flags)) {
 	case BFS_REG:
 		statbuf = eval_stat(state);
 		return statbuf && statbuf->size == 0;
@@ -601,7 +765,7 @@ bool eval_lname(const struct bfs_expr *expr, struct bfs_eval *state) {
 	char *name = NULL;
 
 	const struct BFTW *ftwbuf = state->ftwbuf;
-	if (ftwbuf->type != BFS_LNK) {
+	if (bftw_type(ftwbuf, ftwbuf->stat_flags) != BFS_LNK) {
 		goto done;
 	}
 
@@ -704,29 +868,50 @@ static int print_owner(FILE *file, const char *name, uintmax_t id, int *width) {
 	}
 }
 
+/** A cached -ls timestamp. */
+struct ls_time_cache {
+	/** Whether the cache is filled. */
+	bool valid;
+	/** Whether the time was within the last six months. */
+	bool recent;
+	/** The first second of the cached minute. */
+	time_t start;
+	/** The formatted time. */
+	char str[256];
+};
+
 /** Print a file's modification time. */
 static int print_time(FILE *file, time_t time, time_t now) {
+	// Most files share the same few minutes, so cache the formatted time
+	static thread_local struct ls_time_cache cache;
+
 	struct tm tm;
-	if (!localtime_r(&time, &tm)) {
+	if (!xlocaltime(&time, &tm)) {
 		goto error;
 	}
 
-	char time_str[256];
-	size_t time_ret;
-
 	time_t six_months_ago = now - 6 * 30 * 24 * 60 * 60;
 	time_t tomorrow = now + 24 * 60 * 60;
-	if (time <= six_months_ago || time >= tomorrow) {
-		time_ret = strftime(time_str, sizeof(time_str), "%b %e  %Y", &tm);
-	} else {
-		time_ret = strftime(time_str, sizeof(time_str), "%b %e %H:%M", &tm);
-	}
+	bool recent = time > six_months_ago && time < tomorrow;
+	time_t start = time - tm.tm_sec;
 
-	if (time_ret == 0) {
-		goto error;
+	if (!cache.valid || cache.recent != recent || cache.start != start) {
+		size_t time_ret;
+		if (recent) {
+			time_ret = strftime(cache.str, sizeof(cache.str), "%b %e %H:%M", &tm);
+		} else {
+			time_ret = strftime(cache.str, sizeof(cache.str), "%b %e  %Y", &tm);
+		}
+
+		cache.valid = time_ret != 0;
+		if (!cache.valid) {
+			goto error;
+		}
+		cache.recent = recent;
+		cache.start = start;
 	}
 
-	return fprintf(file, " %s", time_str);
+	return fprintf(file, " %s", cache.str);
 
 error:
 	return fprintf(file, " %jd", (intmax_t)time);
@@ -773,7 +958,8 @@ bool eval_fls(const struct bfs_expr *expr, struct bfs_eval *state) {
 		goto error;
 	}
 
-	if (ftwbuf->type == BFS_BLK || ftwbuf->type == BFS_CHR) {
+	enum bfs_type type = bftw_type(ftwbuf, ftwbuf->stat_flags);
+	if (type == BFS_BLK || type == BFS_CHR) {
 		int ma = xmajor(statbuf->rdev);
 		int mi = xminor(statbuf->rdev);
 		if (fprintf(file, " %3d, %3d", ma, mi) < 0) {
@@ -796,7 +982,7 @@ bool eval_fls(const struct bfs_expr *expr, struct bfs_eval *state) {
 		goto error;
 	}
 
-	if (ftwbuf->type == BFS_LNK) {
+	if (type == BFS_LNK) {
 		if (cfprintf(cfile, " -> %pL", ftwbuf) < 0) {
 			goto error;
 		}
@@ -818,7 +1004,19 @@ error:
  * -f?print action.
  */
 bool eval_fprint(const struct bfs_expr *expr, struct bfs_eval *state) {
-	if (cfprintf(expr->cfile, "%pP\n", state->ftwbuf) < 0) {
+	CFILE *cfile = expr->cfile;
+	if (cfile->colors) {
+		if (cfprintf(cfile, "%pP\n", state->ftwbuf) < 0) {
+			eval_io_error(expr, state);
+		}
+		return true;
+	}
+
+	// Without colors, skip the formatting and copy the path directly
+	FILE *file = cfile->file;
+	const char *path = state->ftwbuf->path;
+	size_t length = strlen(path);
+	if (fwrite(path, 1, length, file) != length || putc('\n', file) == EOF) {
 		eval_io_error(expr, state);
 	}
 	return true;
@@ -884,6 +1082,58 @@ error:
 	return true;
 }
 
+/**
+ * -f?printjson action.
+ */
+bool eval_fprintjson(const struct bfs_expr *expr, struct bfs_eval *state) {
+	const struct BFTW *ftwbuf = state->ftwbuf;
+	const struct bfs_stat *statbuf = eval_stat(state);
+	if (!statbuf) {
+		return true;
+	}
+
+	char *target = NULL;
+	if (S_ISLNK(statbuf->mode)) {
+		target = xreadlinkat(ftwbuf->at_fd, ftwbuf->at_path, statbuf->size);
+		if (!target) {
+			eval_report_error(state);
+		}
+	}
+
+	if (bfs_printjson(expr->cfile, ftwbuf, statbuf, target) != 0) {
+		eval_io_error(expr, state);
+	}
+
+	free(target);
+	return true;
+}
+
+/**
+ * -fprintbin action.
+ */
+bool eval_fprintbin(const struct bfs_expr *expr, struct bfs_eval *state) {
+	const struct BFTW *ftwbuf = state->ftwbuf;
+	const struct bfs_stat *statbuf = eval_stat(state);
+	if (!statbuf) {
+		return true;
+	}
+
+	char *target = NULL;
+	if (S_ISLNK(statbuf->mode)) {
+		target = xreadlinkat(ftwbuf->at_fd, ftwbuf->at_path, statbuf->size);
+		if (!target) {
+			eval_report_error(state);
+		}
+	}
+
+	if (bfs_printbin(expr->printbin, ftwbuf, statbuf, target) != 0) {
+		eval_io_error(expr, state);
+	}
+
+	free(target);
+	return true;
+}
+
 /**
  * -limit action.
  */
@@ -905,6 +1155,48 @@ bool eval_prune(const struct bfs_expr *expr, struct bfs_eval *state) {
 	return true;
 }
 
+/**
+ * -duplicates action.
+ */
+bool eval_duplicates(const struct bfs_expr *expr, struct bfs_eval *state) {
+	const struct BFTW *ftwbuf = state->ftwbuf;
+	if (bftw_type(ftwbuf, ftwbuf->stat_flags) != BFS_REG) {
+		return true;
+	}
+
+	const struct bfs_stat *statbuf = eval_stat(state);
+	if (!statbuf) {
+		return true;
+	}
+
+	if (bfs_dupes_add(expr->dupes, ftwbuf, statbuf) != 0) {
+		eval_report_error(state);
+	}
+
+	return true;
+}
+
+/**
+ * -hash action.
+ */
+bool eval_hash(const struct bfs_expr *expr, struct bfs_eval *state) {
+	const struct BFTW *ftwbuf = state->ftwbuf;
+	if (bftw_type(ftwbuf, ftwbuf->stat_flags) != BFS_REG) {
+		return true;
+	}
+
+	char hex[BFS_HASH_MAX];
+	if (bfs_hasher_file(expr->hasher, expr->hash_algo, ftwbuf->at_fd, ftwbuf->at_path, hex) != 0) {
+		eval_report_error(state);
+		return true;
+	}
+
+	if (cfprintf(expr->cfile, "%s  %pP\n", hex, ftwbuf) < 0) {
+		eval_io_error(expr, state);
+	}
+	return true;
+}
+
 /**
  * -quit action.
  */
@@ -914,6 +1206,101 @@ bool eval_quit(const struct bfs_expr *expr, struct bfs_eval *state) {
 	return true;
 }
 
+/**
+ * -sort-by action.
+ */
+bool eval_sort_by(const struct bfs_expr *expr, struct bfs_eval *state) {
+	const struct bfs_stat *statbuf = NULL;
+	if (bfs_sort_needs_stat(expr->sort)) {
+		statbuf = eval_stat(state);
+		if (!statbuf) {
+			return true;
+		}
+	}
+
+	if (bfs_sort_add(expr->sort, state->ftwbuf, statbuf) != 0) {
+		eval_report_error(state);
+	}
+
+	return true;
+}
+
+/**
+ * -summarize action.
+ */
+bool eval_summarize(const struct bfs_expr *expr, struct bfs_eval *state) {
+	const struct bfs_stat *statbuf = eval_stat(state);
+	if (!statbuf) {
+		return true;
+	}
+
+	if (bfs_summary_add(expr->summary, state->ftwbuf, statbuf) != 0) {
+		eval_report_error(state);
+	}
+
+	return true;
+}
+
+/**
+ * -top action.
+ */
+bool eval_top(const struct bfs_expr *expr, struct bfs_eval *state) {
+	const struct bfs_stat *statbuf = NULL;
+	if (bfs_top_needs_stat(expr->top)) {
+		statbuf = eval_stat(state);
+		if (!statbuf) {
+			return true;
+		}
+	}
+
+	if (bfs_top_add(expr->top, state->ftwbuf, statbuf) != 0) {
+		eval_report_error(state);
+	}
+
+	return true;
+}
+
+/**
+ * Print the -duplicates, -sort-by, -summarize, and -top results at the end of
+ * the traversal.
+ */
+static int eval_print_finish(const struct bfs_expr *expr, const struct bfs_ctx *ctx) {
+	int ret = 0;
+	bool failed = false;
+	if (expr->eval_fn == eval_duplicates) {
+		// Errors comparing the candidates are reported separately
+		failed = bfs_dupes_hash(expr->dupes) != 0;
+		ret = bfs_dupes_print(expr->dupes, expr->cfile);
+	} else if (expr->eval_fn == eval_sort_by) {
+		ret = bfs_sort_print(expr->sort, expr->cfile);
+	} else if (expr->eval_fn == eval_summarize) {
+		ret = bfs_summary_print(expr->summary, expr->cfile);
+	} else if (expr->eval_fn == eval_top) {
+		ret = bfs_top_print(expr->top, expr->cfile);
+	}
+
+	if (ret != 0) {
+		if (expr->path) {
+			bfs_error(ctx, "'%s': %s.\n", expr->path, errstr());
+		} else {
+			bfs_error(ctx, "(standard output): %s.\n", errstr());
+		}
+		clearerr(expr->cfile->file);
+	}
+
+	if (failed) {
+		ret = -1;
+	}
+
+	for_expr (child, expr) {
+		if (eval_print_finish(child, ctx) != 0) {
+			ret = -1;
+		}
+	}
+
+	return ret;
+}
+
 /**
  * -i?regex test.
  */
@@ -977,7 +1364,14 @@ bool eval_sparse(const struct bfs_expr *expr, struct bfs_eval *state) {
  * -type test.
  */
 bool eval_type(const struct bfs_expr *expr, struct bfs_eval *state) {
-	return (1 << state->ftwbuf->type) & expr->num;
+	const struct BFTW *ftwbuf = state->ftwbuf;
+	enum bfs_type type = bftw_type(ftwbuf, ftwbuf->stat_flags);
+	if (type == BFS_ERROR) {
+		eval_report_error(state);
+		return false;
+	}
+
+	return (1 << type) & expr->num;
 }
 
 /**
@@ -1220,26 +1614,20 @@ out:
 }
 
 /** Check if we've seen a file before. */
-static bool eval_file_unique(struct bfs_eval *state, struct trie *seen) {
+static bool eval_file_unique(struct bfs_eval *state, struct idset *seen) {
 	const struct bfs_stat *statbuf = eval_stat(state);
 	if (!statbuf) {
 		return false;
 	}
 
-	bfs_file_id id;
-	bfs_stat_id(statbuf, &id);
-
-	struct trie_leaf *leaf = trie_insert_mem(seen, id, sizeof(id));
-	if (!leaf) {
+	int ret = idset_insert(seen, statbuf->dev, statbuf->ino);
+	if (ret < 0) {
 		eval_report_error(state);
 		return false;
-	}
-
-	if (leaf->value) {
+	} else if (ret == 0) {
 		state->action = BFTW_PRUNE;
 		return false;
 	} else {
-		leaf->value = leaf;
 		return true;
 	}
 }
@@ -1356,6 +1744,118 @@ static const char *dump_bftw_action(enum bftw_action action) {
 	return actions[action];
 }
 
+/**
+ * Running totals for -du.
+ */
+struct eval_du {
+	/** Pending totals for directories that are still being walked. */
+	struct trie dirs;
+	/** Storage for the totals. */
+	struct arena totals;
+	/** Multiply-linked files that have already been counted. */
+	struct idset links;
+	/** Buffer for directory keys. */
+	dchar *key;
+};
+
+/** Initialize the -du totals. */
+static void eval_du_init(struct eval_du *du) {
+	trie_init(&du->dirs);
+	ARENA_INIT(&du->totals, uintmax_t);
+	idset_init(&du->links);
+	du->key = NULL;
+}
+
+/** Destroy the -du totals. */
+static void eval_du_destroy(struct eval_du *du) {
+	dstrfree(du->key);
+	idset_destroy(&du->links);
+	arena_destroy(&du->totals);
+	trie_destroy(&du->dirs);
+}
+
+/** Get the disk usage of a single file. */
+static uintmax_t eval_du_file(struct bfs_eval *state, struct eval_du *du) {
+	const struct bfs_stat *statbuf = eval_stat(state);
+	if (!statbuf) {
+		return 0;
+	}
+
+	// Only count each hard-linked file once, like du
+	if (!S_ISDIR(statbuf->mode) && statbuf->nlink > 1) {
+		int ret = idset_insert(&du->links, statbuf->dev, statbuf->ino);
+		if (ret < 0) {
+			eval_report_error(state);
+		}
+		if (ret <= 0) {
+			return 0;
+		}
+	}
+
+	return (uintmax_t)statbuf->blocks * BFS_STAT_BLKSIZE;
+}
+
+/**
+ * Compute the disk usage of the current file, and add it to its parent's total.
+ *
+ * Directories are keyed by their path with a trailing slash, which matches the
+ * path of each child up to its nameoff.  A directory's total is complete by
+ * the time it is visited in post-order, so the pending totals only cover the
+ * directories that are still being walked.
+ */
+static void eval_du_add(struct bfs_eval *state, struct eval_du *du) {
+	const struct BFTW *ftwbuf = state->ftwbuf;
+	state->du = eval_du_file(state, du);
+
+	if (ftwbuf->type == BFS_DIR) {
+		if (dstrcpy(&du->key, ftwbuf->path) != 0) {
+			goto fail;
+		}
+		size_t len = dstrlen(du->key);
+		if (len > 0 && du->key[len - 1] != '/' && dstrapp(&du->key, '/') != 0) {
+			goto fail;
+		}
+
+		struct trie_leaf *leaf = trie_find_str(&du->dirs, du->key);
+		if (leaf) {
+			uintmax_t *total = leaf->value;
+			state->du += *total;
+			arena_free(&du->totals, total);
+			trie_remove(&du->dirs, leaf);
+		}
+	}
+
+	if (ftwbuf->depth == 0) {
+		return;
+	}
+
+	if (dstrncpy(&du->key, ftwbuf->path, ftwbuf->nameoff) != 0) {
+		goto fail;
+	}
+
+	struct trie_leaf *leaf = trie_insert_str(&du->dirs, du->key);
+	if (!leaf) {
+		goto fail;
+	}
+
+	uintmax_t *total = leaf->value;
+	if (!total) {
+		total = arena_alloc(&du->totals);
+		if (!total) {
+			trie_remove(&du->dirs, leaf);
+			goto fail;
+		}
+		*total = 0;
+		leaf->value = total;
+	}
+
+	*total += state->du;
+	return;
+
+fail:
+	eval_report_error(state);
+}
+
 /**
  * Type passed as the argument to the bftw() callback.
  */
@@ -1378,7 +1878,9 @@ struct callback_args {
 	size_t count;
 
 	/** The set of seen files. */
-	struct trie *seen;
+	struct idset *seen;
+	/** The -du totals. */
+	struct eval_du *du;
 
 	/** The number of errors that have occurred. */
 	size_t nerrors;
@@ -1444,6 +1946,38 @@ static void eval_hide_bar(struct callback_args *args) {
 	args->bar = NULL;
 }
 
+/**
+ * Check whether a directory may contain files that match the -path prefixes.
+ */
+static bool eval_prefixes(const struct bfs_ctx *ctx, const struct BFTW *ftwbuf) {
+	if (ctx->nprefixes == 0) {
+		return true;
+	}
+
+	const char *path = ftwbuf->path;
+	size_t len = strlen(path);
+	bool slash = len > 0 && path[len - 1] == '/';
+
+	for (size_t i = 0; i < ctx->nprefixes; ++i) {
+		const char *prefix = ctx->prefixes[i];
+		size_t plen = strlen(prefix);
+
+		// Children have paths like "$path/$name", so check whether that
+		// is compatible with the prefix
+		if (plen <= len) {
+			if (memcmp(path, prefix, plen) == 0) {
+				return true;
+			}
+		} else if (memcmp(path, prefix, len) == 0) {
+			if (slash || prefix[len] == '/') {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
 /**
  * bftw() callback.
  */
@@ -1460,6 +1994,7 @@ static enum bftw_action eval_callback(const struct BFTW *ftwbuf, void *ptr) {
 	state.ret = &args->ret;
 	state.nerrors = &args->nerrors;
 	state.quit = false;
+	state.du = 0;
 
 	// Check whether SIGINFO was delivered and show/hide the bar
 	if (exchange(&args->info_flag, false, relaxed)) {
@@ -1511,6 +2046,8 @@ static enum bftw_action eval_callback(const struct BFTW *ftwbuf, void *ptr) {
 
 	if (ctx->maxdepth < 0 || ftwbuf->depth >= (size_t)ctx->maxdepth) {
 		state.action = BFTW_PRUNE;
+	} else if (ftwbuf->type == BFS_DIR && !eval_prefixes(ctx, ftwbuf)) {
+		state.action = BFTW_PRUNE;
 	}
 
 	// In -depth mode, only handle directories on the BFTW_POST visit
@@ -1521,6 +2058,10 @@ static enum bftw_action eval_callback(const struct BFTW *ftwbuf, void *ptr) {
 		expected_visit = BFTW_POST;
 	}
 
+	if (ctx->du && ftwbuf->visit == expected_visit) {
+		eval_du_add(&state, args->du);
+	}
+
 	if (ftwbuf->visit == expected_visit
 	    && ftwbuf->depth >= (size_t)ctx->mindepth
 	    && ftwbuf->depth <= (size_t)ctx->maxdepth) {
@@ -1543,6 +2084,23 @@ done:
 	return state.action;
 }
 
+/** bftw() callback for asynchronous -delete errors. */
+static void eval_unlink_error(const struct BFTW *ftwbuf, void *ptr) {
+	struct callback_args *args = ptr;
+
+	struct bfs_eval state;
+	state.ftwbuf = ftwbuf;
+	state.ctx = args->ctx;
+	state.action = BFTW_CONTINUE;
+	state.ret = &args->ret;
+	state.nerrors = &args->nerrors;
+	state.quit = false;
+	state.du = 0;
+
+	errno = ftwbuf->error;
+	eval_report_error(&state);
+}
+
 #if BFS_HAS_SYSCTLBYNAME
 /** Simple wrapper over sysctlbyname() that only reads. */
 static int xsysctl(const char *name, void *ptr, size_t size) {
@@ -1714,6 +2272,9 @@ static void dump_bftw_flags(enum bftw_flags flags) {
 	DEBUG_FLAG(flags, BFTW_SORT);
 	DEBUG_FLAG(flags, BFTW_BUFFER);
 	DEBUG_FLAG(flags, BFTW_WHITEOUTS);
+	DEBUG_FLAG(flags, BFTW_NLINK);
+	DEBUG_FLAG(flags, BFTW_IGNORE_VCS);
+	DEBUG_FLAG(flags, BFTW_NO_DTYPE);
 
 	bfs_assert(flags == 0, "Missing bftw flag 0x%X", flags);
 }
@@ -1757,11 +2318,33 @@ static bool eval_must_buffer(const struct bfs_expr *expr) {
 	return false;
 }
 
+/** Move output to a background thread if it might block. */
+static void eval_async_output(const struct bfs_ctx *ctx) {
+	if (ctx->threads <= 1) {
+		return;
+	}
+
+	// A slow reader on a pipe or socket would otherwise stall the search
+	CFILE *cout = ctx->cout;
+	struct stat sb;
+	if (fstat(cout->fd, &sb) != 0) {
+		return;
+	}
+	if (!S_ISFIFO(sb.st_mode) && !S_ISSOCK(sb.st_mode)) {
+		return;
+	}
+
+	// On failure, we can keep writing synchronously
+	cfasync(cout);
+}
+
 int bfs_eval(struct bfs_ctx *ctx) {
 	if (!ctx->expr) {
 		return EXIT_SUCCESS;
 	}
 
+	eval_async_output(ctx);
+
 	struct callback_args args = {
 		.ctx = ctx,
 		.ret = EXIT_SUCCESS,
@@ -1778,12 +2361,18 @@ int bfs_eval(struct bfs_ctx *ctx) {
 #endif
 	struct sighook *info_hook = sighook(siginfo, eval_siginfo, &args, SH_CONTINUE);
 
-	struct trie seen;
+	struct idset seen;
 	if (ctx->unique) {
-		trie_init(&seen);
+		idset_init(&seen);
 		args.seen = &seen;
 	}
 
+	struct eval_du du;
+	if (ctx->du) {
+		eval_du_init(&du);
+		args.du = &du;
+	}
+
 	int fdlimit = raise_fdlimit(ctx);
 	reserve_fds(fdlimit);
 	fdlimit = infer_fdlimit(ctx, fdlimit);
@@ -1796,17 +2385,24 @@ int bfs_eval(struct bfs_ctx *ctx) {
 		.npaths = ctx->npaths,
 		.callback = eval_callback,
 		.ptr = &args,
+		.unlink_error = eval_unlink_error,
 		.nopenfd = fdlimit,
 		.nthreads = nthreads,
 		.flags = ctx->flags,
 		.strategy = ctx->strategy,
 		.mtab = bfs_ctx_mtab(ctx),
+		.prune_markers = ctx->prune_markers,
+		.nprune_markers = ctx->nprune_markers,
 	};
 
 	if (eval_must_buffer(ctx->expr)) {
 		bftw_args.flags |= BFTW_BUFFER;
 	}
 
+	if (ctx->debug & DEBUG_DTYPE) {
+		bftw_args.flags |= BFTW_NO_DTYPE;
+	}
+
 	if (bfs_debug(ctx, DEBUG_SEARCH, "bftw({\n")) {
 		fprintf(stderr, "\t.paths = {\n");
 		for (size_t i = 0; i < bftw_args.npaths; ++i) {
@@ -1816,6 +2412,7 @@ int bfs_eval(struct bfs_ctx *ctx) {
 		fprintf(stderr, "\t.npaths = %zu,\n", bftw_args.npaths);
 		fprintf(stderr, "\t.callback = eval_callback,\n");
 		fprintf(stderr, "\t.ptr = &args,\n");
+		fprintf(stderr, "\t.unlink_error = eval_unlink_error,\n");
 		fprintf(stderr, "\t.nopenfd = %d,\n", bftw_args.nopenfd);
 		fprintf(stderr, "\t.nthreads = %d,\n", bftw_args.nthreads);
 		fprintf(stderr, "\t.flags = ");
@@ -1827,7 +2424,12 @@ int bfs_eval(struct bfs_ctx *ctx) {
 		} else {
 			fprintf(stderr, "NULL");
 		}
-		fprintf(stderr, ",\n})\n");
+		fprintf(stderr, ",\n\t.prune_markers = {\n");
+		for (size_t i = 0; i < bftw_args.nprune_markers; ++i) {
+			fprintf(stderr, "\t\t\"%s\",\n", bftw_args.prune_markers[i]);
+		}
+		fprintf(stderr, "\t},\n");
+		fprintf(stderr, "\t.nprune_markers = %zu,\n})\n", bftw_args.nprune_markers);
 	}
 
 	if (bftw(&bftw_args) != 0) {
@@ -1839,10 +2441,20 @@ int bfs_eval(struct bfs_ctx *ctx) {
 		args.ret = EXIT_FAILURE;
 	}
 
+	if (eval_print_finish(ctx->expr, ctx) != 0) {
+		args.ret = EXIT_FAILURE;
+	}
+
 	bfs_ctx_dump(ctx, DEBUG_RATES);
 
 	if (ctx->unique) {
-		trie_destroy(&seen);
+		bfs_debug(ctx, DEBUG_RATES, "${blu}-unique${rs}: ${ylw}%zu${rs} files, ${ylw}%zu${rs} bytes\n",
+			seen.size, idset_memory(&seen));
+		idset_destroy(&seen);
+	}
+
+	if (ctx->du) {
+		eval_du_destroy(&du);
 	}
 
 	sigunhook(info_hook);
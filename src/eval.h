@@ -47,6 +47,7 @@ bool eval_false(const struct bfs_expr *expr, struct bfs_eval *state);
 bool eval_access(const struct bfs_expr *expr, struct bfs_eval *state);
 bool eval_acl(const struct bfs_expr *expr, struct bfs_eval *state);
 bool eval_capable(const struct bfs_expr *expr, struct bfs_eval *state);
+bool eval_contains(const struct bfs_expr *expr, struct bfs_eval *state);
 bool eval_context(const struct bfs_expr *expr, struct bfs_eval *state);
 bool eval_perm(const struct bfs_expr *expr, struct bfs_eval *state);
 bool eval_xattr(const struct bfs_expr *expr, struct bfs_eval *state);
@@ -80,6 +81,8 @@ bool eval_path(const struct bfs_expr *expr, struct bfs_eval *state);
 bool eval_regex(const struct bfs_expr *expr, struct bfs_eval *state);
 
 bool eval_delete(const struct bfs_expr *expr, struct bfs_eval *state);
+bool eval_du(const struct bfs_expr *expr, struct bfs_eval *state);
+bool eval_duplicates(const struct bfs_expr *expr, struct bfs_eval *state);
 bool eval_exec(const struct bfs_expr *expr, struct bfs_eval *state);
 bool eval_exit(const struct bfs_expr *expr, struct bfs_eval *state);
 bool eval_fls(const struct bfs_expr *expr, struct bfs_eval *state);
@@ -87,9 +90,15 @@ bool eval_fprint(const struct bfs_expr *expr, struct bfs_eval *state);
 bool eval_fprint0(const struct bfs_expr *expr, struct bfs_eval *state);
 bool eval_fprintf(const struct bfs_expr *expr, struct bfs_eval *state);
 bool eval_fprintx(const struct bfs_expr *expr, struct bfs_eval *state);
+bool eval_fprintjson(const struct bfs_expr *expr, struct bfs_eval *state);
+bool eval_fprintbin(const struct bfs_expr *expr, struct bfs_eval *state);
+bool eval_hash(const struct bfs_expr *expr, struct bfs_eval *state);
 bool eval_limit(const struct bfs_expr *expr, struct bfs_eval *state);
 bool eval_prune(const struct bfs_expr *expr, struct bfs_eval *state);
 bool eval_quit(const struct bfs_expr *expr, struct bfs_eval *state);
+bool eval_sort_by(const struct bfs_expr *expr, struct bfs_eval *state);
+bool eval_summarize(const struct bfs_expr *expr, struct bfs_eval *state);
+bool eval_top(const struct bfs_expr *expr, struct bfs_eval *state);
 
 // Operator evaluation functions
 bool eval_not(const struct bfs_expr *expr, struct bfs_eval *state);
@@ -15,11 +15,13 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/resource.h>
+#include <sys/socket.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
@@ -40,6 +42,11 @@ static void bfs_exec_debug(const struct bfs_exec *execbuf, const char *format, .
 	if (execbuf->flags & BFS_EXEC_CHDIR) {
 		fputs("dir", stderr);
 	}
+	if (execbuf->flags & BFS_EXEC_FILTER) {
+		fputs("-filter", stderr);
+	} else if (execbuf->flags & BFS_EXEC_STREAM) {
+		fputs("-stream", stderr);
+	}
 	cfprintf(ctx->cerr, "${rs}: ");
 
 	va_list args;
@@ -137,11 +144,15 @@ struct bfs_exec *bfs_exec_parse(const struct bfs_ctx *ctx, char **argv, enum bfs
 	execbuf->ctx = ctx;
 	execbuf->tmpl_argv = argv + 1;
 	execbuf->wd_fd = -1;
+	execbuf->stream_fd = -1;
+
+	// Only -exec and -execdir support '{} +'
+	bool plus = !(execbuf->flags & (BFS_EXEC_CONFIRM | BFS_EXEC_STREAM));
 
 	while (true) {
 		const char *arg = execbuf->tmpl_argv[execbuf->tmpl_argc];
 		if (!arg) {
-			if (execbuf->flags & BFS_EXEC_CONFIRM) {
+			if (!plus) {
 				bfs_exec_parse_error(ctx, execbuf);
 				bfs_error(ctx, "Expected '... ;'.\n");
 			} else {
@@ -153,7 +164,7 @@ struct bfs_exec *bfs_exec_parse(const struct bfs_ctx *ctx, char **argv, enum bfs
 			break;
 		} else if (execbuf->tmpl_argc > 0 && strcmp(arg, "+") == 0) {
 			const char *prev = execbuf->tmpl_argv[execbuf->tmpl_argc - 1];
-			if (!(execbuf->flags & BFS_EXEC_CONFIRM) && strcmp(prev, "{}") == 0) {
+			if (plus && strcmp(prev, "{}") == 0) {
 				execbuf->flags |= BFS_EXEC_MULTI;
 				break;
 			}
@@ -327,8 +338,58 @@ static void bfs_exec_closewd(struct bfs_exec *execbuf, const struct BFTW *ftwbuf
 	}
 }
 
-/** Actually spawn the process. */
-static int bfs_exec_spawn(const struct bfs_exec *execbuf) {
+/**
+ * Get the executable to spawn.  Searching the $PATH takes a faccessat() for
+ * each component, so do it once and remember the result until $PATH changes.
+ */
+static const char *bfs_exec_resolve(struct bfs_exec *execbuf) {
+	const char *exe = execbuf->argv[0];
+	if (exe != execbuf->tmpl_argv[0] || strchr(exe, '/')) {
+		// Either the executable contains {}, or there's nothing to resolve
+		return exe;
+	}
+
+	const char *path = getenv("PATH");
+	if (!path) {
+		return exe;
+	}
+
+	if (execbuf->exe && strcmp(path, execbuf->exe_path) == 0) {
+		return execbuf->exe;
+	}
+
+	free(execbuf->exe_path);
+	free(execbuf->exe);
+	execbuf->exe_path = NULL;
+
+	execbuf->exe = bfs_spawn_resolve(exe);
+	if (!execbuf->exe) {
+		return NULL;
+	}
+
+	execbuf->exe_path = strdup(path);
+	if (!execbuf->exe_path) {
+		free(execbuf->exe);
+		execbuf->exe = NULL;
+		return NULL;
+	}
+
+	bfs_exec_debug(execbuf, "Resolved '%s' to '%s'\n", exe, execbuf->exe);
+	return execbuf->exe;
+}
+
+/**
+ * Actually spawn the process.
+ *
+ * @execbuf
+ *         The exec action.
+ * @sock
+ *         If non-negative, a socket to use for the command's standard input,
+ *         and its standard output too for BFS_EXEC_FILTER.
+ * @return
+ *         The PID of the command, or -1 on failure.
+ */
+static pid_t bfs_exec_spawn(struct bfs_exec *execbuf, int sock) {
 	const struct bfs_ctx *ctx = execbuf->ctx;
 
 	// Flush the context state for consistency with the external process
@@ -357,6 +418,11 @@ static int bfs_exec_spawn(const struct bfs_exec *execbuf) {
 		bfs_exec_debug(execbuf, "Executing '%s' ... [%zu arguments]\n", execbuf->argv[0], execbuf->argc - 1);
 	}
 
+	const char *exe = bfs_exec_resolve(execbuf);
+	if (!exe) {
+		return -1;
+	}
+
 	pid_t pid = -1;
 
 	struct bfs_spawn spawn;
@@ -372,6 +438,17 @@ static int bfs_exec_spawn(const struct bfs_exec *execbuf) {
 		}
 	}
 
+	if (sock >= 0) {
+		if (bfs_spawn_adddup2(&spawn, sock, STDIN_FILENO) != 0) {
+			goto fail;
+		}
+		if (execbuf->flags & BFS_EXEC_FILTER) {
+			if (bfs_spawn_adddup2(&spawn, sock, STDOUT_FILENO) != 0) {
+				goto fail;
+			}
+		}
+	}
+
 	// Reset RLIMIT_NOFILE if necessary, to avoid breaking applications that use select()
 	if (rlim_cmp(ctx->orig_nofile.rlim_cur, ctx->cur_nofile.rlim_cur) < 0) {
 		if (bfs_spawn_setrlimit(&spawn, RLIMIT_NOFILE, &ctx->orig_nofile) != 0) {
@@ -379,22 +456,18 @@ static int bfs_exec_spawn(const struct bfs_exec *execbuf) {
 		}
 	}
 
-	pid = bfs_spawn(execbuf->argv[0], &spawn, execbuf->argv, NULL);
+	pid = bfs_spawn(exe, &spawn, execbuf->argv, NULL);
 
 fail:;
 	int error = errno;
-
 	bfs_spawn_destroy(&spawn);
-	if (pid < 0) {
-		errno = error;
-		return -1;
-	}
-
-	int wstatus;
-	if (xwaitpid(pid, &wstatus, 0) < 0) {
-		return -1;
-	}
+	errno = error;
+	return pid;
+}
 
+/** Check the exit status of a command. */
+static int bfs_exec_status(const struct bfs_exec *execbuf, int wstatus) {
+	const struct bfs_ctx *ctx = execbuf->ctx;
 	int ret = -1;
 
 	if (WIFEXITED(wstatus)) {
@@ -419,6 +492,16 @@ fail:;
 	return ret;
 }
 
+/** Wait for a command to finish. */
+static int bfs_exec_wait(const struct bfs_exec *execbuf, pid_t pid) {
+	int wstatus;
+	if (xwaitpid(pid, &wstatus, 0) < 0) {
+		return -1;
+	}
+
+	return bfs_exec_status(execbuf, wstatus);
+}
+
 /** exec() a command for a single file. */
 static int bfs_exec_single(struct bfs_exec *execbuf, const struct BFTW *ftwbuf) {
 	int ret = -1, error = 0;
@@ -444,7 +527,10 @@ static int bfs_exec_single(struct bfs_exec *execbuf, const struct BFTW *ftwbuf)
 		}
 	}
 
-	ret = bfs_exec_spawn(execbuf);
+	pid_t pid = bfs_exec_spawn(execbuf, -1);
+	if (pid >= 0) {
+		ret = bfs_exec_wait(execbuf, pid);
+	}
 
 out_free:
 	error = errno;
@@ -520,6 +606,44 @@ static size_t bfs_exec_update_max(struct bfs_exec *execbuf) {
 	return estimate;
 }
 
+/** Wait for running batches until at most max remain. */
+static int bfs_exec_reap(struct bfs_exec *execbuf, size_t max) {
+	int ret = 0, error = 0;
+
+	// Collect any batches that have already finished
+	size_t njobs = 0;
+	for (size_t i = 0; i < execbuf->njobs; ++i) {
+		pid_t pid = execbuf->jobs[i];
+		int wstatus;
+		pid_t done = xwaitpid(pid, &wstatus, WNOHANG);
+		if (done == 0) {
+			execbuf->jobs[njobs++] = pid;
+		} else if (done < 0 || bfs_exec_status(execbuf, wstatus) != 0) {
+			ret = -1;
+			if (!error) {
+				error = errno;
+			}
+		}
+	}
+	execbuf->njobs = njobs;
+
+	// Then wait for the oldest ones
+	while (execbuf->njobs > max) {
+		if (bfs_exec_wait(execbuf, execbuf->jobs[0]) != 0) {
+			ret = -1;
+			if (!error) {
+				error = errno;
+			}
+		}
+
+		--execbuf->njobs;
+		memmove(execbuf->jobs, execbuf->jobs + 1, execbuf->njobs * sizeof(*execbuf->jobs));
+	}
+
+	errno = error;
+	return ret;
+}
+
 /** Execute the pending command from a BFS_EXEC_MULTI execbuf. */
 static int bfs_exec_flush(struct bfs_exec *execbuf) {
 	int ret = 0, error = 0;
@@ -527,12 +651,19 @@ static int bfs_exec_flush(struct bfs_exec *execbuf) {
 	size_t orig_argc = execbuf->argc;
 	while (bfs_exec_args_remain(execbuf)) {
 		execbuf->argv[execbuf->argc] = NULL;
-		ret = bfs_exec_spawn(execbuf);
-		error = errno;
-		if (ret == 0) {
+		pid_t pid = bfs_exec_spawn(execbuf, -1);
+		if (pid >= 0) {
+			// Let the batch run while we keep searching
+			execbuf->jobs[execbuf->njobs++] = pid;
 			bfs_exec_update_min(execbuf);
+			ret = 0;
+			error = 0;
 			break;
-		} else if (error != E2BIG) {
+		}
+
+		ret = -1;
+		error = errno;
+		if (error != E2BIG) {
 			break;
 		}
 
@@ -567,6 +698,14 @@ static int bfs_exec_flush(struct bfs_exec *execbuf) {
 		}
 	}
 
+	// Don't run more than -exec-jobs batches at once
+	if (bfs_exec_reap(execbuf, execbuf->ctx->exec_jobs - 1) != 0) {
+		ret = -1;
+		if (!error) {
+			error = errno;
+		}
+	}
+
 	errno = error;
 	return ret;
 }
@@ -635,6 +774,14 @@ static int bfs_exec_multi(struct bfs_exec *execbuf, const struct BFTW *ftwbuf) {
 		ret |= bfs_exec_flush(execbuf);
 	}
 
+	if (!execbuf->jobs) {
+		execbuf->jobs = ALLOC_ARRAY(pid_t, execbuf->ctx->exec_jobs);
+		if (!execbuf->jobs) {
+			ret = -1;
+			goto out_arg;
+		}
+	}
+
 	if ((execbuf->flags & BFS_EXEC_CHDIR) && execbuf->wd_fd < 0) {
 		if (bfs_exec_openwd(execbuf, ftwbuf) != 0) {
 			ret = -1;
@@ -656,8 +803,212 @@ out:
 	return ret;
 }
 
+/** Buffer this many bytes of paths before writing them to a BFS_EXEC_STREAM command. */
+#define BFS_EXEC_STREAM_BUF (64 << 10)
+
+/** Don't raise SIGPIPE if the streaming command exits early. */
+#ifdef MSG_NOSIGNAL
+#  define BFS_EXEC_SEND_FLAGS MSG_NOSIGNAL
+#else
+#  define BFS_EXEC_SEND_FLAGS 0
+#endif
+
+/** Start a BFS_EXEC_STREAM command. */
+static int bfs_exec_stream_start(struct bfs_exec *execbuf) {
+	execbuf->stream_buf = dstralloc(BFS_EXEC_STREAM_BUF);
+	if (!execbuf->stream_buf) {
+		return -1;
+	}
+
+	execbuf->stream_reply = dstralloc(0);
+	if (!execbuf->stream_reply) {
+		return -1;
+	}
+
+	for (size_t i = 0; i < execbuf->tmpl_argc; ++i) {
+		execbuf->argv[i] = execbuf->tmpl_argv[i];
+	}
+	execbuf->argc = execbuf->tmpl_argc;
+	execbuf->argv[execbuf->argc] = NULL;
+
+	int sv[2];
+	if (socketpair_cloexec(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+		return -1;
+	}
+
+#ifdef SO_NOSIGPIPE
+	int one = 1;
+	setsockopt(sv[0], SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+	pid_t pid = bfs_exec_spawn(execbuf, sv[1]);
+	int error = errno;
+	xclose(sv[1]);
+	if (pid < 0) {
+		xclose(sv[0]);
+		errno = error;
+		return -1;
+	}
+
+	execbuf->stream_pid = pid;
+	execbuf->stream_fd = sv[0];
+	return 0;
+}
+
+/** Write the buffered paths to a BFS_EXEC_STREAM command. */
+static int bfs_exec_stream_flush(struct bfs_exec *execbuf) {
+	const char *buf = execbuf->stream_buf;
+	size_t len = dstrlen(buf);
+
+	while (len > 0) {
+		ssize_t ret = send(execbuf->stream_fd, buf, len, BFS_EXEC_SEND_FLAGS);
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			} else if (errno == EPIPE && !(execbuf->flags & BFS_EXEC_FILTER)) {
+				// The command stopped reading, so its exit status decides
+				break;
+			}
+			return -1;
+		}
+
+		buf += ret;
+		len -= ret;
+	}
+
+	dstrshrink(execbuf->stream_buf, 0);
+	return 0;
+}
+
+/** Read a verdict line from a BFS_EXEC_FILTER command. */
+static int bfs_exec_verdict(struct bfs_exec *execbuf) {
+	while (true) {
+		dchar *reply = execbuf->stream_reply;
+		size_t len = dstrlen(reply);
+		char *newline = memchr(reply, '\n', len);
+		if (newline) {
+			// Like an exit status, "0" means true
+			bool verdict = newline - reply == 1 && reply[0] == '0';
+
+			size_t rest = len - (newline - reply) - 1;
+			memmove(reply, newline + 1, rest);
+			dstrshrink(reply, rest);
+
+			errno = 0;
+			return verdict ? 0 : -1;
+		}
+
+		// A command that buffers its output would never answer, so
+		// don't wait forever
+		const struct bfs_ctx *ctx = execbuf->ctx;
+		int timeout = ctx->filter_timeout > 0 ? ctx->filter_timeout * 1000 : -1;
+		struct pollfd pfd = {
+			.fd = execbuf->stream_fd,
+			.events = POLLIN,
+		};
+		int nfds = poll(&pfd, 1, timeout);
+		if (nfds < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		} else if (nfds == 0) {
+			bfs_error(ctx, "Command '${ex}%s${rs}' didn't answer within %ds.  Make sure it flushes its output after each line.\n",
+				execbuf->argv[0], ctx->filter_timeout);
+			errno = ETIMEDOUT;
+			return -1;
+		}
+
+		char buf[256];
+		ssize_t ret = read(execbuf->stream_fd, buf, sizeof(buf));
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		} else if (ret == 0) {
+			// The command exited without answering
+			errno = EPIPE;
+			return -1;
+		}
+
+		if (dstrxcat(&execbuf->stream_reply, buf, ret) != 0) {
+			return -1;
+		}
+	}
+}
+
+/** Pass a path to a BFS_EXEC_STREAM command. */
+static int bfs_exec_stream(struct bfs_exec *execbuf, const struct BFTW *ftwbuf) {
+	if (execbuf->stream_fd < 0) {
+		if (bfs_exec_stream_start(execbuf) != 0) {
+			return -1;
+		}
+	}
+
+	// Paths are NUL-terminated
+	const char *path = ftwbuf->path;
+	if (dstrxcat(&execbuf->stream_buf, path, strlen(path) + 1) != 0) {
+		return -1;
+	}
+
+	if (execbuf->flags & BFS_EXEC_FILTER) {
+		if (bfs_exec_stream_flush(execbuf) != 0) {
+			return -1;
+		}
+		return bfs_exec_verdict(execbuf);
+	} else if (dstrlen(execbuf->stream_buf) >= BFS_EXEC_STREAM_BUF) {
+		return bfs_exec_stream_flush(execbuf);
+	} else {
+		return 0;
+	}
+}
+
+/** Finish a BFS_EXEC_STREAM command. */
+static int bfs_exec_stream_finish(struct bfs_exec *execbuf) {
+	if (execbuf->stream_fd < 0) {
+		return execbuf->ret;
+	}
+
+	int ret = execbuf->ret, error = errno;
+	if (ret == 0 && bfs_exec_stream_flush(execbuf) != 0) {
+		ret = -1;
+		error = errno;
+	}
+
+	// Closing the socket signals EOF to the command
+	xclose(execbuf->stream_fd);
+	execbuf->stream_fd = -1;
+
+	bfs_exec_debug(execbuf, "Waiting for '%s' to finish\n", execbuf->argv[0]);
+	if (bfs_exec_wait(execbuf, execbuf->stream_pid) != 0) {
+		ret = -1;
+		if (errno != 0 || error == 0) {
+			error = errno;
+		}
+	}
+
+	errno = error;
+	return ret;
+}
+
 int bfs_exec(struct bfs_exec *execbuf, const struct BFTW *ftwbuf) {
-	if (execbuf->flags & BFS_EXEC_MULTI) {
+	if (execbuf->flags & BFS_EXEC_STREAM) {
+		if (execbuf->ret != 0) {
+			// The command already failed, so don't report it again
+			errno = 0;
+			return (execbuf->flags & BFS_EXEC_FILTER) ? -1 : 0;
+		}
+
+		int ret = bfs_exec_stream(execbuf, ftwbuf);
+		if (ret == 0) {
+			errno = 0;
+		} else if (errno != 0) {
+			execbuf->ret = -1;
+		}
+		// -exec-stream never returns false
+		return (execbuf->flags & BFS_EXEC_FILTER) ? ret : 0;
+	} else if (execbuf->flags & BFS_EXEC_MULTI) {
 		if (bfs_exec_multi(execbuf, ftwbuf) == 0) {
 			errno = 0;
 		} else {
@@ -671,11 +1022,24 @@ int bfs_exec(struct bfs_exec *execbuf, const struct BFTW *ftwbuf) {
 }
 
 int bfs_exec_finish(struct bfs_exec *execbuf) {
-	if (execbuf->flags & BFS_EXEC_MULTI) {
+	if (execbuf->flags & BFS_EXEC_STREAM) {
+		execbuf->ret = bfs_exec_stream_finish(execbuf);
+	} else if (execbuf->flags & BFS_EXEC_MULTI) {
 		bfs_exec_debug(execbuf, "Finishing execution, executing buffered command\n");
 		while (bfs_exec_args_remain(execbuf)) {
 			execbuf->ret |= bfs_exec_flush(execbuf);
 		}
+
+		// Wait for any batches that are still running
+		int error = errno;
+		if (bfs_exec_reap(execbuf, 0) != 0) {
+			execbuf->ret = -1;
+			if (errno != 0) {
+				error = errno;
+			}
+		}
+		errno = error;
+
 		if (execbuf->ret != 0) {
 			bfs_exec_debug(execbuf, "One or more executions of '%s' failed\n", execbuf->argv[0]);
 		}
@@ -686,6 +1050,14 @@ int bfs_exec_finish(struct bfs_exec *execbuf) {
 void bfs_exec_free(struct bfs_exec *execbuf) {
 	if (execbuf) {
 		bfs_exec_closewd(execbuf, NULL);
+		if (execbuf->stream_fd >= 0) {
+			xclose(execbuf->stream_fd);
+		}
+		dstrfree(execbuf->stream_reply);
+		dstrfree(execbuf->stream_buf);
+		free(execbuf->jobs);
+		free(execbuf->exe_path);
+		free(execbuf->exe);
 		free(execbuf->argv);
 		free(execbuf);
 	}
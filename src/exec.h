@@ -2,13 +2,16 @@
 // SPDX-License-Identifier: 0BSD
 
 /**
- * Implementation of -exec/-execdir/-ok/-okdir.
+ * Implementation of -exec/-execdir/-ok/-okdir/-exec-stream/-exec-filter.
  */
 
 #ifndef BFS_EXEC_H
 #define BFS_EXEC_H
 
+#include "dstring.h"
+
 #include <stddef.h>
+#include <sys/types.h>
 
 struct BFTW;
 struct bfs_ctx;
@@ -23,6 +26,10 @@ enum bfs_exec_flags {
 	BFS_EXEC_CHDIR   = 1 << 1,
 	/** Pass multiple files at once to the command (-exec ... {} +). */
 	BFS_EXEC_MULTI   = 1 << 2,
+	/** Write paths to the standard input of one long-running command (-exec-stream). */
+	BFS_EXEC_STREAM  = 1 << 3,
+	/** Read back a verdict for each path (-exec-filter). */
+	BFS_EXEC_FILTER  = 1 << 4,
 };
 
 /**
@@ -39,6 +46,11 @@ struct bfs_exec {
 	/** Command line template size. */
 	size_t tmpl_argc;
 
+	/** The resolved executable, cached between spawns. */
+	char *exe;
+	/** The $PATH that exe was resolved from. */
+	char *exe_path;
+
 	/** The built command line. */
 	char **argv;
 	/** Number of command line arguments. */
@@ -60,6 +72,20 @@ struct bfs_exec {
 	/** Length of the working directory path. */
 	size_t wd_len;
 
+	/** Running batches of BFS_EXEC_MULTI commands, oldest first. */
+	pid_t *jobs;
+	/** Number of running batches. */
+	size_t njobs;
+
+	/** The long-running command, for BFS_EXEC_STREAM. */
+	pid_t stream_pid;
+	/** A socket connected to the command's standard input (and output). */
+	int stream_fd;
+	/** Paths waiting to be written to the command. */
+	dchar *stream_buf;
+	/** Verdicts read from the command but not yet consumed. */
+	dchar *stream_reply;
+
 	/** The ultimate return value for bfs_exec_finish(). */
 	int ret;
 };
@@ -4,12 +4,18 @@
 #include "expr.h"
 
 #include "alloc.h"
+#include "contains.h"
 #include "ctx.h"
 #include "diag.h"
+#include "dupes.h"
 #include "eval.h"
 #include "exec.h"
 #include "list.h"
+#include "printbin.h"
 #include "printf.h"
+#include "sort.h"
+#include "summary.h"
+#include "top.h"
 #include "xregex.h"
 
 #include <string.h>
@@ -94,10 +100,24 @@ bool bfs_expr_never_returns(const struct bfs_expr *expr) {
 }
 
 void bfs_expr_clear(struct bfs_expr *expr) {
-	if (expr->eval_fn == eval_exec) {
+	if (expr->eval_fn == eval_duplicates) {
+		bfs_dupes_free(expr->dupes);
+	} else if (expr->eval_fn == eval_contains) {
+		bfs_contains_free(expr->contains);
+	} else if (expr->eval_fn == eval_exec) {
 		bfs_exec_free(expr->exec);
+	} else if (expr->eval_fn == eval_fprintbin) {
+		bfs_printbin_free(expr->printbin);
+	} else if (expr->eval_fn == eval_hash) {
+		bfs_hasher_free(expr->hasher);
 	} else if (expr->eval_fn == eval_fprintf) {
 		bfs_printf_free(expr->printf);
+	} else if (expr->eval_fn == eval_sort_by) {
+		bfs_sort_free(expr->sort);
+	} else if (expr->eval_fn == eval_summarize) {
+		bfs_summary_free(expr->summary);
+	} else if (expr->eval_fn == eval_top) {
+		bfs_top_free(expr->top);
 	} else if (expr->eval_fn == eval_regex) {
 		bfs_regfree(expr->regex);
 	}
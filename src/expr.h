@@ -10,6 +10,7 @@
 
 #include "color.h"
 #include "eval.h"
+#include "hash.h"
 #include "stat.h"
 
 #include <sys/types.h>
@@ -187,12 +188,40 @@ struct bfs_expr {
 
 		/** Printing actions. */
 		struct {
+			/** The next printing action, in parse order. */
+			struct { struct bfs_expr *next; } outputs;
 			/** The output stream. */
 			CFILE *cfile;
 			/** Optional file path. */
 			const char *path;
 			/** Optional -printf format. */
 			struct bfs_printf *printf;
+			/** Optional -fprintbin state. */
+			struct bfs_printbin *printbin;
+			/** Optional -summarize state. */
+			struct bfs_summary *summary;
+			/** Optional -top state. */
+			struct bfs_top *top;
+			/** Optional -sort-by state. */
+			struct bfs_sort *sort;
+			/** Optional -duplicates state. */
+			struct bfs_dupes *dupes;
+			/** -hash state. */
+			struct {
+				/** The -hash algorithm. */
+				enum bfs_hash_algo hash_algo;
+				/** The file hasher. */
+				struct bfs_hasher *hasher;
+			};
+		};
+
+		/** -contains data. */
+		struct bfs_contains *contains;
+
+		/** -delete data. */
+		struct {
+			/** Whether the result is ignored, allowing asynchronous unlinks. */
+			bool delete_async;
 		};
 
 		/** -exec data. */
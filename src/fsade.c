@@ -242,7 +242,7 @@ static int bfs_check_acl_type(acl_t acl, acl_type_t type) {
 #endif // BFS_HAS_ACL_GET_FILE
 
 int bfs_check_acl(const struct BFTW *ftwbuf) {
-	if (ftwbuf->type == BFS_LNK) {
+	if (bftw_type(ftwbuf, ftwbuf->stat_flags) == BFS_LNK) {
 		return 0;
 	}
 
@@ -310,7 +310,7 @@ int bfs_check_acl(const struct BFTW *ftwbuf) {
 #if BFS_CAN_CHECK_CAPABILITIES
 
 int bfs_check_capabilities(const struct BFTW *ftwbuf) {
-	if (ftwbuf->type == BFS_LNK) {
+	if (bftw_type(ftwbuf, ftwbuf->stat_flags) == BFS_LNK) {
 		return 0;
 	}
 
@@ -404,19 +404,20 @@ static ssize_t bfs_extattr_get(const char *path, enum bfs_type type, int namespa
 #endif // BFS_USE_EXTATTR
 
 int bfs_check_xattrs(const struct BFTW *ftwbuf) {
+	enum bfs_type type = bftw_type(ftwbuf, ftwbuf->stat_flags);
 	const char *path = fake_at(ftwbuf);
 	ssize_t len;
 
 #if BFS_USE_EXTATTR
-	len = bfs_extattr_list(path, ftwbuf->type, EXTATTR_NAMESPACE_SYSTEM);
+	len = bfs_extattr_list(path, type, EXTATTR_NAMESPACE_SYSTEM);
 	if (len <= 0) {
-		len = bfs_extattr_list(path, ftwbuf->type, EXTATTR_NAMESPACE_USER);
+		len = bfs_extattr_list(path, type, EXTATTR_NAMESPACE_USER);
 	}
 #elif __APPLE__
-	int options = ftwbuf->type == BFS_LNK ? XATTR_NOFOLLOW : 0;
+	int options = type == BFS_LNK ? XATTR_NOFOLLOW : 0;
 	len = listxattr(path, NULL, 0, options);
 #else
-	if (ftwbuf->type == BFS_LNK) {
+	if (type == BFS_LNK) {
 		len = llistxattr(path, NULL, 0);
 	} else {
 		len = listxattr(path, NULL, 0);
@@ -440,19 +441,20 @@ int bfs_check_xattrs(const struct BFTW *ftwbuf) {
 }
 
 int bfs_check_xattr_named(const struct BFTW *ftwbuf, const char *name) {
+	enum bfs_type type = bftw_type(ftwbuf, ftwbuf->stat_flags);
 	const char *path = fake_at(ftwbuf);
 	ssize_t len;
 
 #if BFS_USE_EXTATTR
-	len = bfs_extattr_get(path, ftwbuf->type, EXTATTR_NAMESPACE_SYSTEM, name);
+	len = bfs_extattr_get(path, type, EXTATTR_NAMESPACE_SYSTEM, name);
 	if (len < 0) {
-		len = bfs_extattr_get(path, ftwbuf->type, EXTATTR_NAMESPACE_USER, name);
+		len = bfs_extattr_get(path, type, EXTATTR_NAMESPACE_USER, name);
 	}
 #elif __APPLE__
-	int options = ftwbuf->type == BFS_LNK ? XATTR_NOFOLLOW : 0;
+	int options = type == BFS_LNK ? XATTR_NOFOLLOW : 0;
 	len = getxattr(path, name, NULL, 0, 0, options);
 #else
-	if (ftwbuf->type == BFS_LNK) {
+	if (type == BFS_LNK) {
 		len = lgetxattr(path, name, NULL, 0);
 	} else {
 		len = getxattr(path, name, NULL, 0);
@@ -495,7 +497,7 @@ char *bfs_getfilecon(const struct BFTW *ftwbuf) {
 
 	char *con;
 	int ret;
-	if (ftwbuf->type == BFS_LNK) {
+	if (bftw_type(ftwbuf, ftwbuf->stat_flags) == BFS_LNK) {
 		ret = lgetfilecon(path, &con);
 	} else {
 		ret = getfilecon(path, &con);
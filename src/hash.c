@@ -0,0 +1,708 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+#include "hash.h"
+
+#include "alloc.h"
+#include "bfs.h"
+#include "bfstd.h"
+#include "bit.h"
+#include "diag.h"
+#include "ioq.h"
+#include "list.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/** The size of the buffer used to read files. */
+#define HASH_BUFSIZE (64 << 10)
+
+/** SHA-256 round constants. */
+static const uint32_t sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+/**
+ * SHA-256 state.
+ */
+struct sha256 {
+	/** The intermediate hash value. */
+	uint32_t h[8];
+	/** The total length of the input. */
+	uint64_t len;
+	/** Buffered input that doesn't fill a whole block yet. */
+	unsigned char buf[64];
+};
+
+/** Initialize a SHA-256 state. */
+static void sha256_init(struct sha256 *state) {
+	static const uint32_t h[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+	};
+
+	memcpy(state->h, h, sizeof(h));
+	state->len = 0;
+}
+
+/** Process a single 64-byte block. */
+static void sha256_block(struct sha256 *state, const unsigned char *block) {
+	uint32_t w[64];
+	for (int i = 0; i < 16; ++i) {
+		w[i] = load8_beu32(block + 4 * i);
+	}
+	for (int i = 16; i < 64; ++i) {
+		uint32_t s0 = rotate_right(w[i - 15], 7) ^ rotate_right(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		uint32_t s1 = rotate_right(w[i - 2], 17) ^ rotate_right(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	uint32_t a = state->h[0];
+	uint32_t b = state->h[1];
+	uint32_t c = state->h[2];
+	uint32_t d = state->h[3];
+	uint32_t e = state->h[4];
+	uint32_t f = state->h[5];
+	uint32_t g = state->h[6];
+	uint32_t h = state->h[7];
+
+	for (int i = 0; i < 64; ++i) {
+		uint32_t s1 = rotate_right(e, 6) ^ rotate_right(e, 11) ^ rotate_right(e, 25);
+		uint32_t ch = (e & f) ^ (~e & g);
+		uint32_t t1 = h + s1 + ch + sha256_k[i] + w[i];
+		uint32_t s0 = rotate_right(a, 2) ^ rotate_right(a, 13) ^ rotate_right(a, 22);
+		uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+		uint32_t t2 = s0 + maj;
+
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	state->h[0] += a;
+	state->h[1] += b;
+	state->h[2] += c;
+	state->h[3] += d;
+	state->h[4] += e;
+	state->h[5] += f;
+	state->h[6] += g;
+	state->h[7] += h;
+}
+
+/** Add some input to a SHA-256 state. */
+static void sha256_update(struct sha256 *state, const unsigned char *data, size_t len) {
+	size_t used = state->len % 64;
+	state->len += len;
+
+	if (used > 0) {
+		size_t n = 64 - used;
+		if (n > len) {
+			n = len;
+		}
+
+		memcpy(state->buf + used, data, n);
+		data += n;
+		len -= n;
+
+		if (used + n < 64) {
+			return;
+		}
+		sha256_block(state, state->buf);
+	}
+
+	for (; len >= 64; data += 64, len -= 64) {
+		sha256_block(state, data);
+	}
+
+	memcpy(state->buf, data, len);
+}
+
+/** Finish a SHA-256 hash. */
+static void sha256_final(struct sha256 *state, char hex[BFS_HASH_MAX]) {
+	uint64_t bits = state->len * 8;
+
+	unsigned char pad[72] = {0x80};
+	size_t used = state->len % 64;
+	size_t npad = (used < 56 ? 56 : 120) - used;
+	for (int i = 0; i < 8; ++i) {
+		pad[npad + i] = bits >> (56 - 8 * i);
+	}
+	sha256_update(state, pad, npad + 8);
+
+	for (int i = 0; i < 8; ++i) {
+		snprintf(hex + 8 * i, BFS_HASH_MAX - 8 * i, "%08" PRIx32, state->h[i]);
+	}
+}
+
+/** XXH64 primes. */
+#define XXH_P1 UINT64_C(0x9E3779B185EBCA87)
+#define XXH_P2 UINT64_C(0xC2B2AE3D27D4EB4F)
+#define XXH_P3 UINT64_C(0x165667B19E3779F9)
+#define XXH_P4 UINT64_C(0x85EBCA77C2B2AE63)
+#define XXH_P5 UINT64_C(0x27D4EB2F165667C5)
+
+/**
+ * XXH64 state.
+ */
+struct xxh64 {
+	/** The four accumulators. */
+	uint64_t v[4];
+	/** The total length of the input. */
+	uint64_t len;
+	/** Buffered input that doesn't fill a whole stripe yet. */
+	unsigned char buf[32];
+};
+
+/** Initialize an XXH64 state. */
+static void xxh64_init(struct xxh64 *state) {
+	state->v[0] = XXH_P1 + XXH_P2;
+	state->v[1] = XXH_P2;
+	state->v[2] = 0;
+	state->v[3] = -XXH_P1;
+	state->len = 0;
+}
+
+/** Mix one lane into an accumulator. */
+static uint64_t xxh64_round(uint64_t acc, uint64_t lane) {
+	acc += lane * XXH_P2;
+	acc = rotate_left(acc, 31);
+	return acc * XXH_P1;
+}
+
+/** Merge an accumulator into the final hash. */
+static uint64_t xxh64_merge(uint64_t hash, uint64_t acc) {
+	hash ^= xxh64_round(0, acc);
+	return hash * XXH_P1 + XXH_P4;
+}
+
+/** Process a single 32-byte stripe. */
+static void xxh64_stripe(struct xxh64 *state, const unsigned char *stripe) {
+	for (int i = 0; i < 4; ++i) {
+		state->v[i] = xxh64_round(state->v[i], load8_leu64(stripe + 8 * i));
+	}
+}
+
+/** Add some input to an XXH64 state. */
+static void xxh64_update(struct xxh64 *state, const unsigned char *data, size_t len) {
+	size_t used = state->len % 32;
+	state->len += len;
+
+	if (used > 0) {
+		size_t n = 32 - used;
+		if (n > len) {
+			n = len;
+		}
+
+		memcpy(state->buf + used, data, n);
+		data += n;
+		len -= n;
+
+		if (used + n < 32) {
+			return;
+		}
+		xxh64_stripe(state, state->buf);
+	}
+
+	for (; len >= 32; data += 32, len -= 32) {
+		xxh64_stripe(state, data);
+	}
+
+	memcpy(state->buf, data, len);
+}
+
+/** Finish an XXH64 hash. */
+static void xxh64_final(const struct xxh64 *state, char hex[BFS_HASH_MAX]) {
+	const uint64_t *v = state->v;
+
+	uint64_t hash;
+	if (state->len >= 32) {
+		hash = rotate_left(v[0], 1) + rotate_left(v[1], 7) + rotate_left(v[2], 12) + rotate_left(v[3], 18);
+		for (int i = 0; i < 4; ++i) {
+			hash = xxh64_merge(hash, v[i]);
+		}
+	} else {
+		hash = v[2] + XXH_P5;
+	}
+	hash += state->len;
+
+	const unsigned char *tail = state->buf;
+	size_t len = state->len % 32;
+
+	for (; len >= 8; tail += 8, len -= 8) {
+		hash ^= xxh64_round(0, load8_leu64(tail));
+		hash = rotate_left(hash, 27) * XXH_P1 + XXH_P4;
+	}
+
+	if (len >= 4) {
+		hash ^= load8_leu32(tail) * XXH_P1;
+		hash = rotate_left(hash, 23) * XXH_P2 + XXH_P3;
+		tail += 4;
+		len -= 4;
+	}
+
+	for (; len > 0; ++tail, --len) {
+		hash ^= *tail * XXH_P5;
+		hash = rotate_left(hash, 11) * XXH_P1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= XXH_P2;
+	hash ^= hash >> 29;
+	hash *= XXH_P3;
+	hash ^= hash >> 32;
+
+	snprintf(hex, BFS_HASH_MAX, "%016" PRIx64, hash);
+}
+
+int bfs_hash_parse(const char *name, enum bfs_hash_algo *algo) {
+	if (strcmp(name, "sha256") == 0) {
+		*algo = BFS_SHA256;
+	} else if (strcmp(name, "xxh64") == 0) {
+		*algo = BFS_XXH64;
+	} else {
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * The state of any supported hash.
+ */
+struct hash_state {
+	/** The hash algorithm. */
+	enum bfs_hash_algo algo;
+
+	union {
+		struct sha256 sha256;
+		struct xxh64 xxh64;
+	};
+};
+
+/** Initialize a hash state. */
+static void hash_init(struct hash_state *state, enum bfs_hash_algo algo) {
+	state->algo = algo;
+
+	switch (algo) {
+	case BFS_SHA256:
+		sha256_init(&state->sha256);
+		break;
+	case BFS_XXH64:
+		xxh64_init(&state->xxh64);
+		break;
+	}
+}
+
+/** Add some input to a hash state. */
+static void hash_update(struct hash_state *state, const unsigned char *data, size_t len) {
+	switch (state->algo) {
+	case BFS_SHA256:
+		sha256_update(&state->sha256, data, len);
+		break;
+	case BFS_XXH64:
+		xxh64_update(&state->xxh64, data, len);
+		break;
+	}
+}
+
+/** Finish a hash. */
+static void hash_final(struct hash_state *state, char hex[BFS_HASH_MAX]) {
+	switch (state->algo) {
+	case BFS_SHA256:
+		sha256_final(&state->sha256, hex);
+		break;
+	case BFS_XXH64:
+		xxh64_final(&state->xxh64, hex);
+		break;
+	}
+}
+
+/** The number of chunks of each file that can be read at once. */
+#define HASH_NBUFS 2
+
+/**
+ * A file being hashed.
+ */
+struct hash_job {
+	/** The next job in the free or done list. */
+	struct hash_job *next;
+	/** The pointer passed to bfs_hasher_push(). */
+	void *ptr;
+	/** The open file. */
+	int fd;
+	/** The hash state. */
+	struct hash_state state;
+	/** The offset of the next chunk to read. */
+	uintmax_t offset;
+	/** The number of bytes left to read after that. */
+	uintmax_t limit;
+	/** The buffer holding the next chunk to hash. */
+	size_t next_buf;
+	/** The number of chunks that have been read or requested, but not hashed. */
+	size_t queued;
+	/** The number of reads still in progress. */
+	size_t pending;
+	/** Whether we're done hashing (but reads may still be pending). */
+	bool finished;
+	/** The error that occurred, if any. */
+	int error;
+	/** The hex digest. */
+	char hex[BFS_HASH_MAX];
+	/** The chunk buffers. */
+	unsigned char *bufs[HASH_NBUFS];
+	/** The size of each buffer's read. */
+	size_t sizes[HASH_NBUFS];
+	/** The result of each buffer's read. */
+	int results[HASH_NBUFS];
+	/** Whether each buffer's read has completed. */
+	bool ready[HASH_NBUFS];
+};
+
+/**
+ * A list of jobs.
+ */
+struct hash_jobs {
+	struct hash_job *head;
+	struct hash_job **tail;
+};
+
+struct bfs_hasher {
+	/** The I/O queue, once it's needed. */
+	struct ioq *ioq;
+	/** The number of background threads. */
+	size_t nthreads;
+	/** Storage for the jobs. */
+	struct hash_job *jobs;
+	/** The number of jobs. */
+	size_t njobs;
+	/** The number of jobs that have been pushed but not popped. */
+	size_t used;
+	/** Jobs that aren't in use. */
+	struct hash_jobs free;
+	/** Jobs that are done, waiting to be popped. */
+	struct hash_jobs done;
+};
+
+struct bfs_hasher *bfs_hasher_new(size_t nthreads, size_t nfiles) {
+	struct bfs_hasher *hasher = ZALLOC(struct bfs_hasher);
+	if (!hasher) {
+		return NULL;
+	}
+
+	hasher->jobs = ZALLOC_ARRAY(struct hash_job, nfiles);
+	if (!hasher->jobs) {
+		free(hasher);
+		return NULL;
+	}
+
+	hasher->nthreads = nthreads;
+	hasher->njobs = nfiles;
+	SLIST_INIT(&hasher->free);
+	SLIST_INIT(&hasher->done);
+	for (size_t i = 0; i < nfiles; ++i) {
+		SLIST_APPEND(&hasher->free, &hasher->jobs[i]);
+	}
+
+	return hasher;
+}
+
+size_t bfs_hasher_capacity(const struct bfs_hasher *hasher) {
+	return hasher->njobs - hasher->used;
+}
+
+/** Get the I/O queue, starting it if necessary. */
+static struct ioq *hasher_ioq(struct bfs_hasher *hasher) {
+	if (!hasher->ioq && hasher->nthreads > 0) {
+		hasher->ioq = ioq_create(hasher->njobs * HASH_NBUFS, hasher->nthreads);
+		if (!hasher->ioq) {
+			// Fall back to synchronous reads
+			hasher->nthreads = 0;
+		}
+	}
+
+	return hasher->ioq;
+}
+
+/** Finish a job once all its reads are complete. */
+static void hash_job_done(struct bfs_hasher *hasher, struct hash_job *job) {
+	if (!job->finished || job->pending > 0) {
+		return;
+	}
+
+	if (job->fd >= 0) {
+		close_quietly(job->fd);
+		job->fd = -1;
+	}
+
+	if (!job->error) {
+		hash_final(&job->state, job->hex);
+	}
+
+	SLIST_APPEND(&hasher->done, job);
+}
+
+/** Hash a file synchronously. */
+static void hash_job_sync(struct hash_job *job) {
+	unsigned char *buf = job->bufs[0];
+
+	while (job->limit > 0) {
+		size_t size = job->limit < HASH_BUFSIZE ? job->limit : HASH_BUFSIZE;
+		size_t len = xread(job->fd, buf, size);
+		hash_update(&job->state, buf, len);
+		job->limit -= len;
+
+		if (len < size) {
+			job->error = errno;
+			break;
+		}
+	}
+
+	job->finished = true;
+}
+
+/** Read the next chunk of a file into one of its buffers. */
+static int hash_job_read(struct bfs_hasher *hasher, struct hash_job *job, size_t i) {
+	size_t size = job->limit < HASH_BUFSIZE ? job->limit : HASH_BUFSIZE;
+	if (size == 0) {
+		return 0;
+	}
+
+	if (ioq_read(hasher->ioq, job->fd, job->bufs[i], size, job->offset, job) != 0) {
+		return -1;
+	}
+
+	job->offset += size;
+	job->limit -= size;
+	job->sizes[i] = size;
+	job->ready[i] = false;
+	++job->queued;
+	++job->pending;
+	return 0;
+}
+
+/** Hash any chunks that are ready, in order, and read the next ones. */
+static void hash_job_advance(struct bfs_hasher *hasher, struct hash_job *job) {
+	while (!job->finished && job->ready[job->next_buf]) {
+		size_t i = job->next_buf;
+		job->ready[i] = false;
+		--job->queued;
+
+		int result = job->results[i];
+		if (result < 0) {
+			job->error = -result;
+			job->finished = true;
+			break;
+		}
+
+		hash_update(&job->state, job->bufs[i], result);
+
+		if ((size_t)result < job->sizes[i]) {
+			// Short read, so we've hit the end of the file
+			job->finished = true;
+			break;
+		}
+
+		if (hash_job_read(hasher, job, i) != 0) {
+			job->error = errno;
+			job->finished = true;
+			break;
+		}
+
+		job->next_buf = (i + 1) % HASH_NBUFS;
+		if (job->queued == 0) {
+			// We've hashed up to the limit
+			job->finished = true;
+		}
+	}
+
+	hash_job_done(hasher, job);
+}
+
+/** Start hashing a file. */
+static void hash_job_start(struct bfs_hasher *hasher, struct hash_job *job) {
+	struct stat sb;
+	if (fstat(job->fd, &sb) != 0) {
+		goto fail;
+	}
+
+	if (!S_ISREG(sb.st_mode)) {
+		errno = S_ISDIR(sb.st_mode) ? EISDIR : EINVAL;
+		goto fail;
+	}
+
+	for (size_t i = 0; i < HASH_NBUFS; ++i) {
+		if (!job->bufs[i]) {
+			job->bufs[i] = malloc(HASH_BUFSIZE);
+			if (!job->bufs[i]) {
+				goto fail;
+			}
+		}
+	}
+
+	// If the file fits in one read, and no other files are being hashed,
+	// there's nothing to overlap with
+	bool small = (uintmax_t)sb.st_size < HASH_BUFSIZE || job->limit <= HASH_BUFSIZE;
+	struct ioq *ioq = NULL;
+	if (!small || hasher->used > 1) {
+		ioq = hasher_ioq(hasher);
+	}
+
+	if (!ioq) {
+		hash_job_sync(job);
+		return;
+	}
+
+	for (size_t i = 0; i < HASH_NBUFS; ++i) {
+		if (hash_job_read(hasher, job, i) != 0) {
+			job->error = errno;
+			job->finished = true;
+			break;
+		}
+	}
+
+	if (job->queued == 0) {
+		// Nothing to read
+		job->finished = true;
+	}
+
+	ioq_submit(ioq);
+	return;
+
+fail:
+	job->error = errno;
+	job->finished = true;
+}
+
+int bfs_hasher_push(struct bfs_hasher *hasher, enum bfs_hash_algo algo, int at_fd, const char *at_path, uintmax_t limit, void *ptr) {
+	struct hash_job *job = SLIST_POP(&hasher->free);
+	if (!job) {
+		errno = EAGAIN;
+		return -1;
+	}
+	++hasher->used;
+
+	job->ptr = ptr;
+	job->offset = 0;
+	job->limit = limit;
+	job->next_buf = 0;
+	job->queued = 0;
+	job->pending = 0;
+	job->finished = false;
+	job->error = 0;
+	hash_init(&job->state, algo);
+
+	// O_NONBLOCK so we don't hang on FIFOs
+	job->fd = openat(at_fd, at_path, O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK);
+	if (job->fd >= 0) {
+		hash_job_start(hasher, job);
+	} else {
+		job->error = errno;
+		job->finished = true;
+	}
+
+	hash_job_done(hasher, job);
+	return 0;
+}
+
+/** Wait for a read to complete. */
+static void hasher_wait(struct bfs_hasher *hasher) {
+	struct ioq *ioq = hasher->ioq;
+	bfs_assert(ioq);
+
+	ioq_submit(ioq);
+	struct ioq_ent *ent = ioq_pop(ioq, true);
+	bfs_assert(ent && ent->op == IOQ_READ);
+
+	struct hash_job *job = ent->ptr;
+	size_t i = 0;
+	while (job->bufs[i] != ent->read.buf) {
+		++i;
+	}
+
+	job->results[i] = ent->result;
+	job->ready[i] = true;
+	--job->pending;
+	ioq_free(ioq, ent);
+
+	hash_job_advance(hasher, job);
+}
+
+int bfs_hasher_pop(struct bfs_hasher *hasher, void **ptr, char hex[BFS_HASH_MAX]) {
+	bfs_assert(hasher->used > 0);
+
+	while (SLIST_EMPTY(&hasher->done)) {
+		hasher_wait(hasher);
+	}
+
+	struct hash_job *job = SLIST_POP(&hasher->done);
+	SLIST_PREPEND(&hasher->free, job);
+	--hasher->used;
+
+	*ptr = job->ptr;
+	if (job->error) {
+		errno = job->error;
+		return -1;
+	}
+
+	memcpy(hex, job->hex, BFS_HASH_MAX);
+	return 0;
+}
+
+int bfs_hasher_file(struct bfs_hasher *hasher, enum bfs_hash_algo algo, int at_fd, const char *at_path, char hex[BFS_HASH_MAX]) {
+	bfs_assert(hasher->used == 0);
+
+	if (bfs_hasher_push(hasher, algo, at_fd, at_path, UINTMAX_MAX, NULL) != 0) {
+		return -1;
+	}
+
+	void *ptr;
+	return bfs_hasher_pop(hasher, &ptr, hex);
+}
+
+void bfs_hasher_free(struct bfs_hasher *hasher) {
+	if (!hasher) {
+		return;
+	}
+
+	while (hasher->used > 0) {
+		void *ptr;
+		char hex[BFS_HASH_MAX];
+		bfs_hasher_pop(hasher, &ptr, hex);
+	}
+
+	ioq_destroy(hasher->ioq);
+
+	for (size_t i = 0; i < hasher->njobs; ++i) {
+		for (size_t j = 0; j < HASH_NBUFS; ++j) {
+			free(hasher->jobs[i].bufs[j]);
+		}
+	}
+	free(hasher->jobs);
+	free(hasher);
+}
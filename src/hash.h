@@ -0,0 +1,121 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+/**
+ * Built-in file content hashing, for -hash and -printf %X.
+ */
+
+#ifndef BFS_HASH_H
+#define BFS_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Supported hash algorithms.
+ */
+enum bfs_hash_algo {
+	/** SHA-256, compatible with sha256sum. */
+	BFS_SHA256,
+	/** XXH64 with a seed of 0, compatible with xxhsum -H64. */
+	BFS_XXH64,
+};
+
+/**
+ * The maximum length of a hex digest, including the NUL terminator.
+ */
+#define BFS_HASH_MAX (2 * 32 + 1)
+
+/**
+ * Look up a hash algorithm by name.
+ *
+ * @name
+ *         The name of the algorithm, e.g. "sha256".
+ * @algo
+ *         Will hold the algorithm.
+ * @return
+ *         0 on success, -1 if the algorithm is unknown.
+ */
+int bfs_hash_parse(const char *name, enum bfs_hash_algo *algo);
+
+/**
+ * Hashes files, reading them through an I/O queue.
+ *
+ * While one chunk of a file is being hashed, background threads read ahead to
+ * the next chunk, and to the chunks of any other files being hashed at the
+ * same time, so I/O overlaps with hashing.
+ */
+struct bfs_hasher;
+
+/**
+ * Create a hasher.
+ *
+ * @nthreads
+ *         The number of background threads to read with.  If zero, files are
+ *         read synchronously.
+ * @nfiles
+ *         The maximum number of files to hash at once.
+ * @return
+ *         The new hasher, or NULL on failure.
+ */
+struct bfs_hasher *bfs_hasher_new(size_t nthreads, size_t nfiles);
+
+/**
+ * Get the number of files that can still be pushed before one is popped.
+ */
+size_t bfs_hasher_capacity(const struct bfs_hasher *hasher);
+
+/**
+ * Start hashing a regular file.  Errors with the file itself are reported by
+ * bfs_hasher_pop().
+ *
+ * @hasher
+ *         The hasher.  It must have some capacity left.
+ * @algo
+ *         The hash algorithm to use.
+ * @at_fd
+ *         The base directory for the path.
+ * @at_path
+ *         The path to the file, relative to at_fd.
+ * @limit
+ *         The maximum number of bytes to hash, e.g. UINTMAX_MAX for the whole
+ *         file.
+ * @ptr
+ *         An arbitrary pointer to associate with the file.
+ * @return
+ *         0 on success, -1 on failure.
+ */
+int bfs_hasher_push(struct bfs_hasher *hasher, enum bfs_hash_algo algo, int at_fd, const char *at_path, uintmax_t limit, void *ptr);
+
+/**
+ * Wait for a pushed file to be hashed.  Files are not necessarily popped in
+ * the order they were pushed.
+ *
+ * @hasher
+ *         The hasher.  At least one file must have been pushed.
+ * @ptr
+ *         Will hold the pointer associated with the file.
+ * @hex
+ *         Will hold the NUL-terminated hex digest.
+ * @return
+ *         0 on success, -1 if the file couldn't be hashed.  Files that aren't
+ *         regular files fail with EISDIR for directories, and EINVAL
+ *         otherwise.
+ */
+int bfs_hasher_pop(struct bfs_hasher *hasher, void **ptr, char hex[BFS_HASH_MAX]);
+
+/**
+ * Hash a single regular file, like bfs_hasher_push() followed by
+ * bfs_hasher_pop().  No other files may be in progress.
+ *
+ * @return
+ *         0 on success, -1 on failure.
+ */
+int bfs_hasher_file(struct bfs_hasher *hasher, enum bfs_hash_algo algo, int at_fd, const char *at_path, char hex[BFS_HASH_MAX]);
+
+/**
+ * Free a hasher, waiting for any files that haven't been popped.
+ */
+void bfs_hasher_free(struct bfs_hasher *hasher);
+
+#endif // BFS_HASH_H
@@ -0,0 +1,244 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+#include "idset.h"
+
+#include "alloc.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+/** The initial table capacity. */
+#define IDSET_MIN_CAPACITY 256
+
+void idset_init(struct idset *set) {
+	set->table = NULL;
+	set->mask = 0;
+	set->size = 0;
+	set->zero = false;
+}
+
+/** Hash a (dev, ino) pair. */
+static size_t idset_hash(dev_t dev, ino_t ino) {
+	// Inode numbers are often sequential, so mix the bits thoroughly
+	// https://nullprogram.com/blog/2018/07/31/
+	uint64_t h = (uint64_t)ino ^ ((uint64_t)dev * UINT64_C(0x9e3779b97f4a7c15));
+	h ^= h >> 32;
+	h *= UINT64_C(0xd6e8feb86659fd93);
+	h ^= h >> 32;
+	h *= UINT64_C(0xd6e8feb86659fd93);
+	h ^= h >> 32;
+	return h;
+}
+
+/** Check for an empty slot. */
+static bool idset_empty(const struct bfs_id *id) {
+	return id->dev == 0 && id->ino == 0;
+}
+
+/** Find the slot for a (dev, ino) pair, which is either empty or a match. */
+static struct bfs_id *idset_probe(const struct idset *set, dev_t dev, ino_t ino) {
+	size_t mask = set->mask;
+	size_t i = idset_hash(dev, ino) & mask;
+
+	while (true) {
+		struct bfs_id *id = &set->table[i];
+		if (idset_empty(id) || (id->dev == dev && id->ino == ino)) {
+			return id;
+		}
+		i = (i + 1) & mask;
+	}
+}
+
+bool idset_contains(const struct idset *set, dev_t dev, ino_t ino) {
+	if (dev == 0 && ino == 0) {
+		return set->zero;
+	}
+
+	if (!set->table) {
+		return false;
+	}
+
+	return !idset_empty(idset_probe(set, dev, ino));
+}
+
+/** Double the capacity of the table. */
+static int idset_grow(struct idset *set) {
+	size_t old_cap = set->table ? set->mask + 1 : 0;
+	size_t new_cap = old_cap ? 2 * old_cap : IDSET_MIN_CAPACITY;
+	if (new_cap <= old_cap) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	struct bfs_id *old_table = set->table;
+	struct bfs_id *new_table = ZALLOC_ARRAY(struct bfs_id, new_cap);
+	if (!new_table) {
+		return -1;
+	}
+
+	set->table = new_table;
+	set->mask = new_cap - 1;
+
+	for (size_t i = 0; i < old_cap; ++i) {
+		const struct bfs_id *id = &old_table[i];
+		if (!idset_empty(id)) {
+			*idset_probe(set, id->dev, id->ino) = *id;
+		}
+	}
+
+	free(old_table);
+	return 0;
+}
+
+int idset_insert(struct idset *set, dev_t dev, ino_t ino) {
+	if (dev == 0 && ino == 0) {
+		if (set->zero) {
+			return 0;
+		}
+		set->zero = true;
+		++set->size;
+		return 1;
+	}
+
+	// Keep the load factor below 3/4
+	size_t cap = set->table ? set->mask + 1 : 0;
+	if (4 * (set->size + 1) > 3 * cap) {
+		if (idset_grow(set) != 0) {
+			return -1;
+		}
+	}
+
+	struct bfs_id *id = idset_probe(set, dev, ino);
+	if (!idset_empty(id)) {
+		return 0;
+	}
+
+	id->dev = dev;
+	id->ino = ino;
+	++set->size;
+	return 1;
+}
+
+size_t idset_memory(const struct idset *set) {
+	if (set->table) {
+		return (set->mask + 1) * sizeof(*set->table);
+	} else {
+		return 0;
+	}
+}
+
+void idset_destroy(struct idset *set) {
+	free(set->table);
+}
+
+void idmap_init(struct idmap *map) {
+	map->table = NULL;
+	map->mask = 0;
+	map->size = 0;
+}
+
+/** Find the slot for a (dev, ino) pair, which is either empty or a match. */
+static struct idmap_entry *idmap_probe(const struct idmap *map, dev_t dev, ino_t ino) {
+	size_t mask = map->mask;
+	size_t i = idset_hash(dev, ino) & mask;
+
+	while (true) {
+		struct idmap_entry *entry = &map->table[i];
+		if (entry->refs == 0 || (entry->id.dev == dev && entry->id.ino == ino)) {
+			return entry;
+		}
+		i = (i + 1) & mask;
+	}
+}
+
+struct idmap_entry *idmap_get(const struct idmap *map, dev_t dev, ino_t ino) {
+	if (!map->table) {
+		return NULL;
+	}
+
+	struct idmap_entry *entry = idmap_probe(map, dev, ino);
+	return entry->refs ? entry : NULL;
+}
+
+/** Double the capacity of the table. */
+static int idmap_grow(struct idmap *map) {
+	size_t old_cap = map->table ? map->mask + 1 : 0;
+	size_t new_cap = old_cap ? 2 * old_cap : IDSET_MIN_CAPACITY;
+	if (new_cap <= old_cap) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	struct idmap_entry *old_table = map->table;
+	struct idmap_entry *new_table = ZALLOC_ARRAY(struct idmap_entry, new_cap);
+	if (!new_table) {
+		return -1;
+	}
+
+	map->table = new_table;
+	map->mask = new_cap - 1;
+
+	for (size_t i = 0; i < old_cap; ++i) {
+		const struct idmap_entry *entry = &old_table[i];
+		if (entry->refs) {
+			*idmap_probe(map, entry->id.dev, entry->id.ino) = *entry;
+		}
+	}
+
+	free(old_table);
+	return 0;
+}
+
+struct idmap_entry *idmap_ref(struct idmap *map, dev_t dev, ino_t ino) {
+	struct idmap_entry *entry = idmap_get(map, dev, ino);
+	if (entry) {
+		++entry->refs;
+		return entry;
+	}
+
+	// Keep the load factor below 3/4
+	size_t cap = map->table ? map->mask + 1 : 0;
+	if (4 * (map->size + 1) > 3 * cap) {
+		if (idmap_grow(map) != 0) {
+			return NULL;
+		}
+	}
+
+	entry = idmap_probe(map, dev, ino);
+	entry->id.dev = dev;
+	entry->id.ino = ino;
+	entry->refs = 1;
+	entry->ptr = NULL;
+	++map->size;
+	return entry;
+}
+
+void idmap_unref(struct idmap *map, dev_t dev, ino_t ino) {
+	struct idmap_entry *entry = idmap_get(map, dev, ino);
+	if (!entry || --entry->refs > 0) {
+		return;
+	}
+
+	// Shift later entries back into the hole, so probes don't stop early
+	size_t mask = map->mask;
+	size_t hole = entry - map->table;
+	for (size_t i = (hole + 1) & mask; map->table[i].refs; i = (i + 1) & mask) {
+		const struct idmap_entry *next = &map->table[i];
+		size_t home = idset_hash(next->id.dev, next->id.ino) & mask;
+		// Only move entries whose probe sequence passes through the hole
+		if (((i - home) & mask) >= ((i - hole) & mask)) {
+			map->table[hole] = *next;
+			hole = i;
+		}
+	}
+
+	map->table[hole].refs = 0;
+	--map->size;
+}
+
+void idmap_destroy(struct idmap *map) {
+	free(map->table);
+}
@@ -0,0 +1,159 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+/**
+ * A hash set of file identities.
+ */
+
+#ifndef BFS_IDSET_H
+#define BFS_IDSET_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/**
+ * A file identity.
+ */
+struct bfs_id {
+	/** The device number. */
+	dev_t dev;
+	/** The inode number. */
+	ino_t ino;
+};
+
+/**
+ * An open-addressing hash set of (dev, ino) pairs.
+ */
+struct idset {
+	/** The hash table, with empty slots set to zero. */
+	struct bfs_id *table;
+	/** The capacity of the table minus one (or zero if unallocated). */
+	size_t mask;
+	/** The number of entries in the set. */
+	size_t size;
+	/** Whether the set contains (0, 0), which can't be stored in the table. */
+	bool zero;
+};
+
+/**
+ * Initialize an empty set.
+ */
+void idset_init(struct idset *set);
+
+/**
+ * Check whether a set contains a file.
+ *
+ * @set
+ *         The set to search.
+ * @dev
+ *         The device number.
+ * @ino
+ *         The inode number.
+ * @return
+ *         Whether the file is in the set.
+ */
+bool idset_contains(const struct idset *set, dev_t dev, ino_t ino);
+
+/**
+ * Add a file to a set.
+ *
+ * @set
+ *         The set to modify.
+ * @dev
+ *         The device number.
+ * @ino
+ *         The inode number.
+ * @return
+ *         1 if the file was added, 0 if it was already present, or -1 on
+ *         failure.
+ */
+int idset_insert(struct idset *set, dev_t dev, ino_t ino);
+
+/**
+ * Get the memory used by a set, in bytes.
+ */
+size_t idset_memory(const struct idset *set);
+
+/**
+ * Destroy a set.
+ */
+void idset_destroy(struct idset *set);
+
+/**
+ * An entry in an idmap.
+ */
+struct idmap_entry {
+	/** The file identity. */
+	struct bfs_id id;
+	/** The number of references to this file (zero for empty slots). */
+	size_t refs;
+	/** A pointer for the caller's use. */
+	void *ptr;
+};
+
+/**
+ * An open-addressing hash map of reference-counted (dev, ino) pairs.
+ */
+struct idmap {
+	/** The hash table. */
+	struct idmap_entry *table;
+	/** The capacity of the table minus one (or zero if unallocated). */
+	size_t mask;
+	/** The number of entries in the map. */
+	size_t size;
+};
+
+/**
+ * Initialize an empty map.
+ */
+void idmap_init(struct idmap *map);
+
+/**
+ * Look up a file in a map.
+ *
+ * @map
+ *         The map to search.
+ * @dev
+ *         The device number.
+ * @ino
+ *         The inode number.
+ * @return
+ *         The entry for that file, or NULL if it's not in the map.  Entries
+ *         may move whenever the map is modified.
+ */
+struct idmap_entry *idmap_get(const struct idmap *map, dev_t dev, ino_t ino);
+
+/**
+ * Add a reference to a file, inserting it if necessary.
+ *
+ * @map
+ *         The map to modify.
+ * @dev
+ *         The device number.
+ * @ino
+ *         The inode number.
+ * @return
+ *         The entry for that file (new entries have refs == 1 and ptr == NULL),
+ *         or NULL on failure.
+ */
+struct idmap_entry *idmap_ref(struct idmap *map, dev_t dev, ino_t ino);
+
+/**
+ * Drop a reference to a file, removing it once it has none left.  Files that
+ * aren't in the map are ignored.
+ *
+ * @map
+ *         The map to modify.
+ * @dev
+ *         The device number.
+ * @ino
+ *         The inode number.
+ */
+void idmap_unref(struct idmap *map, dev_t dev, ino_t ino);
+
+/**
+ * Destroy a map.
+ */
+void idmap_destroy(struct idmap *map);
+
+#endif // BFS_IDSET_H
@@ -0,0 +1,386 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+#include "ignore.h"
+
+#include "alloc.h"
+#include "bfs.h"
+#include "bfstd.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * A single ignore rule.
+ */
+struct ignore_rule {
+	/** The glob pattern. */
+	char *pattern;
+	/** Whether this rule re-includes files (!pattern). */
+	bool negate;
+	/** Whether this rule only matches directories (pattern/). */
+	bool dir_only;
+	/** Whether the pattern is matched against the whole relative path. */
+	bool anchored;
+};
+
+struct bfs_ignore {
+	/** The rules inherited from the ancestors, if any. */
+	const struct bfs_ignore *parent;
+	/** The offset of the children's names in their paths. */
+	size_t nameoff;
+	/** The rules, in the order they appeared. */
+	struct ignore_rule *rules;
+	/** The number of rules. */
+	size_t nrules;
+};
+
+enum bfs_ignore_files bfs_ignore_file(const char *name) {
+	if (strcmp(name, ".gitignore") == 0) {
+		return BFS_GITIGNORE;
+	} else if (strcmp(name, ".ignore") == 0) {
+		return BFS_DOTIGNORE;
+	} else {
+		return 0;
+	}
+}
+
+/** Parse a single line of an ignore file. */
+static int ignore_parse_line(struct bfs_ignore *ignore, char *line) {
+	size_t len = strlen(line);
+
+	if (len > 0 && line[len - 1] == '\r') {
+		--len;
+	}
+
+	// Trailing spaces are ignored unless they're escaped
+	while (len > 0 && line[len - 1] == ' ') {
+		if (len > 1 && line[len - 2] == '\\') {
+			break;
+		}
+		--len;
+	}
+	line[len] = '\0';
+
+	// Blank lines and comments don't match anything
+	if (len == 0 || line[0] == '#') {
+		return 0;
+	}
+
+	bool negate = false;
+	if (line[0] == '!') {
+		negate = true;
+		++line;
+		--len;
+	}
+
+	bool dir_only = false;
+	if (len > 0 && line[len - 1] == '/') {
+		dir_only = true;
+		line[--len] = '\0';
+	}
+
+	// A slash anywhere but the end anchors the pattern to this directory
+	bool anchored = strchr(line, '/');
+	if (line[0] == '/') {
+		++line;
+		--len;
+	}
+
+	if (len == 0) {
+		return 0;
+	}
+
+	char *pattern = strdup(line);
+	if (!pattern) {
+		return -1;
+	}
+
+	struct ignore_rule *rule = RESERVE(struct ignore_rule, &ignore->rules, &ignore->nrules);
+	if (!rule) {
+		free(pattern);
+		return -1;
+	}
+
+	rule->pattern = pattern;
+	rule->negate = negate;
+	rule->dir_only = dir_only;
+	rule->anchored = anchored;
+	return 0;
+}
+
+/** Read the rules from an ignore file, skipping files that can't be read. */
+static int ignore_read(struct bfs_ignore *ignore, int dfd, const char *name) {
+	// O_NONBLOCK so we don't hang on FIFOs
+	int fd = openat(dfd, name, O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK);
+	if (fd < 0) {
+		return 0;
+	}
+
+	FILE *file = fdopen(fd, "r");
+	if (!file) {
+		close_quietly(fd);
+		return -1;
+	}
+
+	int ret = 0;
+	while (true) {
+		char *line = xgetdelim(file, '\n');
+		if (!line) {
+			break;
+		}
+
+		ret = ignore_parse_line(ignore, line);
+		free(line);
+		if (ret != 0) {
+			break;
+		}
+	}
+
+	fclose(file);
+	return ret;
+}
+
+struct bfs_ignore *bfs_ignore_load(const struct bfs_ignore *parent, int dfd, enum bfs_ignore_files files, size_t nameoff) {
+	struct bfs_ignore *ignore = ZALLOC(struct bfs_ignore);
+	if (!ignore) {
+		return NULL;
+	}
+
+	ignore->parent = parent;
+	ignore->nameoff = nameoff;
+
+	// .ignore comes last so its rules take precedence
+	if (files & BFS_GITIGNORE) {
+		if (ignore_read(ignore, dfd, ".gitignore") != 0) {
+			goto fail;
+		}
+	}
+	if (files & BFS_DOTIGNORE) {
+		if (ignore_read(ignore, dfd, ".ignore") != 0) {
+			goto fail;
+		}
+	}
+
+	return ignore;
+
+fail:
+	bfs_ignore_free(ignore);
+	return NULL;
+}
+
+/** Match a POSIX character class like [:alpha:]. */
+static bool ignore_class(const char *name, size_t len, unsigned char c) {
+	static const struct {
+		const char *name;
+		int (*fn)(int c);
+	} classes[] = {
+		{"alnum", isalnum},
+		{"alpha", isalpha},
+		{"blank", isblank},
+		{"cntrl", iscntrl},
+		{"digit", isdigit},
+		{"graph", isgraph},
+		{"lower", islower},
+		{"print", isprint},
+		{"punct", ispunct},
+		{"space", isspace},
+		{"upper", isupper},
+		{"xdigit", isxdigit},
+	};
+
+	for (size_t i = 0; i < countof(classes); ++i) {
+		if (strlen(classes[i].name) == len && strncmp(classes[i].name, name, len) == 0) {
+			return classes[i].fn(c);
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Match a bracket expression like [a-z].
+ *
+ * @pat
+ *         The pattern, starting at the opening bracket.
+ * @c
+ *         The character to match.
+ * @end
+ *         Will hold the end of the bracket expression.
+ * @return
+ *         1 for a match, 0 for no match, or -1 if the bracket is unterminated.
+ */
+static int ignore_bracket(const char *pat, unsigned char c, const char **end) {
+	const char *ptr = pat + 1;
+
+	bool negate = false;
+	if (*ptr == '!' || *ptr == '^') {
+		negate = true;
+		++ptr;
+	}
+
+	bool match = false;
+	bool first = true;
+	for (; *ptr && (first || *ptr != ']'); first = false) {
+		if (ptr[0] == '[' && ptr[1] == ':') {
+			const char *name = ptr + 2;
+			const char *close = strstr(name, ":]");
+			if (close) {
+				match |= ignore_class(name, close - name, c);
+				ptr = close + 2;
+				continue;
+			}
+		}
+
+		unsigned char lo = *ptr++;
+		if (lo == '\\' && *ptr) {
+			lo = *ptr++;
+		}
+
+		unsigned char hi = lo;
+		if (ptr[0] == '-' && ptr[1] && ptr[1] != ']') {
+			++ptr;
+			hi = *ptr++;
+			if (hi == '\\' && *ptr) {
+				hi = *ptr++;
+			}
+		}
+
+		if (c >= lo && c <= hi) {
+			match = true;
+		}
+	}
+
+	if (*ptr != ']') {
+		return -1;
+	}
+
+	*end = ptr;
+	return match != negate;
+}
+
+/** Match a glob against a path, with git's rules for "**". */
+static bool ignore_glob(const char *start, const char *pat, const char *str) {
+	for (; *pat; ++pat, ++str) {
+		const char *end;
+		int ret;
+
+		switch (*pat) {
+		case '*':
+			if (pat[1] == '*' && (pat == start || pat[-1] == '/') && (pat[2] == '/' || !pat[2])) {
+				// A trailing "/**" matches everything inside
+				if (!pat[2]) {
+					return true;
+				}
+
+				// "**/" matches zero or more directories
+				pat += 3;
+				while (true) {
+					if (ignore_glob(start, pat, str)) {
+						return true;
+					}
+
+					str = strchr(str, '/');
+					if (!str) {
+						return false;
+					}
+					++str;
+				}
+			}
+
+			// Otherwise, * matches anything but a slash
+			while (*pat == '*') {
+				++pat;
+			}
+			while (true) {
+				if (ignore_glob(start, pat, str)) {
+					return true;
+				}
+				if (!*str || *str == '/') {
+					return false;
+				}
+				++str;
+			}
+
+		case '?':
+			if (!*str || *str == '/') {
+				return false;
+			}
+			break;
+
+		case '[':
+			if (!*str || *str == '/') {
+				return false;
+			}
+			ret = ignore_bracket(pat, *str, &end);
+			if (ret < 0) {
+				// Unterminated brackets are literal
+				if (*str != '[') {
+					return false;
+				}
+				break;
+			} else if (ret == 0) {
+				return false;
+			}
+			pat = end;
+			break;
+
+		case '\\':
+			if (pat[1]) {
+				++pat;
+			}
+			[[fallthrough]];
+		default:
+			if (*pat != *str) {
+				return false;
+			}
+			break;
+		}
+	}
+
+	return !*str;
+}
+
+/** Check if a rule matches a file. */
+static bool ignore_rule_match(const struct ignore_rule *rule, const char *rel, const char *name, bool dir) {
+	if (rule->dir_only && !dir) {
+		return false;
+	}
+
+	const char *str = rule->anchored ? rel : name;
+	return ignore_glob(rule->pattern, rule->pattern, str);
+}
+
+bool bfs_ignore_match(const struct bfs_ignore *ignore, const char *path, bool dir) {
+	const char *slash = strrchr(path, '/');
+	const char *name = slash ? slash + 1 : path;
+
+	// The last matching rule in the deepest directory wins
+	for (; ignore; ignore = ignore->parent) {
+		const char *rel = path + ignore->nameoff;
+		for (size_t i = ignore->nrules; i-- > 0;) {
+			const struct ignore_rule *rule = &ignore->rules[i];
+			if (ignore_rule_match(rule, rel, name, dir)) {
+				return !rule->negate;
+			}
+		}
+	}
+
+	return false;
+}
+
+void bfs_ignore_free(struct bfs_ignore *ignore) {
+	if (!ignore) {
+		return;
+	}
+
+	for (size_t i = 0; i < ignore->nrules; ++i) {
+		free(ignore->rules[i].pattern);
+	}
+	free(ignore->rules);
+	free(ignore);
+}
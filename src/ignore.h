@@ -0,0 +1,78 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+/**
+ * .gitignore-style rules, for -ignore-vcs.
+ *
+ * Each directory with an ignore file gets its own set of rules, which points
+ * to the rules of the nearest ancestor that has any.  Rules from deeper
+ * directories take precedence, and within a directory, later rules take
+ * precedence over earlier ones, like in git.
+ */
+
+#ifndef BFS_IGNORE_H
+#define BFS_IGNORE_H
+
+#include <stddef.h>
+
+/**
+ * The ignore files that can be found in a directory.
+ */
+enum bfs_ignore_files {
+	/** A .gitignore file. */
+	BFS_GITIGNORE = 1 << 0,
+	/** An .ignore file, whose rules take precedence over .gitignore. */
+	BFS_DOTIGNORE = 1 << 1,
+};
+
+/**
+ * The ignore rules for a directory.
+ */
+struct bfs_ignore;
+
+/**
+ * Check whether a directory entry is an ignore file.
+ *
+ * @name
+ *         The name of the directory entry.
+ * @return
+ *         The kind of ignore file, or 0 if it isn't one.
+ */
+enum bfs_ignore_files bfs_ignore_file(const char *name);
+
+/**
+ * Load the ignore rules for a directory.
+ *
+ * @parent
+ *         The rules inherited from the directory's ancestors, if any.
+ * @dfd
+ *         An open file descriptor for the directory.
+ * @files
+ *         The ignore files to read.  Files that can't be read are skipped.
+ * @nameoff
+ *         The offset of the directory's children's names in their paths.
+ * @return
+ *         The loaded rules, or NULL on failure.
+ */
+struct bfs_ignore *bfs_ignore_load(const struct bfs_ignore *parent, int dfd, enum bfs_ignore_files files, size_t nameoff);
+
+/**
+ * Check whether a file is ignored.
+ *
+ * @ignore
+ *         The rules of the nearest ancestor directory that has any.
+ * @path
+ *         The full path to the file.
+ * @dir
+ *         Whether the file is a directory.
+ * @return
+ *         Whether the file should be ignored.
+ */
+bool bfs_ignore_match(const struct bfs_ignore *ignore, const char *path, bool dir);
+
+/**
+ * Free the ignore rules for a directory.  The parent rules are not freed.
+ */
+void bfs_ignore_free(struct bfs_ignore *ignore);
+
+#endif // BFS_IGNORE_H
@@ -543,9 +543,11 @@ static struct ioq_ent IOQ_STOP;
  * Supported io_uring operations.
  */
 enum ioq_ring_ops {
-	IOQ_RING_OPENAT = 1 << 0,
-	IOQ_RING_CLOSE  = 1 << 1,
-	IOQ_RING_STATX  = 1 << 2,
+	IOQ_RING_OPENAT   = 1 << 0,
+	IOQ_RING_CLOSE    = 1 << 1,
+	IOQ_RING_STATX    = 1 << 2,
+	IOQ_RING_UNLINKAT = 1 << 3,
+	IOQ_RING_READ     = 1 << 4,
 };
 #endif
 
@@ -609,10 +611,35 @@ static bool ioq_check_cancel(struct ioq *ioq, struct ioq_ent *ent) {
 		return false;
 	}
 
+	// The caller has already reported the file as deleted
+	if (ent->op == IOQ_UNLINK) {
+		return false;
+	}
+
 	ent->result = -EINTR;
 	return true;
 }
 
+/** pread() until EOF or an error, like xread(). */
+static ssize_t ioq_pread(int fd, void *buf, size_t size, off_t offset) {
+	size_t count = 0;
+
+	while (count < size) {
+		ssize_t ret = pread(fd, (char *)buf + count, size - count, offset + count);
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		} else if (ret == 0) {
+			break;
+		}
+		count += ret;
+	}
+
+	return count;
+}
+
 /** Dispatch a single request synchronously. */
 static void ioq_dispatch_sync(struct ioq *ioq, struct ioq_ent *ent) {
 	switch (ent->op) {
@@ -646,6 +673,18 @@ static void ioq_dispatch_sync(struct ioq *ioq, struct ioq_ent *ent) {
 			ent->result = try(bfs_stat(args->dfd, args->path, args->flags, args->buf));
 			return;
 		}
+
+		case IOQ_UNLINK: {
+			struct ioq_unlink *args = &ent->unlink;
+			ent->result = try(unlinkat(args->dfd, args->path, args->flags));
+			return;
+		}
+
+		case IOQ_READ: {
+			struct ioq_read *args = &ent->read;
+			ent->result = try(ioq_pread(args->fd, args->buf, args->size, args->offset));
+			return;
+		}
 	}
 
 	bfs_bug("Unknown ioq_op %d", (int)ent->op);
@@ -709,6 +748,19 @@ static void ioq_reap_cqe(struct ioq_ring_state *state, struct io_uring_cqe *cqe)
 		}
 #endif
 
+		case IOQ_READ: {
+			// io_uring can return short reads before EOF, so finish
+			// them synchronously
+			struct ioq_read *args = &ent->read;
+			size_t count = ent->result;
+			if (count > 0 && count < args->size) {
+				char *buf = args->buf;
+				ssize_t ret = ioq_pread(args->fd, buf + count, args->size - count, args->offset + count);
+				ent->result = ret < 0 ? -errno : (int)(count + ret);
+			}
+			break;
+		}
+
 		default:
 			break;
 	}
@@ -855,6 +907,22 @@ static struct io_uring_sqe *ioq_dispatch_async(struct ioq_ring_state *state, str
 		}
 #endif
 		return sqe;
+
+	case IOQ_UNLINK:
+		if (ops & IOQ_RING_UNLINKAT) {
+			sqe = ioq_get_sqe(state);
+			struct ioq_unlink *args = &ent->unlink;
+			io_uring_prep_unlinkat(sqe, args->dfd, args->path, args->flags);
+		}
+		return sqe;
+
+	case IOQ_READ:
+		if (ops & IOQ_RING_READ) {
+			sqe = ioq_get_sqe(state);
+			struct ioq_read *args = &ent->read;
+			io_uring_prep_read(sqe, args->fd, args->buf, args->size, args->offset);
+		}
+		return sqe;
 	}
 
 	bfs_bug("Unknown ioq_op %d", (int)ent->op);
@@ -1079,6 +1147,12 @@ static int ioq_ring_init(struct ioq *ioq, struct ioq_thread *thread) {
 			thread->ring_ops |= IOQ_RING_STATX;
 		}
 #endif
+		if (io_uring_opcode_supported(probe, IORING_OP_UNLINKAT)) {
+			thread->ring_ops |= IOQ_RING_UNLINKAT;
+		}
+		if (io_uring_opcode_supported(probe, IORING_OP_READ)) {
+			thread->ring_ops |= IOQ_RING_READ;
+		}
 		io_uring_free_probe(probe);
 	}
 	if (!thread->ring_ops) {
@@ -1279,6 +1353,37 @@ int ioq_stat(struct ioq *ioq, int dfd, const char *path, enum bfs_stat_flags fla
 	return 0;
 }
 
+int ioq_unlink(struct ioq *ioq, int dfd, const char *path, int flags, void *ptr) {
+	struct ioq_ent *ent = ioq_request(ioq, IOQ_UNLINK, ptr);
+	if (!ent) {
+		return -1;
+	}
+
+	struct ioq_unlink *args = &ent->unlink;
+	args->dfd = dfd;
+	args->path = path;
+	args->flags = flags;
+
+	ioq_batch_push(ioq->pending, &ioq->pending_batch, ent);
+	return 0;
+}
+
+int ioq_read(struct ioq *ioq, int fd, void *buf, size_t size, off_t offset, void *ptr) {
+	struct ioq_ent *ent = ioq_request(ioq, IOQ_READ, ptr);
+	if (!ent) {
+		return -1;
+	}
+
+	struct ioq_read *args = &ent->read;
+	args->fd = fd;
+	args->buf = buf;
+	args->size = size;
+	args->offset = offset;
+
+	ioq_batch_push(ioq->pending, &ioq->pending_batch, ent);
+	return 0;
+}
+
 void ioq_submit(struct ioq *ioq) {
 	ioq_batch_flush(ioq->pending, &ioq->pending_batch);
 }
@@ -13,6 +13,7 @@
 #include "stat.h"
 
 #include <stddef.h>
+#include <sys/types.h>
 
 /**
  * A queue of asynchronous I/O operations.
@@ -33,6 +34,10 @@ enum ioq_op {
 	IOQ_CLOSEDIR,
 	/** ioq_stat(). */
 	IOQ_STAT,
+	/** ioq_unlink(). */
+	IOQ_UNLINK,
+	/** ioq_read(). */
+	IOQ_READ,
 };
 
 /**
@@ -87,6 +92,19 @@ struct ioq_ent {
 			int dfd;
 			enum bfs_stat_flags flags;
 		} stat;
+		/** ioq_unlink() args. */
+		struct ioq_unlink {
+			const char *path;
+			int dfd;
+			int flags;
+		} unlink;
+		/** ioq_read() args. */
+		struct ioq_read {
+			int fd;
+			void *buf;
+			size_t size;
+			off_t offset;
+		} read;
 	};
 };
 
@@ -189,6 +207,45 @@ int ioq_closedir(struct ioq *ioq, struct bfs_dir *dir, void *ptr);
  */
 int ioq_stat(struct ioq *ioq, int dfd, const char *path, enum bfs_stat_flags flags, struct bfs_stat *buf, void *ptr);
 
+/**
+ * Asynchronous unlinkat().
+ *
+ * @ioq
+ *         The I/O queue.
+ * @dfd
+ *         The base file descriptor.
+ * @path
+ *         The path to unlink, relative to dfd.
+ * @flags
+ *         Flags for unlinkat(), e.g. AT_REMOVEDIR.
+ * @ptr
+ *         An arbitrary pointer to associate with the request.
+ * @return
+ *         0 on success, or -1 on failure.
+ */
+int ioq_unlink(struct ioq *ioq, int dfd, const char *path, int flags, void *ptr);
+
+/**
+ * Asynchronous pread().
+ *
+ * @ioq
+ *         The I/O queue.
+ * @fd
+ *         The file descriptor to read from.
+ * @buf
+ *         The buffer to read into.
+ * @size
+ *         The maximum number of bytes to read.
+ * @offset
+ *         The offset in the file to read from.
+ * @ptr
+ *         An arbitrary pointer to associate with the request.
+ * @return
+ *         0 on success, or -1 on failure.  On completion, the result is the
+ *         number of bytes read, which is only short at the end of the file.
+ */
+int ioq_read(struct ioq *ioq, int fd, void *buf, size_t size, off_t offset, void *ptr);
+
 /**
  * Submit any buffered requests.
  */
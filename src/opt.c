@@ -27,6 +27,7 @@
 
 #include "opt.h"
 
+#include "alloc.h"
 #include "bfs.h"
 #include "bfstd.h"
 #include "bftw.h"
@@ -40,12 +41,15 @@
 #include "expr.h"
 #include "list.h"
 #include "pwcache.h"
+#include "sort.h"
+#include "top.h"
 #include "xspawn.h"
 
 #include <errno.h>
 #include <limits.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
 static char *fake_and_arg = "-and";
@@ -268,6 +272,108 @@ static const char *const range_names[] = {
 	[UID_RANGE] = "-uid",
 };
 
+/** The maximum number of -path prefixes we track. */
+#define MAX_PATH_PREFIXES 8
+
+/**
+ * The data flow domain for -path patterns.  We track a set of literal
+ * prefixes, at least one of which the current path must start with.
+ */
+struct df_paths {
+	/** The number of prefixes, or -1 for ⊤.  The empty set is ⊥. */
+	int count;
+	/** The literal path prefixes. */
+	struct df_prefix {
+		/** The prefix itself (not NUL-terminated). */
+		const char *str;
+		/** The length of the prefix. */
+		size_t len;
+	} prefixes[MAX_PATH_PREFIXES];
+};
+
+/** Initialize an empty set of prefixes. */
+static void paths_init_bottom(struct df_paths *paths) {
+	paths->count = 0;
+}
+
+/** Check for an empty set of prefixes. */
+static bool paths_is_bottom(const struct df_paths *paths) {
+	return paths->count == 0;
+}
+
+/** Initialize an unknown set of prefixes. */
+static void paths_init_top(struct df_paths *paths) {
+	paths->count = -1;
+}
+
+/** Check for an unknown set of prefixes. */
+static bool paths_is_top(const struct df_paths *paths) {
+	return paths->count < 0;
+}
+
+/** Check if a prefix starts with another prefix. */
+static bool prefix_starts_with(const struct df_prefix *prefix, const struct df_prefix *other) {
+	return prefix->len >= other->len && memcmp(prefix->str, other->str, other->len) == 0;
+}
+
+/** Add a prefix to a set (computing their union). */
+static void paths_add(struct df_paths *paths, const struct df_prefix *prefix) {
+	if (paths_is_top(paths)) {
+		return;
+	}
+
+	// Longer prefixes are subsumed by shorter ones
+	int count = 0;
+	for (int i = 0; i < paths->count; ++i) {
+		const struct df_prefix *other = &paths->prefixes[i];
+		if (prefix_starts_with(prefix, other)) {
+			return;
+		} else if (!prefix_starts_with(other, prefix)) {
+			paths->prefixes[count++] = *other;
+		}
+	}
+
+	if (count == MAX_PATH_PREFIXES) {
+		paths_init_top(paths);
+	} else {
+		paths->prefixes[count++] = *prefix;
+		paths->count = count;
+	}
+}
+
+/** Compute the union of two sets of prefixes. */
+static void paths_join(struct df_paths *dest, const struct df_paths *src) {
+	if (paths_is_top(src)) {
+		paths_init_top(dest);
+		return;
+	}
+
+	for (int i = 0; i < src->count; ++i) {
+		paths_add(dest, &src->prefixes[i]);
+	}
+}
+
+/** Constrain a set of prefixes by a known prefix. */
+static void constrain_paths(struct df_paths *paths, const struct df_prefix *prefix) {
+	if (paths_is_top(paths)) {
+		paths->prefixes[0] = *prefix;
+		paths->count = 1;
+		return;
+	}
+
+	// If the path starts with both prefixes, one must start with the other
+	int count = 0;
+	for (int i = 0; i < paths->count; ++i) {
+		const struct df_prefix *other = &paths->prefixes[i];
+		if (prefix_starts_with(other, prefix)) {
+			paths->prefixes[count++] = *other;
+		} else if (prefix_starts_with(prefix, other)) {
+			paths->prefixes[count++] = *prefix;
+		}
+	}
+	paths->count = count;
+}
+
 /**
  * The data flow analysis domain.
  */
@@ -282,6 +388,9 @@ struct df_domain {
 	unsigned int types;
 	/** Bitmask of possible -xtypes. */
 	unsigned int xtypes;
+
+	/** Possible -path prefixes. */
+	struct df_paths paths;
 };
 
 /** Set a data flow value to bottom. */
@@ -296,6 +405,8 @@ static void df_init_bottom(struct df_domain *value) {
 
 	value->types = 0;
 	value->xtypes = 0;
+
+	paths_init_bottom(&value->paths);
 }
 
 /** Determine whether a fact set is impossible. */
@@ -316,6 +427,10 @@ static bool df_is_bottom(const struct df_domain *value) {
 		return true;
 	}
 
+	if (paths_is_bottom(&value->paths)) {
+		return true;
+	}
+
 	return false;
 }
 
@@ -331,6 +446,8 @@ static void df_init_top(struct df_domain *value) {
 
 	value->types = ~0;
 	value->xtypes = ~0;
+
+	paths_init_top(&value->paths);
 }
 
 /** Check for the top element. */
@@ -355,6 +472,10 @@ static bool df_is_top(const struct df_domain *value) {
 		return false;
 	}
 
+	if (!paths_is_top(&value->paths)) {
+		return false;
+	}
+
 	return true;
 }
 
@@ -370,6 +491,8 @@ static void df_join(struct df_domain *dest, const struct df_domain *src) {
 
 	dest->types |= src->types;
 	dest->xtypes |= src->xtypes;
+
+	paths_join(&dest->paths, &src->paths);
 }
 
 /**
@@ -566,6 +689,26 @@ static void types_dump(dump_fn *dump, struct bfs_opt *opt, const char *name, uns
 	}
 }
 
+/** Print a set of -path prefixes. */
+static void paths_dump(dump_fn *dump, struct bfs_opt *opt, const struct df_paths *paths) {
+	dump(opt, "${blu}-path${rs}: ");
+
+	FILE *file = opt->ctx->cerr->file;
+	if (paths_is_bottom(paths)) {
+		fprintf(file, "⊥\n");
+		return;
+	} else if (paths_is_top(paths)) {
+		fprintf(file, "⊤\n");
+		return;
+	}
+
+	for (int i = 0; i < paths->count; ++i) {
+		const struct df_prefix *prefix = &paths->prefixes[i];
+		fprintf(file, "%s\"%.*s*\"", i > 0 ? ", " : "", (int)prefix->len, prefix->str);
+	}
+	fprintf(file, "\n");
+}
+
 /** Calculate the number of lines of df_dump() output. */
 static int df_dump_lines(const struct df_domain *value) {
 	int lines = 0;
@@ -580,6 +723,7 @@ static int df_dump_lines(const struct df_domain *value) {
 
 	lines += value->types != ~0U;
 	lines += value->xtypes != ~0U;
+	lines += !paths_is_top(&value->paths);
 
 	return lines;
 }
@@ -635,6 +779,10 @@ static void df_dump(struct bfs_opt *opt, const char *str, const struct df_domain
 	if (value->xtypes != ~0U) {
 		types_dump(df_dump_line(lines, &line), opt, "-xtype", value->xtypes);
 	}
+
+	if (!paths_is_top(&value->paths)) {
+		paths_dump(df_dump_line(lines, &line), opt, &value->paths);
+	}
 }
 
 /** Check if an expression is constant. */
@@ -975,6 +1123,17 @@ static struct bfs_expr *annotate_access(struct bfs_opt *opt, struct bfs_expr *ex
 	return expr;
 }
 
+/** Annotate -i?contains. */
+static struct bfs_expr *annotate_contains(struct bfs_opt *opt, struct bfs_expr *expr, const struct visitor *visitor) {
+	if (opt->level >= 4) {
+		// Like -empty, -contains may report errors opening files, so
+		// it's only pure with aggressive optimizations
+		expr->pure = true;
+	}
+
+	return expr;
+}
+
 /** Annotate -empty. */
 static struct bfs_expr *annotate_empty(struct bfs_opt *opt, struct bfs_expr *expr, const struct visitor *visitor) {
 	if (opt->level >= 4) {
@@ -1016,6 +1175,18 @@ static struct bfs_expr *annotate_fprint(struct bfs_opt *opt, struct bfs_expr *ex
 	return expr;
 }
 
+/** Annotate -sort-by. */
+static struct bfs_expr *annotate_sort_by(struct bfs_opt *opt, struct bfs_expr *expr, const struct visitor *visitor) {
+	expr->calls_stat = bfs_sort_needs_stat(expr->sort);
+	return expr;
+}
+
+/** Annotate -top. */
+static struct bfs_expr *annotate_top(struct bfs_opt *opt, struct bfs_expr *expr, const struct visitor *visitor) {
+	expr->calls_stat = bfs_top_needs_stat(expr->top);
+	return expr;
+}
+
 /** Estimate probability for -x?type. */
 static void estimate_type_probability(struct bfs_expr *expr) {
 	unsigned int types = expr->num;
@@ -1180,13 +1351,21 @@ static struct bfs_expr *annotate_visit(struct bfs_opt *opt, struct bfs_expr *exp
 
 	/** Table of always-true expressions. */
 	static bfs_eval_fn *const always_true[] = {
+		eval_du,
+		eval_duplicates,
 		eval_fls,
 		eval_fprint,
 		eval_fprint0,
+		eval_fprintbin,
 		eval_fprintf,
+		eval_fprintjson,
 		eval_fprintx,
+		eval_hash,
 		eval_limit,
 		eval_prune,
+		eval_sort_by,
+		eval_summarize,
+		eval_top,
 		eval_true,
 		// Non-returning
 		eval_exit,
@@ -1219,10 +1398,13 @@ static struct bfs_expr *annotate_visit(struct bfs_opt *opt, struct bfs_expr *exp
 
 	/** Table of stat-calling primaries. */
 	static bfs_eval_fn *const calls_stat[] = {
+		eval_duplicates,
 		eval_empty,
 		eval_flags,
 		eval_fls,
+		eval_fprintbin,
 		eval_fprintf,
+		eval_fprintjson,
 		eval_fstype,
 		eval_gid,
 		eval_inum,
@@ -1234,6 +1416,7 @@ static struct bfs_expr *annotate_visit(struct bfs_opt *opt, struct bfs_expr *exp
 		eval_samefile,
 		eval_size,
 		eval_sparse,
+		eval_summarize,
 		eval_time,
 		eval_uid,
 		eval_used,
@@ -1262,15 +1445,21 @@ static struct bfs_expr *annotate_visit(struct bfs_opt *opt, struct bfs_expr *exp
 		{eval_access,    STAT_COST},
 		{eval_acl,       STAT_COST},
 		{eval_capable,   STAT_COST},
+		{eval_contains, 20 * STAT_COST}, // read() is much worse than stat()
 		{eval_empty, 2 * STAT_COST}, // readdir() is worse than stat()
+		{eval_du,       PRINT_COST},
+		{eval_duplicates, STAT_COST},
 		{eval_flags,     STAT_COST},
 		{eval_fls,      PRINT_COST},
 		{eval_fprint,   PRINT_COST},
 		{eval_fprint0,  PRINT_COST},
+		{eval_fprintbin, PRINT_COST},
 		{eval_fprintf,  PRINT_COST},
+		{eval_fprintjson, PRINT_COST},
 		{eval_fprintx,  PRINT_COST},
 		{eval_fstype,    STAT_COST},
 		{eval_gid,       STAT_COST},
+		{eval_hash,     PRINT_COST},
 		{eval_inum,      STAT_COST},
 		{eval_links,     STAT_COST},
 		{eval_lname,  FNMATCH_COST},
@@ -1282,8 +1471,11 @@ static struct bfs_expr *annotate_visit(struct bfs_opt *opt, struct bfs_expr *exp
 		{eval_perm,      STAT_COST},
 		{eval_samefile,  STAT_COST},
 		{eval_size,      STAT_COST},
+		{eval_sort_by,   STAT_COST},
 		{eval_sparse,    STAT_COST},
+		{eval_summarize, STAT_COST},
 		{eval_time,      STAT_COST},
+		{eval_top,       STAT_COST},
 		{eval_uid,       STAT_COST},
 		{eval_used,      STAT_COST},
 		{eval_xattr,     STAT_COST},
@@ -1337,12 +1529,15 @@ static const struct visitor annotate = {
 	.visit = annotate_visit,
 	.table = (const struct visitor_table[]) {
 		{eval_access, annotate_access},
+		{eval_contains, annotate_contains},
 		{eval_empty, annotate_empty},
 		{eval_exec, annotate_exec},
 		{eval_fprint, annotate_fprint},
 		{eval_lname, annotate_fnmatch},
 		{eval_name, annotate_fnmatch},
 		{eval_path, annotate_fnmatch},
+		{eval_sort_by, annotate_sort_by},
+		{eval_top, annotate_top},
 		{eval_type, annotate_type},
 		{eval_xtype, annotate_xtype},
 
@@ -1726,6 +1921,24 @@ static struct bfs_expr *data_flow_lname(struct bfs_opt *opt, struct bfs_expr *ex
 	return expr;
 }
 
+/** Transfer function for -path. */
+static struct bfs_expr *data_flow_path(struct bfs_opt *opt, struct bfs_expr *expr, const struct visitor *visitor) {
+	if (expr->fnm_flags) {
+		// -ipath
+		return expr;
+	}
+
+	struct df_prefix prefix = {
+		.str = expr->pattern,
+		.len = strcspn(expr->pattern, "?*\\["),
+	};
+	if (prefix.len > 0) {
+		constrain_paths(&opt->after_true.paths, &prefix);
+	}
+
+	return expr;
+}
+
 /** Transfer function for -samefile. */
 static struct bfs_expr *data_flow_samefile(struct bfs_opt *opt, struct bfs_expr *expr, const struct visitor *visitor) {
 	struct df_range *true_range = &opt->after_true.ranges[INUM_RANGE];
@@ -1995,6 +2208,7 @@ static const struct visitor data_flow = {
 		{eval_inum, data_flow_inum},
 		{eval_links, data_flow_links},
 		{eval_lname, data_flow_lname},
+		{eval_path, data_flow_path},
 		{eval_samefile, data_flow_samefile},
 		{eval_size, data_flow_size},
 		{eval_type, data_flow_type},
@@ -2201,6 +2415,18 @@ static struct bfs_expr *simplify_comma(struct bfs_opt *opt, struct bfs_expr *exp
 	return expr;
 }
 
+/** Simplify -delete. */
+static struct bfs_expr *simplify_delete(struct bfs_opt *opt, struct bfs_expr *expr, const struct visitor *visitor) {
+	// If nothing depends on whether the deletion succeeded, it can happen
+	// asynchronously
+	expr->delete_async = opt->ignore_result;
+	if (expr->delete_async) {
+		opt_debug(opt, "asynchronous\n");
+	}
+
+	return expr;
+}
+
 /**
  * Logical simplification visitor.
  */
@@ -2211,6 +2437,7 @@ static const struct visitor simplify = {
 		{eval_and, simplify_and},
 		{eval_or, simplify_or},
 		{eval_comma, simplify_comma},
+		{eval_delete, simplify_delete},
 		{NULL, NULL},
 	},
 };
@@ -2334,6 +2561,29 @@ static bool single_exec(const struct bfs_expr *expr) {
 	return expr->eval_fn == eval_exec && !(expr->exec->flags & BFS_EXEC_MULTI);
 }
 
+/** Prune directories that can't contain any matches for the -path prefixes. */
+static int opt_prune_paths(struct bfs_opt *opt, const struct df_paths *paths) {
+	struct bfs_ctx *ctx = opt->ctx;
+
+	ctx->prefixes = ALLOC_ARRAY(char *, paths->count);
+	if (!ctx->prefixes) {
+		return -1;
+	}
+
+	for (int i = 0; i < paths->count; ++i) {
+		const struct df_prefix *prefix = &paths->prefixes[i];
+		char *str = strndup(prefix->str, prefix->len);
+		if (!str) {
+			return -1;
+		}
+		ctx->prefixes[ctx->nprefixes++] = str;
+
+		opt_visit(opt, "${blu}-path${rs} prefix ${bld}%pq${rs}\n", str);
+	}
+
+	return 0;
+}
+
 int bfs_optimize(struct bfs_ctx *ctx) {
 	bfs_ctx_dump(ctx, DEBUG_OPT);
 
@@ -2391,7 +2641,11 @@ int bfs_optimize(struct bfs_ctx *ctx) {
 		opt_leave(&opt, "${blu}-mindepth${rs} ${bld}%d${rs}\n", ctx->mindepth);
 	}
 
-	if (opt.level >= 4 && maxdepth < ctx->maxdepth) {
+	// -du needs to see every file below the directories it prints, so we
+	// can't prune the walk based on where the impure expressions are
+	bool prune = opt.level >= 4 && !ctx->du;
+
+	if (prune && maxdepth < ctx->maxdepth) {
 		if (maxdepth < INT_MIN) {
 			maxdepth = INT_MIN;
 		}
@@ -2400,6 +2654,13 @@ int bfs_optimize(struct bfs_ctx *ctx) {
 		opt_leave(&opt, "${blu}-maxdepth${rs} ${bld}%d${rs}\n", ctx->maxdepth);
 	}
 
+	const struct df_paths *impure_paths = &impure.paths;
+	if (prune && !paths_is_top(impure_paths) && !paths_is_bottom(impure_paths)) {
+		if (opt_prune_paths(&opt, impure_paths) != 0) {
+			return -1;
+		}
+	}
+
 	if (opt.level >= 3) {
 		// bfs_eval() can do lazy stat() calls, but only on one thread.
 		float lazy_cost = estimate_stat_odds(ctx);
@@ -0,0 +1,208 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+#include "outq.h"
+
+#include "alloc.h"
+#include "bfstd.h"
+#include "thread.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct outq {
+	/** The file descriptor to write to. */
+	int fd;
+	/** The ring buffer. */
+	char *buf;
+	/** The capacity of the ring buffer. */
+	size_t size;
+
+	/** Protects the fields below. */
+	pthread_mutex_t mutex;
+	/** Signalled when data is added, or when we're stopping. */
+	pthread_cond_t not_empty;
+	/** Signalled when data is removed. */
+	pthread_cond_t not_full;
+
+	/** The offset of the oldest queued byte. */
+	size_t head;
+	/** The number of queued bytes. */
+	size_t len;
+	/** The first write error since the last drain. */
+	int error;
+	/** Whether the writer thread should exit. */
+	bool stop;
+
+	/** The writer thread. */
+	pthread_t thread;
+};
+
+/** The writer thread. */
+static void *outq_work(void *ptr) {
+	struct outq *outq = ptr;
+
+	mutex_lock(&outq->mutex);
+
+	while (true) {
+		while (outq->len == 0 && !outq->stop) {
+			cond_wait(&outq->not_empty, &outq->mutex);
+		}
+		if (outq->len == 0) {
+			break;
+		}
+
+		// Only we modify head, and the producer never touches
+		// [head, head + len), so we can write without the lock
+		size_t head = outq->head;
+		size_t chunk = outq->size - head;
+		if (chunk > outq->len) {
+			chunk = outq->len;
+		}
+
+		mutex_unlock(&outq->mutex);
+		size_t ret = xwrite(outq->fd, outq->buf + head, chunk);
+		int error = errno;
+		mutex_lock(&outq->mutex);
+
+		if (ret != chunk && !outq->error) {
+			outq->error = error ? error : EIO;
+		}
+
+		// Discard the data even on failure, so we don't block forever
+		outq->head = (head + chunk) % outq->size;
+		outq->len -= chunk;
+		cond_broadcast(&outq->not_full);
+	}
+
+	mutex_unlock(&outq->mutex);
+	return NULL;
+}
+
+struct outq *outq_create(int fd, size_t size) {
+	struct outq *outq = ZALLOC(struct outq);
+	if (!outq) {
+		return NULL;
+	}
+
+	outq->fd = fd;
+	outq->size = size;
+	outq->buf = malloc(size);
+	if (!outq->buf) {
+		goto fail;
+	}
+
+	if (mutex_init(&outq->mutex, NULL) != 0) {
+		goto fail_buf;
+	}
+	if (cond_init(&outq->not_empty, NULL) != 0) {
+		goto fail_mutex;
+	}
+	if (cond_init(&outq->not_full, NULL) != 0) {
+		goto fail_not_empty;
+	}
+
+	if (thread_create(&outq->thread, NULL, outq_work, outq) != 0) {
+		goto fail_not_full;
+	}
+	thread_setname(outq->thread, "outq");
+
+	return outq;
+
+fail_not_full:
+	cond_destroy(&outq->not_full);
+fail_not_empty:
+	cond_destroy(&outq->not_empty);
+fail_mutex:
+	mutex_destroy(&outq->mutex);
+fail_buf:
+	free(outq->buf);
+fail:
+	free(outq);
+	return NULL;
+}
+
+int outq_write(struct outq *outq, const void *buf, size_t len) {
+	const char *bytes = buf;
+	int ret = 0;
+
+	mutex_lock(&outq->mutex);
+
+	while (len > 0) {
+		while (outq->len == outq->size && !outq->error) {
+			cond_wait(&outq->not_full, &outq->mutex);
+		}
+
+		if (outq->error) {
+			errno = outq->error;
+			ret = -1;
+			break;
+		}
+
+		size_t tail = (outq->head + outq->len) % outq->size;
+		size_t chunk = outq->size - outq->len;
+		if (chunk > outq->size - tail) {
+			chunk = outq->size - tail;
+		}
+		if (chunk > len) {
+			chunk = len;
+		}
+
+		// The writer thread never touches the free space, so we can
+		// copy into it without the lock
+		mutex_unlock(&outq->mutex);
+		memcpy(outq->buf + tail, bytes, chunk);
+		mutex_lock(&outq->mutex);
+
+		outq->len += chunk;
+		bytes += chunk;
+		len -= chunk;
+		cond_signal(&outq->not_empty);
+	}
+
+	mutex_unlock(&outq->mutex);
+	return ret;
+}
+
+int outq_drain(struct outq *outq) {
+	mutex_lock(&outq->mutex);
+
+	while (outq->len > 0) {
+		cond_wait(&outq->not_full, &outq->mutex);
+	}
+
+	int error = outq->error;
+	outq->error = 0;
+
+	mutex_unlock(&outq->mutex);
+
+	if (error) {
+		errno = error;
+		return -1;
+	} else {
+		return 0;
+	}
+}
+
+int outq_destroy(struct outq *outq) {
+	int ret = outq_drain(outq);
+	int error = errno;
+
+	mutex_lock(&outq->mutex);
+	outq->stop = true;
+	cond_signal(&outq->not_empty);
+	mutex_unlock(&outq->mutex);
+
+	thread_join(outq->thread, NULL);
+
+	cond_destroy(&outq->not_full);
+	cond_destroy(&outq->not_empty);
+	mutex_destroy(&outq->mutex);
+	free(outq->buf);
+	free(outq);
+
+	errno = error;
+	return ret;
+}
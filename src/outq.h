@@ -0,0 +1,61 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+/**
+ * Asynchronous output queues.
+ */
+
+#ifndef BFS_OUTQ_H
+#define BFS_OUTQ_H
+
+#include <stddef.h>
+
+/**
+ * A bounded ring buffer of output, written to a file descriptor by a
+ * background thread.
+ */
+struct outq;
+
+/**
+ * Create an output queue.
+ *
+ * @fd
+ *         The file descriptor to write to.
+ * @size
+ *         The capacity of the ring buffer, in bytes.
+ * @return
+ *         The new output queue, or NULL on failure.
+ */
+struct outq *outq_create(int fd, size_t size);
+
+/**
+ * Add some data to an output queue, blocking while it is full.
+ *
+ * @outq
+ *         The output queue.
+ * @buf
+ *         The data to write.
+ * @len
+ *         The length of the data.
+ * @return
+ *         0 on success, or -1 if a previous write has failed.
+ */
+int outq_write(struct outq *outq, const void *buf, size_t len);
+
+/**
+ * Wait for all queued data to be written.
+ *
+ * @return
+ *         0 on success, or -1 if any write has failed since the last call.
+ */
+int outq_drain(struct outq *outq);
+
+/**
+ * Drain and destroy an output queue.
+ *
+ * @return
+ *         The result of outq_drain().
+ */
+int outq_destroy(struct outq *outq);
+
+#endif // BFS_OUTQ_H
@@ -15,19 +15,26 @@
 #include "bfstd.h"
 #include "bftw.h"
 #include "color.h"
+#include "contains.h"
 #include "ctx.h"
 #include "diag.h"
 #include "dir.h"
+#include "dupes.h"
 #include "eval.h"
 #include "exec.h"
 #include "expr.h"
 #include "fsade.h"
+#include "hash.h"
 #include "list.h"
 #include "opt.h"
+#include "printbin.h"
 #include "printf.h"
 #include "pwcache.h"
 #include "sanity.h"
+#include "sort.h"
 #include "stat.h"
+#include "summary.h"
+#include "top.h"
 #include "typo.h"
 #include "xregex.h"
 #include "xspawn.h"
@@ -43,11 +50,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <time.h>
 #include <unistd.h>
 
+#if __linux__
+#  include <linux/capability.h>
+#  include <linux/securebits.h>
+#  include <sys/prctl.h>
+#  include <sys/syscall.h>
+#endif
+
 // Strings printed by -D tree for "fake" expressions
 static char *fake_and_arg = "-and";
 static char *fake_hidden_arg = "-hidden";
@@ -107,6 +122,8 @@ struct bfs_parser {
 	const struct bfs_expr *files0_expr;
 	/** An expression that consumes stdin, if any. */
 	const struct bfs_expr *stdin_expr;
+	/** The printing actions, in parse order. */
+	struct bfs_exprs outputs;
 
 	/** The current time (maybe modified by -daystart). */
 	struct timespec now;
@@ -327,6 +344,7 @@ static struct bfs_expr *new_binary_expr(const struct bfs_parser *parser, bfs_eva
 static void init_print_expr(struct bfs_parser *parser, struct bfs_expr *expr) {
 	expr->cfile = parser->ctx->cout;
 	expr->path = NULL;
+	SLIST_APPEND(&parser->outputs, expr, outputs);
 }
 
 /**
@@ -359,6 +377,7 @@ static int expr_open(struct bfs_parser *parser, struct bfs_expr *expr, const cha
 
 	expr->cfile = dedup;
 	expr->path = path;
+	SLIST_APPEND(&parser->outputs, expr, outputs);
 	return 0;
 
 fail:
@@ -791,6 +810,11 @@ static void debug_help(CFILE *cfile) {
 	cfprintf(cfile, "  ${bld}stat${rs}:   Trace all stat() calls.\n");
 	cfprintf(cfile, "  ${bld}tree${rs}:   Print the parse tree.\n");
 	cfprintf(cfile, "  ${bld}all${rs}:    All debug flags at once.\n");
+
+	cfprintf(cfile, "\nTest hooks (not included in ${bld}all${rs}):\n\n");
+
+	cfprintf(cfile, "  ${bld}access${rs}: Answer access checks from the permission bits when possible.\n");
+	cfprintf(cfile, "  ${bld}dtype${rs}:  Pretend readdir() doesn't return file types.\n");
 }
 
 /** Check if a substring matches a debug flag. */
@@ -831,19 +855,19 @@ static struct bfs_expr *parse_debug(struct bfs_parser *parser, int arg1, int arg
 			parser->just_info = true;
 			return NULL;
 		} else if (parse_debug_flag(flag, len, "all")) {
-			ctx->debug = DEBUG_ALL;
+			ctx->debug |= DEBUG_ALL;
 			continue;
 		}
 
 		enum debug_flags i;
-		for (i = 1; DEBUG_ALL & i; i <<= 1) {
+		for (i = 1; (DEBUG_ALL | DEBUG_HOOKS) & i; i <<= 1) {
 			const char *name = debug_flag_name(i);
 			if (parse_debug_flag(flag, len, name)) {
 				break;
 			}
 		}
 
-		if (DEBUG_ALL & i) {
+		if ((DEBUG_ALL | DEBUG_HOOKS) & i) {
 			ctx->debug |= i;
 		} else {
 			if (parse_expr_warning(parser, expr, "Unrecognized debug flag ${bld}")) {
@@ -909,14 +933,102 @@ static struct bfs_expr *parse_xargs_safe(struct bfs_parser *parser, int arg1, in
 	return parse_nullary_flag(parser);
 }
 
+#if __linux__
+
+/** Check whether faccessat() might let capabilities override the permission bits. */
+static bool access_uses_caps(uid_t ruid) {
+	// faccessat() drops the capabilities of non-root users, unless
+	// SECURE_NO_SETUID_FIXUP is set
+	int securebits = prctl(PR_GET_SECUREBITS);
+	if (securebits < 0) {
+		return true;
+	}
+
+	bool fixup = !(securebits & SECBIT_NO_SETUID_FIXUP);
+	if (fixup && ruid != 0) {
+		return false;
+	}
+
+	struct __user_cap_header_struct header = {
+		.version = _LINUX_CAPABILITY_VERSION_3,
+		.pid = 0,
+	};
+	struct __user_cap_data_struct data[_LINUX_CAPABILITY_U32S_3];
+	if (syscall(SYS_capget, &header, data) != 0) {
+		return true;
+	}
+
+	// Root gets its permitted capabilities, otherwise they're unchanged
+	uint32_t caps = fixup ? data[0].permitted : data[0].effective;
+	uint32_t dac = (UINT32_C(1) << CAP_DAC_OVERRIDE) | (UINT32_C(1) << CAP_DAC_READ_SEARCH);
+	return caps & dac;
+}
+
+/** Check whether a Linux Security Module might deny access despite the permission bits. */
+static bool access_uses_lsm(void) {
+	// These modules don't restrict file access
+	static const char *const harmless[] = {
+		"capability",
+		"loadpin",
+		"lockdown",
+		"safesetid",
+		"yama",
+	};
+
+	FILE *file = xfopen("/sys/kernel/security/lsm", O_RDONLY | O_CLOEXEC);
+	if (!file) {
+		return true;
+	}
+
+	char buf[256];
+	bool ret = !fgets(buf, sizeof(buf), file);
+	fclose(file);
+
+	for (char *lsm = buf; !ret && *lsm; ) {
+		size_t len = strcspn(lsm, ",\n");
+		ret = true;
+		for (size_t i = 0; i < countof(harmless); ++i) {
+			if (strlen(harmless[i]) == len && strncmp(lsm, harmless[i], len) == 0) {
+				ret = false;
+				break;
+			}
+		}
+
+		lsm += len;
+		lsm += strspn(lsm, ",\n");
+	}
+
+	return ret;
+}
+
+#endif // __linux__
+
 /**
  * Parse -executable, -readable, -writable
  */
 static struct bfs_expr *parse_access(struct bfs_parser *parser, int flag, int arg2) {
 	struct bfs_expr *expr = parse_nullary_test(parser, eval_access);
-	if (expr) {
-		expr->num = flag;
+	if (!expr) {
+		return NULL;
 	}
+
+	expr->num = flag;
+
+#if __linux__
+	// faccessat() uses the real user ID.  Without capabilities, the
+	// permission bits (and ACLs) can prove that access is denied, and
+	// can only prove that it's granted if no LSM could object.
+	struct bfs_ctx *ctx = parser->ctx;
+	ctx->ruid = getuid();
+	if (ctx->debug & DEBUG_ACCESS) {
+		ctx->fast_access = true;
+		ctx->fast_grant = true;
+	} else {
+		ctx->fast_access = !access_uses_caps(ctx->ruid);
+		ctx->fast_grant = ctx->fast_access && !access_uses_lsm();
+	}
+#endif
+
 	return expr;
 }
 
@@ -1122,6 +1234,27 @@ static struct bfs_expr *parse_fnmatch(const struct bfs_parser *parser, struct bf
 	return expr;
 }
 
+/**
+ * Parse -i?contains STRING.
+ */
+static struct bfs_expr *parse_contains(struct bfs_parser *parser, int icase, int arg2) {
+	struct bfs_expr *expr = parse_unary_test(parser, eval_contains);
+	if (!expr) {
+		return NULL;
+	}
+
+	// For open()
+	expr->ephemeral_fds = 1;
+
+	expr->contains = bfs_contains_new(expr->argv[1], icase);
+	if (!expr->contains) {
+		parse_perror(parser, "bfs_contains_new()");
+		return NULL;
+	}
+
+	return expr;
+}
+
 /**
  * Parse -context.
  */
@@ -1188,6 +1321,45 @@ static struct bfs_expr *parse_delete(struct bfs_parser *parser, int arg1, int ar
 	return expr;
 }
 
+/**
+ * Parse -du.
+ */
+static struct bfs_expr *parse_du(struct bfs_parser *parser, int arg1, int arg2) {
+	struct bfs_expr *expr = parse_nullary_action(parser, eval_du);
+	if (!expr) {
+		return NULL;
+	}
+
+	init_print_expr(parser, expr);
+
+	// Directory totals are complete by the post-order visit
+	struct bfs_ctx *ctx = parser->ctx;
+	ctx->flags |= BFTW_POST_ORDER;
+	ctx->du = true;
+
+	parser->depth_expr = expr;
+	return expr;
+}
+
+/**
+ * Parse -duplicates.
+ */
+static struct bfs_expr *parse_duplicates(struct bfs_parser *parser, int arg1, int arg2) {
+	struct bfs_expr *expr = parse_nullary_action(parser, eval_duplicates);
+	if (!expr) {
+		return NULL;
+	}
+
+	init_print_expr(parser, expr);
+	expr->ephemeral_fds = 1;
+
+	if (bfs_dupes_parse(parser->ctx, expr) != 0) {
+		return NULL;
+	}
+
+	return expr;
+}
+
 /**
  * Parse -d.
  */
@@ -1283,7 +1455,7 @@ static const char *unsafe_path(const struct bfs_exec *execbuf) {
 }
 
 /**
- * Parse -exec(dir)?/-ok(dir)?.
+ * Parse -exec(dir)?/-ok(dir)?/-exec-stream/-exec-filter.
  */
 static struct bfs_expr *parse_exec(struct bfs_parser *parser, int flags, int arg2) {
 	struct bfs_ctx *ctx = parser->ctx;
@@ -1318,6 +1490,11 @@ static struct bfs_expr *parse_exec(struct bfs_parser *parser, int flags, int arg
 		return NULL;
 	}
 
+	if (execbuf->flags & BFS_EXEC_STREAM) {
+		// For the socket connected to the command
+		++expr->persistent_fds;
+	}
+
 	if (execbuf->flags & BFS_EXEC_CHDIR) {
 		// To dup() the parent directory
 		if (execbuf->flags & BFS_EXEC_MULTI) {
@@ -1338,6 +1515,80 @@ static struct bfs_expr *parse_exec(struct bfs_parser *parser, int flags, int arg
 	return expr;
 }
 
+/** The most -exec-jobs batches it makes sense to run at once. */
+static int exec_jobs_limit(void) {
+	// A few batches per CPU is plenty
+	long limit = 4 * nproc();
+	if (limit > INT_MAX) {
+		limit = INT_MAX;
+	}
+
+#ifdef RLIMIT_NPROC
+	// We couldn't fork() more processes than this anyway
+	struct rlimit rl;
+	if (getrlimit(RLIMIT_NPROC, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY && rl.rlim_cur < (rlim_t)limit) {
+		limit = rl.rlim_cur > 0 ? rl.rlim_cur : 1;
+	}
+#endif
+
+	return limit;
+}
+
+/**
+ * Parse -exec-jobs N.
+ */
+static struct bfs_expr *parse_exec_jobs(struct bfs_parser *parser, int arg1, int arg2) {
+	struct bfs_expr *expr = parse_unary_option(parser);
+	if (!expr) {
+		return NULL;
+	}
+
+	int n;
+	char **arg = &expr->argv[1];
+	if (!parse_int(parser, arg, *arg, &n, IF_INT | IF_UNSIGNED)) {
+		return NULL;
+	}
+
+	if (n == 0) {
+		parse_expr_error(parser, expr, "${bld}0${rs} is not enough jobs.\n");
+		return NULL;
+	}
+
+	int limit = exec_jobs_limit();
+	if (n > limit) {
+		parse_expr_warning(parser, expr, "Limiting to ${bld}%d${rs} jobs.\n\n", limit);
+		n = limit;
+	}
+
+	parser->ctx->exec_jobs = n;
+	return expr;
+}
+
+/**
+ * Parse -exec-filter-timeout SECONDS.
+ */
+static struct bfs_expr *parse_exec_filter_timeout(struct bfs_parser *parser, int arg1, int arg2) {
+	struct bfs_expr *expr = parse_unary_option(parser);
+	if (!expr) {
+		return NULL;
+	}
+
+	int n;
+	char **arg = &expr->argv[1];
+	if (!parse_int(parser, arg, *arg, &n, IF_INT | IF_UNSIGNED)) {
+		return NULL;
+	}
+
+	// poll() takes milliseconds
+	if (n > INT_MAX / 1000) {
+		parse_expr_error(parser, expr, "Timeout too long.\n");
+		return NULL;
+	}
+
+	parser->ctx->filter_timeout = n;
+	return expr;
+}
+
 /**
  * Parse -exit [STATUS].
  */
@@ -1482,6 +1733,44 @@ static struct bfs_expr *parse_fprint0(struct bfs_parser *parser, int arg1, int a
 	return expr;
 }
 
+/**
+ * Parse -fprintbin FILE.
+ */
+static struct bfs_expr *parse_fprintbin(struct bfs_parser *parser, int arg1, int arg2) {
+	struct bfs_expr *expr = parse_unary_action(parser, eval_fprintbin);
+	if (!expr) {
+		return NULL;
+	}
+
+	if (expr_open(parser, expr, expr->argv[1]) != 0) {
+		return NULL;
+	}
+
+	expr->printbin = bfs_printbin_new(expr->cfile);
+	if (!expr->printbin) {
+		parse_expr_error(parser, expr, "%s.\n", errstr());
+		return NULL;
+	}
+
+	return expr;
+}
+
+/**
+ * Parse -fprintjson FILE.
+ */
+static struct bfs_expr *parse_fprintjson(struct bfs_parser *parser, int arg1, int arg2) {
+	struct bfs_expr *expr = parse_unary_action(parser, eval_fprintjson);
+	if (!expr) {
+		return NULL;
+	}
+
+	if (expr_open(parser, expr, expr->argv[1]) != 0) {
+		return NULL;
+	}
+
+	return expr;
+}
+
 /**
  * Parse -fprintf FILE FORMAT.
  */
@@ -1561,6 +1850,35 @@ static struct bfs_expr *parse_group(struct bfs_parser *parser, int arg1, int arg
 	return expr;
 }
 
+/**
+ * Parse -hash ALGO.
+ */
+static struct bfs_expr *parse_hash(struct bfs_parser *parser, int arg1, int arg2) {
+	struct bfs_expr *expr = parse_unary_action(parser, eval_hash);
+	if (!expr) {
+		return NULL;
+	}
+
+	init_print_expr(parser, expr);
+	expr->ephemeral_fds = 1;
+
+	if (bfs_hash_parse(expr->argv[1], &expr->hash_algo) != 0) {
+		parse_expr_error(parser, expr, "Unknown hash algorithm ${bld}%pq${rs}.\n", expr->argv[1]);
+		bfs_error(parser->ctx, "Use ${bld}sha256${rs} or ${bld}xxh64${rs}.\n");
+		return NULL;
+	}
+
+	// Read ahead on a background thread while hashing, unless we're -j1
+	size_t nthreads = parser->ctx->threads > 1 ? 1 : 0;
+	expr->hasher = bfs_hasher_new(nthreads, 1);
+	if (!expr->hasher) {
+		parse_perror(parser, "bfs_hasher_new()");
+		return NULL;
+	}
+
+	return expr;
+}
+
 /**
  * Parse -unique.
  */
@@ -1619,6 +1937,14 @@ static struct bfs_expr *parse_ignore_races(struct bfs_parser *parser, int ignore
 	return parse_nullary_option(parser);
 }
 
+/**
+ * Parse -ignore-vcs.
+ */
+static struct bfs_expr *parse_ignore_vcs(struct bfs_parser *parser, int arg1, int arg2) {
+	parser->ctx->flags |= BFTW_IGNORE_VCS;
+	return parse_nullary_option(parser);
+}
+
 /**
  * Parse -inum N.
  */
@@ -1882,15 +2208,8 @@ static struct bfs_expr *parse_nohidden(struct bfs_parser *parser, int arg1, int
  * Parse -noleaf.
  */
 static struct bfs_expr *parse_noleaf(struct bfs_parser *parser, int arg1, int arg2) {
-	struct bfs_expr *expr = parse_nullary_option(parser);
-	if (!expr) {
-		return NULL;
-	}
-
-	parse_expr_warning(parser, expr,
-		"${ex}%s${rs} does not apply the optimization that %px inhibits.\n\n",
-		BFS_COMMAND, expr);
-	return expr;
+	parser->ctx->flags &= ~BFTW_NLINK;
+	return parse_nullary_option(parser);
 }
 
 /**
@@ -2193,6 +2512,17 @@ static struct bfs_expr *parse_print0(struct bfs_parser *parser, int arg1, int ar
 	return expr;
 }
 
+/**
+ * Parse -printjson.
+ */
+static struct bfs_expr *parse_printjson(struct bfs_parser *parser, int arg1, int arg2) {
+	struct bfs_expr *expr = parse_nullary_action(parser, eval_fprintjson);
+	if (expr) {
+		init_print_expr(parser, expr);
+	}
+	return expr;
+}
+
 /**
  * Parse -printf FORMAT.
  */
@@ -2222,6 +2552,32 @@ static struct bfs_expr *parse_printx(struct bfs_parser *parser, int arg1, int ar
 	return expr;
 }
 
+/**
+ * Parse -prune-if-contains NAME.
+ */
+static struct bfs_expr *parse_prune_if_contains(struct bfs_parser *parser, int arg1, int arg2) {
+	struct bfs_expr *expr = parse_unary_option(parser);
+	if (!expr) {
+		return NULL;
+	}
+
+	const char *name = expr->argv[1];
+	if (!name[0] || strchr(name, '/') || strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+		parse_expr_error(parser, expr, "Not a valid file name.\n");
+		return NULL;
+	}
+
+	struct bfs_ctx *ctx = parser->ctx;
+	const char **marker = RESERVE(const char *, &ctx->prune_markers, &ctx->nprune_markers);
+	if (!marker) {
+		parse_perror(parser, "RESERVE()");
+		return NULL;
+	}
+
+	*marker = name;
+	return expr;
+}
+
 /**
  * Parse -prune.
  */
@@ -2489,6 +2845,28 @@ static struct bfs_expr *parse_size(struct bfs_parser *parser, int arg1, int arg2
 	return expr;
 }
 
+/**
+ * Parse -sort-by KEY.
+ */
+static struct bfs_expr *parse_sort_by(struct bfs_parser *parser, int arg1, int arg2) {
+	struct bfs_expr *expr = parse_unary_action(parser, eval_sort_by);
+	if (!expr) {
+		return NULL;
+	}
+
+	init_print_expr(parser, expr);
+
+	// Sorted runs are spilled to temporary files, and collapsing a full
+	// set of runs opens one more
+	expr->persistent_fds = BFS_SORT_FANIN + 1;
+
+	if (bfs_sort_parse(parser->ctx, expr, expr->argv[1]) != 0) {
+		return NULL;
+	}
+
+	return expr;
+}
+
 /**
  * Parse -sparse.
  */
@@ -2496,6 +2874,24 @@ static struct bfs_expr *parse_sparse(struct bfs_parser *parser, int arg1, int ar
 	return parse_nullary_test(parser, eval_sparse);
 }
 
+/**
+ * Parse -summarize KEY.
+ */
+static struct bfs_expr *parse_summarize(struct bfs_parser *parser, int arg1, int arg2) {
+	struct bfs_expr *expr = parse_unary_action(parser, eval_summarize);
+	if (!expr) {
+		return NULL;
+	}
+
+	init_print_expr(parser, expr);
+
+	if (bfs_summary_parse(parser->ctx, expr, expr->argv[1]) != 0) {
+		return NULL;
+	}
+
+	return expr;
+}
+
 /**
  * Parse -status.
  */
@@ -2504,6 +2900,46 @@ static struct bfs_expr *parse_status(struct bfs_parser *parser, int arg1, int ar
 	return parse_nullary_option(parser);
 }
 
+/**
+ * Parse -top N KEY.
+ */
+static struct bfs_expr *parse_top(struct bfs_parser *parser, int arg1, int arg2) {
+	const char *arg = parser->argv[0];
+
+	if (!parser->argv[1]) {
+		parse_error(parser, "${blu}%s${rs} needs a count.\n", arg);
+		return NULL;
+	}
+
+	if (!parser->argv[2]) {
+		parse_error(parser, "${blu}%s${rs} needs a key.\n", arg);
+		return NULL;
+	}
+
+	struct bfs_expr *expr = parse_action(parser, eval_top, 3);
+	if (!expr) {
+		return NULL;
+	}
+
+	init_print_expr(parser, expr);
+
+	long long count;
+	if (!parse_int(parser, &expr->argv[1], expr->argv[1], &count, IF_LONG_LONG)) {
+		return NULL;
+	}
+
+	if (count == 0) {
+		parse_expr_error(parser, expr, "The count must not be ${bld}0${rs}.\n");
+		return NULL;
+	}
+
+	if (bfs_top_parse(parser->ctx, expr, count, expr->argv[2]) != 0) {
+		return NULL;
+	}
+
+	return expr;
+}
+
 /**
  * Parse -x?type [bcdpflswD].
  */
@@ -2797,10 +3233,18 @@ static struct bfs_expr *parse_help(struct bfs_parser *parser, int arg1, int arg2
 	cfprintf(cout, "      Measure times relative to the start of today\n");
 	cfprintf(cout, "  ${blu}-depth${rs}\n");
 	cfprintf(cout, "      Search in post-order (descendents first)\n");
+	cfprintf(cout, "  ${blu}-exec-jobs${rs} ${bld}N${rs}\n");
+	cfprintf(cout, "      Run up to ${bld}N${rs} batches of ${blu}-exec${rs}/${blu}-execdir${rs} ${bld}... {} +${rs} at once, while searching\n");
+	cfprintf(cout, "  ${blu}-exec-filter-timeout${rs} ${bld}SECONDS${rs}\n");
+	cfprintf(cout, "      Give up if an ${blu}-exec-filter${rs} command doesn't answer within ${bld}SECONDS${rs} (default: ${bld}%d${rs},\n", BFS_FILTER_TIMEOUT);
+	cfprintf(cout, "      ${bld}0${rs} to wait forever)\n");
 	cfprintf(cout, "  ${blu}-files0-from${rs} ${bld}FILE${rs}\n");
 	cfprintf(cout, "      Search the NUL ('\\0')-separated paths from ${bld}FILE${rs} (${bld}-${rs} for standard input).\n");
 	cfprintf(cout, "  ${blu}-follow${rs}\n");
 	cfprintf(cout, "      Follow all symbolic links (same as ${cyn}-L${rs})\n");
+	cfprintf(cout, "  ${blu}-ignore-vcs${rs}\n");
+	cfprintf(cout, "      Skip files that are ignored by ${bld}.gitignore${rs} or ${bld}.ignore${rs} files, without descending\n");
+	cfprintf(cout, "      into ignored directories\n");
 	cfprintf(cout, "  ${blu}-ignore_readdir_race${rs}\n");
 	cfprintf(cout, "  ${blu}-noignore_readdir_race${rs}\n");
 	cfprintf(cout, "      Whether to report an error if ${ex}%s${rs} detects that the file tree is modified\n",
@@ -2816,7 +3260,9 @@ static struct bfs_expr *parse_help(struct bfs_parser *parser, int arg1, int arg2
 	cfprintf(cout, "  ${blu}-nohidden${rs}\n");
 	cfprintf(cout, "      Exclude hidden files\n");
 	cfprintf(cout, "  ${blu}-noleaf${rs}\n");
-	cfprintf(cout, "      Ignored; for compatibility with GNU find\n");
+	cfprintf(cout, "      Don't use directory link counts to skip some stat() calls\n");
+	cfprintf(cout, "  ${blu}-prune-if-contains${rs} ${bld}NAME${rs}\n");
+	cfprintf(cout, "      Don't descend into directories that contain a file named ${bld}NAME${rs}\n");
 	cfprintf(cout, "  ${blu}-regextype${rs} ${bld}TYPE${rs}\n");
 	cfprintf(cout, "      Use ${bld}TYPE${rs}-flavored regexes (default: ${bld}posix-basic${rs}; see ${blu}-regextype${rs} ${bld}help${rs})\n");
 	cfprintf(cout, "  ${blu}-status${rs}\n");
@@ -2848,6 +3294,10 @@ static struct bfs_expr *parse_help(struct bfs_parser *parser, int arg1, int arg2
 	cfprintf(cout, "  ${blu}-capable${rs}\n");
 	cfprintf(cout, "      Find files with POSIX.1e capabilities set\n");
 #endif
+	cfprintf(cout, "  ${blu}-contains${rs}  ${bld}STRING${rs}\n");
+	cfprintf(cout, "  ${blu}-icontains${rs} ${bld}STRING${rs}\n");
+	cfprintf(cout, "      Find regular files whose contents include ${bld}STRING${rs} (ignoring ASCII case for\n");
+	cfprintf(cout, "      ${blu}-icontains${rs})\n");
 #if BFS_CAN_CHECK_CONTEXT
 	cfprintf(cout, "  ${blu}-context${rs} ${bld}GLOB${rs}\n");
 	cfprintf(cout, "      Find files with SELinux context matching a glob pattern\n");
@@ -2935,10 +3385,23 @@ static struct bfs_expr *parse_help(struct bfs_parser *parser, int arg1, int arg2
 	cfprintf(cout, "  ${blu}-delete${rs}\n");
 	cfprintf(cout, "  ${blu}-rm${rs}\n");
 	cfprintf(cout, "      Delete any found files (implies ${blu}-depth${rs})\n");
+	cfprintf(cout, "  ${blu}-du${rs}\n");
+	cfprintf(cout, "      Print the disk usage of the file and everything under it, in KiB, like ${ex}du${rs}\n");
+	cfprintf(cout, "      (implies ${blu}-depth${rs})\n");
+	cfprintf(cout, "  ${blu}-duplicates${rs}\n");
+	cfprintf(cout, "      Print groups of regular files with identical contents at the end, separated by\n");
+	cfprintf(cout, "      blank lines\n");
 	cfprintf(cout, "  ${blu}-exec${rs} ${bld}command ... {} ;${rs}\n");
 	cfprintf(cout, "      Execute a command\n");
 	cfprintf(cout, "  ${blu}-exec${rs} ${bld}command ... {} +${rs}\n");
 	cfprintf(cout, "      Execute a command with multiple files at once\n");
+	cfprintf(cout, "  ${blu}-exec-stream${rs} ${bld}command ... ;${rs}\n");
+	cfprintf(cout, "      Start a single command, and write each file's path to its standard input,\n");
+	cfprintf(cout, "      terminated by a null character\n");
+	cfprintf(cout, "  ${blu}-exec-filter${rs} ${bld}command ... ;${rs}\n");
+	cfprintf(cout, "      Like ${blu}-exec-stream${rs}, but wait for the command to print a line for each file.  The\n");
+	cfprintf(cout, "      file matches if the line is ${bld}0${rs}, like a successful exit status.  The command must\n");
+	cfprintf(cout, "      flush its output after each line, e.g. with ${ex}fflush()${rs} in ${ex}awk${rs}\n");
 	cfprintf(cout, "  ${blu}-ok${rs} ${bld}command ... {} ;${rs}\n");
 	cfprintf(cout, "      Prompt the user whether to execute a command\n");
 	cfprintf(cout, "  ${blu}-execdir${rs} ${bld}command ... {} ;${rs}\n");
@@ -2952,8 +3415,14 @@ static struct bfs_expr *parse_help(struct bfs_parser *parser, int arg1, int arg2
 	cfprintf(cout, "  ${blu}-fprint${rs} ${bld}FILE${rs}\n");
 	cfprintf(cout, "  ${blu}-fprint0${rs} ${bld}FILE${rs}\n");
 	cfprintf(cout, "  ${blu}-fprintf${rs} ${bld}FILE${rs} ${bld}FORMAT${rs}\n");
-	cfprintf(cout, "      Like ${blu}-ls${rs}/${blu}-print${rs}/${blu}-print0${rs}/${blu}-printf${rs}, but write to ${bld}FILE${rs} instead of standard\n"
-	               "      output\n");
+	cfprintf(cout, "  ${blu}-fprintjson${rs} ${bld}FILE${rs}\n");
+	cfprintf(cout, "      Like ${blu}-ls${rs}/${blu}-print${rs}/${blu}-print0${rs}/${blu}-printf${rs}/${blu}-printjson${rs}, but write to ${bld}FILE${rs}\n"
+	               "      instead of standard output\n");
+	cfprintf(cout, "  ${blu}-fprintbin${rs} ${bld}FILE${rs}\n");
+	cfprintf(cout, "      Write compact binary records with the same data as ${blu}-printjson${rs} to ${bld}FILE${rs}\n");
+	cfprintf(cout, "  ${blu}-hash${rs} ${bld}ALGO${rs}\n");
+	cfprintf(cout, "      Print the hash of each regular file's contents, like ${ex}sha256sum${rs}.  ${bld}ALGO${rs} is one of\n");
+	cfprintf(cout, "      ${bld}sha256${rs} or ${bld}xxh64${rs}\n");
 	cfprintf(cout, "  ${blu}-limit${rs} ${bld}N${rs}\n");
 	cfprintf(cout, "      Quit after this action is evaluated ${bld}N${rs} times\n");
 	cfprintf(cout, "  ${blu}-ls${rs}\n");
@@ -2966,6 +3435,8 @@ static struct bfs_expr *parse_help(struct bfs_parser *parser, int arg1, int arg2
 	cfprintf(cout, "  ${blu}-printf${rs} ${bld}FORMAT${rs}\n");
 	cfprintf(cout, "      Print according to a format string (see ${ex}man${rs} ${bld}find${rs}).  The additional format\n");
 	cfprintf(cout, "      directives %%w and %%W${bld}k${rs} for printing file birth times are supported.\n");
+	cfprintf(cout, "  ${blu}-printjson${rs}\n");
+	cfprintf(cout, "      Print the path and metadata of the found file as a line of JSON\n");
 	cfprintf(cout, "  ${blu}-printx${rs}\n");
 	cfprintf(cout, "      Like ${blu}-print${rs}, but escape whitespace and quotation characters, to make the\n");
 	cfprintf(cout, "      output safe for ${ex}xargs${rs}.  Consider using ${blu}-print0${rs} and ${ex}xargs${rs} ${bld}-0${rs} instead.\n");
@@ -2973,6 +3444,15 @@ static struct bfs_expr *parse_help(struct bfs_parser *parser, int arg1, int arg2
 	cfprintf(cout, "      Don't descend into this directory\n");
 	cfprintf(cout, "  ${blu}-quit${rs}\n");
 	cfprintf(cout, "      Quit immediately\n");
+	cfprintf(cout, "  ${blu}-sort-by${rs} ${bld}KEY${rs}\n");
+	cfprintf(cout, "      Print the path to the found file at the end, with all the output sorted by ${bld}KEY${rs}\n");
+	cfprintf(cout, "      (${bld}path${rs}, ${bld}size${rs}, ${bld}blocks${rs}, ${bld}mtime${rs}, ${bld}atime${rs}, ${bld}ctime${rs}, or ${bld}depth${rs})\n");
+	cfprintf(cout, "  ${blu}-summarize${rs} ${bld}KEY${rs}\n");
+	cfprintf(cout, "      Print per-group totals at the end, grouped by ${bld}ext${rs}, ${bld}user${rs}, ${bld}group${rs}, ${bld}size${rs},\n");
+	cfprintf(cout, "      ${bld}age${rs}, or ${bld}prefix[:N]${rs}\n");
+	cfprintf(cout, "  ${blu}-top${rs} ${bld}N${rs} ${bld}KEY${rs}\n");
+	cfprintf(cout, "      Print the ${bld}N${rs} files with the largest ${bld}KEY${rs} at the end (smallest if ${bld}N${rs} is negative),\n");
+	cfprintf(cout, "      where ${bld}KEY${rs} is ${bld}size${rs}, ${bld}blocks${rs}, ${bld}mtime${rs}, ${bld}atime${rs}, ${bld}ctime${rs}, or ${bld}depth${rs}\n");
 	cfprintf(cout, "  ${blu}-version${rs}\n");
 	cfprintf(cout, "      Print version information\n");
 	cfprintf(cout, "  ${blu}-help${rs}\n");
@@ -3090,6 +3570,7 @@ static const struct table_entry parse_table[] = {
 	{"-cmin", BFS_TEST, parse_min, BFS_STAT_CTIME},
 	{"-cnewer", BFS_TEST, parse_newer, BFS_STAT_CTIME},
 	{"-color", BFS_OPTION, parse_color, true},
+	{"-contains", BFS_TEST, parse_contains, false},
 	{"-context", BFS_TEST, parse_context, true},
 	{"-csince", BFS_TEST, parse_since, BFS_STAT_CTIME},
 	{"-ctime", BFS_TEST, parse_time, BFS_STAT_CTIME},
@@ -3097,9 +3578,15 @@ static const struct table_entry parse_table[] = {
 	{"-daystart", BFS_OPTION, parse_daystart},
 	{"-delete", BFS_ACTION, parse_delete},
 	{"-depth", BFS_OPTION, parse_depth_n, false},
+	{"-du", BFS_ACTION, parse_du},
+	{"-duplicates", BFS_ACTION, parse_duplicates},
 	{"-empty", BFS_TEST, parse_empty},
 	{"-exclude", BFS_OPERATOR},
 	{"-exec", BFS_ACTION, parse_exec, 0},
+	{"-exec-filter", BFS_ACTION, parse_exec, BFS_EXEC_STREAM | BFS_EXEC_FILTER},
+	{"-exec-filter-timeout", BFS_OPTION, parse_exec_filter_timeout},
+	{"-exec-jobs", BFS_OPTION, parse_exec_jobs},
+	{"-exec-stream", BFS_ACTION, parse_exec, BFS_EXEC_STREAM},
 	{"-execdir", BFS_ACTION, parse_exec, BFS_EXEC_CHDIR},
 	{"-executable", BFS_TEST, parse_access, X_OK},
 	{"-exit", BFS_ACTION, parse_exit},
@@ -3111,12 +3598,17 @@ static const struct table_entry parse_table[] = {
 	{"-follow", BFS_OPTION, parse_follow, BFTW_FOLLOW_ALL, true},
 	{"-fprint", BFS_ACTION, parse_fprint},
 	{"-fprint0", BFS_ACTION, parse_fprint0},
+	{"-fprintbin", BFS_ACTION, parse_fprintbin},
 	{"-fprintf", BFS_ACTION, parse_fprintf},
+	{"-fprintjson", BFS_ACTION, parse_fprintjson},
 	{"-fstype", BFS_TEST, parse_fstype},
 	{"-gid", BFS_TEST, parse_group},
 	{"-group", BFS_TEST, parse_group},
+	{"-hash", BFS_ACTION, parse_hash},
 	{"-help", BFS_ACTION, parse_help},
 	{"-hidden", BFS_TEST, parse_hidden},
+	{"-icontains", BFS_TEST, parse_contains, true},
+	{"-ignore-vcs", BFS_OPTION, parse_ignore_vcs},
 	{"-ignore_readdir_race", BFS_OPTION, parse_ignore_races, true},
 	{"-ilname", BFS_TEST, parse_lname, true},
 	{"-iname", BFS_TEST, parse_name, true},
@@ -3157,8 +3649,10 @@ static const struct table_entry parse_table[] = {
 	{"-print", BFS_ACTION, parse_print},
 	{"-print0", BFS_ACTION, parse_print0},
 	{"-printf", BFS_ACTION, parse_printf},
+	{"-printjson", BFS_ACTION, parse_printjson},
 	{"-printx", BFS_ACTION, parse_printx},
 	{"-prune", BFS_ACTION, parse_prune},
+	{"-prune-if-contains", BFS_OPTION, parse_prune_if_contains},
 	{"-quit", BFS_ACTION, parse_quit},
 	{"-readable", BFS_TEST, parse_access, R_OK},
 	{"-regex", BFS_TEST, parse_regex, 0},
@@ -3168,8 +3662,11 @@ static const struct table_entry parse_table[] = {
 	{"-samefile", BFS_TEST, parse_samefile},
 	{"-since", BFS_TEST, parse_since, BFS_STAT_MTIME},
 	{"-size", BFS_TEST, parse_size},
+	{"-sort-by", BFS_ACTION, parse_sort_by},
 	{"-sparse", BFS_TEST, parse_sparse},
 	{"-status", BFS_OPTION, parse_status},
+	{"-summarize", BFS_ACTION, parse_summarize},
+	{"-top", BFS_ACTION, parse_top},
 	{"-true", BFS_TEST, parse_const, true},
 	{"-type", BFS_TEST, parse_type, false},
 	{"-uid", BFS_TEST, parse_user},
@@ -3615,6 +4112,35 @@ fail:
 	return -1;
 }
 
+/**
+ * Check for printing actions that can't share an output file.
+ */
+static int check_outputs(const struct bfs_parser *parser) {
+	for_slist (struct bfs_expr, expr, &parser->outputs, outputs) {
+		for (const struct bfs_expr *other = expr->outputs.next; other; other = other->outputs.next) {
+			if (other->cfile != expr->cfile) {
+				continue;
+			}
+
+			// -fprintbin records are delta-encoded, so nothing else can write to the same file
+			const struct bfs_expr *printbin = NULL;
+			if (expr->eval_fn == eval_fprintbin) {
+				printbin = expr;
+			} else if (other->eval_fn == eval_fprintbin) {
+				printbin = other;
+			} else {
+				continue;
+			}
+
+			const struct bfs_expr *rest = printbin == expr ? other : expr;
+			parse_expr_error(parser, printbin, "Output file is also used by ${blu}%s${rs}.\n", rest->argv[0]);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
 /**
  * Parse the top-level expression.
  */
@@ -3671,6 +4197,10 @@ static struct bfs_expr *parse_whole_expr(struct bfs_parser *parser) {
 		}
 	}
 
+	if (check_outputs(parser) != 0) {
+		return NULL;
+	}
+
 	if (parser->mount_expr && parser->xdev_expr) {
 		parse_conflict_warning(parser, parser->mount_expr, parser->xdev_expr,
 			"%px is redundant in the presence of %px.\n\n",
@@ -3786,7 +4316,7 @@ void bfs_ctx_dump(const struct bfs_ctx *ctx, enum debug_flags flag) {
 		cfprintf(cerr, " ${cyn}-D${rs} ${bld}all${rs}");
 	} else if (debug) {
 		cfprintf(cerr, " ${cyn}-D${rs} ");
-		for (enum debug_flags i = 1; DEBUG_ALL & i; i <<= 1) {
+		for (enum debug_flags i = 1; (DEBUG_ALL | DEBUG_HOOKS) & i; i <<= 1) {
 			if (debug & i) {
 				cfprintf(cerr, "${bld}%s${rs}", debug_flag_name(i));
 				debug ^= i;
@@ -3814,6 +4344,15 @@ void bfs_ctx_dump(const struct bfs_ctx *ctx, enum debug_flags flag) {
 	if (ctx->flags & BFTW_POST_ORDER) {
 		cfprintf(cerr, " ${blu}-depth${rs}");
 	}
+	if (ctx->exec_jobs != 1) {
+		cfprintf(cerr, " ${blu}-exec-jobs${rs} ${bld}%d${rs}", ctx->exec_jobs);
+	}
+	if (ctx->filter_timeout != BFS_FILTER_TIMEOUT) {
+		cfprintf(cerr, " ${blu}-exec-filter-timeout${rs} ${bld}%d${rs}", ctx->filter_timeout);
+	}
+	if (ctx->flags & BFTW_IGNORE_VCS) {
+		cfprintf(cerr, " ${blu}-ignore-vcs${rs}");
+	}
 	if (ctx->ignore_races) {
 		cfprintf(cerr, " ${blu}-ignore_readdir_race${rs}");
 	}
@@ -3826,6 +4365,9 @@ void bfs_ctx_dump(const struct bfs_ctx *ctx, enum debug_flags flag) {
 	if (ctx->flags & BFTW_SKIP_MOUNTS) {
 		cfprintf(cerr, " ${blu}-mount${rs}");
 	}
+	for (size_t i = 0; i < ctx->nprune_markers; ++i) {
+		cfprintf(cerr, " ${blu}-prune-if-contains${rs} ${bld}%pq${rs}", ctx->prune_markers[i]);
+	}
 	if (ctx->status) {
 		cfprintf(cerr, " ${blu}-status${rs}");
 	}
@@ -3937,6 +4479,7 @@ struct bfs_ctx *bfs_parse_cmdline(int argc, char *argv[]) {
 		.stdin_expr = NULL,
 		.now = ctx->now,
 	};
+	SLIST_INIT(&parser.outputs);
 
 	ctx->exclude = parse_new_expr(&parser, eval_or, 1, &fake_or_arg, BFS_OPERATOR);
 	if (!ctx->exclude) {
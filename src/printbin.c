@@ -0,0 +1,283 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+#include "printbin.h"
+
+#include "alloc.h"
+#include "bftw.h"
+#include "bit.h"
+#include "color.h"
+#include "diag.h"
+#include "dir.h"
+#include "dstring.h"
+#include "stat.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/** The current format version. */
+#define BIN_VERSION 1
+
+/** The maximum length of a varint. */
+#define BIN_VARINT_MAX ((UINTMAX_WIDTH + 6) / 7)
+
+/**
+ * Field types.
+ */
+enum bin_type {
+	/** Unsigned integer. */
+	BIN_UINT = 'u',
+	/** Timestamp. */
+	BIN_TIME = 't',
+	/** String. */
+	BIN_STR = 's',
+};
+
+/**
+ * A field in each record.
+ */
+struct bin_field {
+	/** The field type. */
+	enum bin_type type;
+	/** The field name. */
+	const char *name;
+	/** The stat field it comes from, if any. */
+	enum bfs_stat_field stat_field;
+};
+
+/** The fields we write, in order. */
+static const struct bin_field bin_fields[] = {
+	{BIN_UINT, "dev", BFS_STAT_DEV},
+	{BIN_UINT, "ino", BFS_STAT_INO},
+	{BIN_UINT, "mode", BFS_STAT_MODE},
+	{BIN_UINT, "nlink", BFS_STAT_NLINK},
+	{BIN_UINT, "uid", BFS_STAT_UID},
+	{BIN_UINT, "gid", BFS_STAT_GID},
+	{BIN_UINT, "size", BFS_STAT_SIZE},
+	{BIN_UINT, "blocks", BFS_STAT_BLOCKS},
+	{BIN_TIME, "atime", BFS_STAT_ATIME},
+	{BIN_TIME, "btime", BFS_STAT_BTIME},
+	{BIN_TIME, "ctime", BFS_STAT_CTIME},
+	{BIN_TIME, "mtime", BFS_STAT_MTIME},
+	{BIN_STR, "target", 0},
+};
+
+struct bfs_printbin {
+	/** The stream to write to. */
+	CFILE *cfile;
+	/** The previous path, for delta encoding. */
+	dchar *prev;
+	/** A buffer for the current record. */
+	dchar *buf;
+};
+
+/** Encode a varint, returning the end of the encoding. */
+static char *bin_uint(char *buf, uintmax_t n) {
+	while (n >= 0x80) {
+		*buf++ = (n & 0x7F) | 0x80;
+		n >>= 7;
+	}
+	*buf++ = n;
+	return buf;
+}
+
+/** Encode a string with its length. */
+static char *bin_str(char *buf, const char *str, size_t len) {
+	buf = bin_uint(buf, len);
+	memcpy(buf, str, len);
+	return buf + len;
+}
+
+/** Encode a timestamp. */
+static char *bin_time(char *buf, const struct timespec *ts) {
+	// Zigzag encoding keeps small negative numbers short
+	intmax_t sec = ts->tv_sec;
+	uintmax_t zigzag = (uintmax_t)sec << 1;
+	if (sec < 0) {
+		zigzag = ~zigzag;
+	}
+
+	buf = bin_uint(buf, zigzag);
+	return bin_uint(buf, ts->tv_nsec);
+}
+
+/** Get the value of an integer field. */
+static uintmax_t bin_stat_uint(const struct bfs_stat *statbuf, enum bfs_stat_field field) {
+	switch (field) {
+	case BFS_STAT_DEV:
+		return statbuf->dev;
+	case BFS_STAT_INO:
+		return statbuf->ino;
+	case BFS_STAT_MODE:
+		return statbuf->mode & 07777;
+	case BFS_STAT_NLINK:
+		return statbuf->nlink;
+	case BFS_STAT_UID:
+		return statbuf->uid;
+	case BFS_STAT_GID:
+		return statbuf->gid;
+	case BFS_STAT_SIZE:
+		return statbuf->size;
+	case BFS_STAT_BLOCKS:
+		return ((uintmax_t)statbuf->blocks * BFS_STAT_BLKSIZE + 511) / 512;
+	default:
+		bfs_bug("Unexpected stat field %d", (int)field);
+		return 0;
+	}
+}
+
+/** Get the type character for a file. */
+static char bin_type_char(enum bfs_type type) {
+	const char chars[] = {
+		[BFS_BLK] = 'b',
+		[BFS_CHR] = 'c',
+		[BFS_DIR] = 'd',
+		[BFS_DOOR] = 'D',
+		[BFS_FIFO] = 'p',
+		[BFS_LNK] = 'l',
+		[BFS_PORT] = 'P',
+		[BFS_REG] = 'f',
+		[BFS_SOCK] = 's',
+		[BFS_WHT] = 'w',
+	};
+
+	char c = 0;
+	if ((size_t)type < countof(chars)) {
+		c = chars[type];
+	}
+
+	return c ? c : 'U';
+}
+
+/** Write the contents of the buffer. */
+static int bin_flush(struct bfs_printbin *bin) {
+	size_t len = dstrlen(bin->buf);
+	if (fwrite(bin->buf, 1, len, bin->cfile->file) != len) {
+		return -1;
+	}
+	return 0;
+}
+
+struct bfs_printbin *bfs_printbin_new(CFILE *cfile) {
+	struct bfs_printbin *bin = ZALLOC(struct bfs_printbin);
+	if (!bin) {
+		return NULL;
+	}
+
+	bin->cfile = cfile;
+
+	bin->prev = dstralloc(0);
+	if (!bin->prev) {
+		goto fail;
+	}
+
+	bin->buf = dstrprintf("bfsbin%c%c", BIN_VERSION, (int)countof(bin_fields));
+	if (!bin->buf) {
+		goto fail;
+	}
+
+	for (size_t i = 0; i < countof(bin_fields); ++i) {
+		const struct bin_field *field = &bin_fields[i];
+		if (dstrapp(&bin->buf, field->type) != 0) {
+			goto fail;
+		}
+		// Include the NUL terminator
+		if (dstrxcat(&bin->buf, field->name, strlen(field->name) + 1) != 0) {
+			goto fail;
+		}
+	}
+
+	if (bin_flush(bin) != 0) {
+		goto fail;
+	}
+
+	return bin;
+
+fail:
+	bfs_printbin_free(bin);
+	return NULL;
+}
+
+int bfs_printbin(struct bfs_printbin *bin, const struct BFTW *ftwbuf, const struct bfs_stat *statbuf, const char *target) {
+	const char *path = ftwbuf->path;
+	size_t len = strlen(path);
+	size_t target_len = target ? strlen(target) : 0;
+
+	// Find the prefix shared with the previous path
+	size_t shared = 0;
+	size_t prev_len = dstrlen(bin->prev);
+	size_t max = len < prev_len ? len : prev_len;
+	while (shared < max && path[shared] == bin->prev[shared]) {
+		++shared;
+	}
+
+	// Reserve space for the length prefix, the fixed fields, and the strings
+	size_t nvarints = 5 + 2 * countof(bin_fields);
+	size_t cap = 1 + nvarints * BIN_VARINT_MAX + len + target_len;
+	if (dstresize(&bin->buf, cap) != 0) {
+		return -1;
+	}
+
+	// Leave room to prepend the length afterwards
+	char *start = bin->buf + BIN_VARINT_MAX;
+	char *end = start;
+	*end++ = bin_type_char(bfs_mode_to_type(statbuf->mode));
+	end = bin_uint(end, ftwbuf->depth);
+	end = bin_uint(end, shared);
+	end = bin_str(end, path + shared, len - shared);
+
+	uintmax_t present = 0;
+	for (size_t i = 0; i < countof(bin_fields); ++i) {
+		enum bfs_stat_field field = bin_fields[i].stat_field;
+		if (field ? (statbuf->mask & field) : target != NULL) {
+			present |= UINTMAX_C(1) << i;
+		}
+	}
+	end = bin_uint(end, present);
+
+	for (size_t i = 0; i < countof(bin_fields); ++i) {
+		if (!(present & (UINTMAX_C(1) << i))) {
+			continue;
+		}
+
+		const struct bin_field *field = &bin_fields[i];
+		switch (field->type) {
+		case BIN_UINT:
+			end = bin_uint(end, bin_stat_uint(statbuf, field->stat_field));
+			break;
+		case BIN_TIME:
+			end = bin_time(end, bfs_stat_time(statbuf, field->stat_field));
+			break;
+		case BIN_STR:
+			end = bin_str(end, target, target_len);
+			break;
+		}
+	}
+
+	char prefix[BIN_VARINT_MAX];
+	size_t prefix_len = bin_uint(prefix, end - start) - prefix;
+	start -= prefix_len;
+	memcpy(start, prefix, prefix_len);
+
+	size_t record_len = end - start;
+	if (fwrite(start, 1, record_len, bin->cfile->file) != record_len) {
+		return -1;
+	}
+
+	// Only the new suffix needs to be copied
+	dstrshrink(bin->prev, shared);
+	return dstrxcat(&bin->prev, path + shared, len - shared);
+}
+
+void bfs_printbin_free(struct bfs_printbin *bin) {
+	if (!bin) {
+		return;
+	}
+
+	dstrfree(bin->buf);
+	dstrfree(bin->prev);
+	free(bin);
+}
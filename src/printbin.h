@@ -0,0 +1,78 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+/**
+ * Implementation of -fprintbin.
+ *
+ * The output starts with a header describing the schema:
+ *
+ *     "bfsbin"       magic number
+ *     u8             format version (1)
+ *     u8             number of fields
+ *     (u8, string)   for each field, its type and NUL-terminated name
+ *
+ * The field types are
+ *
+ *     'u'            unsigned integer: varint
+ *     't'            timestamp: zigzag varint seconds, varint nanoseconds
+ *     's'            string: varint length, bytes
+ *
+ * Each file then gets a record:
+ *
+ *     varint         length of the rest of the record
+ *     u8             file type, as printed by -printf %y
+ *     varint         depth
+ *     varint         length of the prefix shared with the previous path
+ *     string         the rest of the path
+ *     varint         bitmask of the fields present in this record
+ *     ...            the present fields, in header order
+ *
+ * Varints are unsigned LEB128: 7 bits at a time, least significant first,
+ * with the high bit set on all but the last byte.
+ */
+
+#ifndef BFS_PRINTBIN_H
+#define BFS_PRINTBIN_H
+
+#include "color.h"
+
+struct BFTW;
+struct bfs_stat;
+
+/**
+ * The state of a binary output stream.
+ */
+struct bfs_printbin;
+
+/**
+ * Start a binary output stream.
+ *
+ * @cfile
+ *         The stream to write to.
+ * @return
+ *         The new binary output state, or NULL on failure.
+ */
+struct bfs_printbin *bfs_printbin_new(CFILE *cfile);
+
+/**
+ * Write a record for a file.
+ *
+ * @bin
+ *         The binary output state.
+ * @ftwbuf
+ *         The bftw() data for the current file.
+ * @statbuf
+ *         The stat() buffer for the current file.
+ * @target
+ *         The target of a symbolic link, or NULL.
+ * @return
+ *         0 on success, -1 on failure.
+ */
+int bfs_printbin(struct bfs_printbin *bin, const struct BFTW *ftwbuf, const struct bfs_stat *statbuf, const char *target);
+
+/**
+ * Free the binary output state.
+ */
+void bfs_printbin_free(struct bfs_printbin *bin);
+
+#endif // BFS_PRINTBIN_H
@@ -14,12 +14,15 @@
 #include "dstring.h"
 #include "expr.h"
 #include "fsade.h"
+#include "hash.h"
 #include "mtab.h"
 #include "pwcache.h"
 #include "stat.h"
+#include "xtime.h"
 
 #include <errno.h>
 #include <grp.h>
+#include <limits.h>
 #include <pwd.h>
 #include <stdarg.h>
 #include <stdint.h>
@@ -35,6 +38,18 @@ struct bfs_fmt;
  */
 typedef int bfs_printf_fn(CFILE *cfile, const struct bfs_fmt *fmt, const struct BFTW *ftwbuf);
 
+/**
+ * A cached time directive, reused for times in the same minute.
+ */
+struct bfs_time_cache {
+	/** Whether the cache is filled. */
+	bool valid;
+	/** The first second of the cached minute. */
+	time_t start;
+	/** The formatted time. */
+	char str[256];
+};
+
 /**
  * A single formatting directive like %f or %#4m.
  */
@@ -49,6 +64,14 @@ struct bfs_fmt {
 	char c;
 	/** Some data used by the directive. */
 	void *ptr;
+	/** Cached output for time directives. */
+	struct bfs_time_cache *cache;
+	/** Whether the flags are simple enough to format without printf(). */
+	bool simple;
+	/** Whether to left-justify the field (the - flag). */
+	bool left;
+	/** The minimum field width. */
+	size_t width;
 };
 
 /**
@@ -73,7 +96,7 @@ static int bfs_printf_literal(CFILE *cfile, const struct bfs_fmt *fmt, const str
 
 /** \c: flush */
 static int bfs_printf_flush(CFILE *cfile, const struct bfs_fmt *fmt, const struct BFTW *ftwbuf) {
-	return fflush(cfile->file);
+	return cfflush(cfile);
 }
 
 /** Check if we can safely colorize this directive. */
@@ -108,6 +131,63 @@ static int bfs_fprintf(CFILE *cfile, const struct bfs_fmt *fmt, const char *fake
 	return ret;
 }
 
+/** Print some padding. */
+static int bfs_printf_pad(FILE *file, size_t pad) {
+	for (size_t i = 0; i < pad; ++i) {
+		if (putc(' ', file) == EOF) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/** Print a string, padded to the field width. */
+static int bfs_printf_str(CFILE *cfile, const struct bfs_fmt *fmt, const char *str) {
+	if (!fmt->simple) {
+		return bfs_fprintf(cfile, fmt, "%s", str);
+	}
+
+	FILE *file = cfile->file;
+	size_t len = strlen(str);
+	size_t pad = fmt->width > len ? fmt->width - len : 0;
+
+	if (!fmt->left && bfs_printf_pad(file, pad) != 0) {
+		return -1;
+	}
+	if (fwrite(str, 1, len, file) != len) {
+		return -1;
+	}
+	if (fmt->left && bfs_printf_pad(file, pad) != 0) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/** The widest field we'll pad without printf(). */
+#define BFS_PRINTF_MAX_WIDTH 4096
+
+/** A buffer size big enough for any integer, in any base >= 8. */
+#define BFS_PRINTF_INTBUF (sizeof(uintmax_t) * CHAR_BIT / 3 + 3)
+
+/** Write the digits of an integer backwards, ending at the given position. */
+static char *bfs_printf_utoa(char *end, uintmax_t n, unsigned int base) {
+	do {
+		*--end = '0' + n % base;
+		n /= base;
+	} while (n > 0);
+
+	return end;
+}
+
+/** Print an unsigned integer as a string. */
+static int bfs_printf_uint(CFILE *cfile, const struct bfs_fmt *fmt, uintmax_t n, unsigned int base) {
+	char buf[BFS_PRINTF_INTBUF];
+	char *end = buf + sizeof(buf);
+	*--end = '\0';
+	return bfs_printf_str(cfile, fmt, bfs_printf_utoa(end, n, base));
+}
+
 /** %a, %c, %t: ctime() */
 static int bfs_printf_ctime(CFILE *cfile, const struct bfs_fmt *fmt, const struct BFTW *ftwbuf) {
 	// Not using ctime() itself because GNU find adds nanoseconds
@@ -125,7 +205,7 @@ static int bfs_printf_ctime(CFILE *cfile, const struct bfs_fmt *fmt, const struc
 	}
 
 	struct tm tm;
-	if (!localtime_r(&ts->tv_sec, &tm)) {
+	if (!xlocaltime(&ts->tv_sec, &tm)) {
 		return -1;
 	}
 
@@ -139,7 +219,34 @@ static int bfs_printf_ctime(CFILE *cfile, const struct bfs_fmt *fmt, const struc
 		(long)ts->tv_nsec,
 		1900 + tm.tm_year);
 
-	return bfs_fprintf(cfile, fmt, "%s", buf);
+	return bfs_printf_str(cfile, fmt, buf);
+}
+
+/** %A@, %As, etc.: seconds since the epoch */
+static int bfs_printf_epoch(CFILE *cfile, const struct bfs_fmt *fmt, const struct timespec *ts) {
+	char buf[BFS_PRINTF_INTBUF + 12];
+	char *end = buf + sizeof(buf);
+	*--end = '\0';
+
+	if (fmt->c == '@') {
+		// Like "%lld.%09ld0"
+		*--end = '0';
+		long nsec = ts->tv_nsec;
+		for (int i = 0; i < 9; ++i) {
+			*--end = '0' + nsec % 10;
+			nsec /= 10;
+		}
+		*--end = '.';
+	}
+
+	long long sec = ts->tv_sec;
+	uintmax_t abs = sec < 0 ? -(uintmax_t)sec : (uintmax_t)sec;
+	char *str = bfs_printf_utoa(end, abs, 10);
+	if (sec < 0) {
+		*--str = '-';
+	}
+
+	return bfs_printf_str(cfile, fmt, str);
 }
 
 /** %A, %B/%W, %C, %T: strftime() */
@@ -154,19 +261,28 @@ static int bfs_printf_strftime(CFILE *cfile, const struct bfs_fmt *fmt, const st
 		return -1;
 	}
 
+	// These don't need the broken-down time
+	if (fmt->c == '@' || fmt->c == 's') {
+		return bfs_printf_epoch(cfile, fmt, ts);
+	}
+
 	struct tm tm;
-	if (!localtime_r(&ts->tv_sec, &tm)) {
+	if (!xlocaltime(&ts->tv_sec, &tm)) {
 		return -1;
 	}
 
+	// Most directives only depend on the minute, so reuse the last result
+	struct bfs_time_cache *cache = fmt->cache;
+	time_t start = ts->tv_sec - tm.tm_sec;
+	if (cache && cache->valid && cache->start == start) {
+		return bfs_printf_str(cfile, fmt, cache->str);
+	}
+
 	int ret;
 	char buf[256];
 	char format[] = "% ";
 	switch (fmt->c) {
 	// Non-POSIX strftime() features
-	case '@':
-		ret = snprintf(buf, sizeof(buf), "%lld.%09ld0", (long long)ts->tv_sec, (long)ts->tv_nsec);
-		break;
 	case '+':
 		ret = snprintf(buf, sizeof(buf), "%4d-%.2d-%.2d+%.2d:%.2d:%.2d.%09ld0",
 			1900 + tm.tm_year,
@@ -183,9 +299,6 @@ static int bfs_printf_strftime(CFILE *cfile, const struct bfs_fmt *fmt, const st
 	case 'l':
 		ret = snprintf(buf, sizeof(buf), "%2d", (tm.tm_hour + 11) % 12 + 1);
 		break;
-	case 's':
-		ret = snprintf(buf, sizeof(buf), "%lld", (long long)ts->tv_sec);
-		break;
 	case 'S':
 		ret = snprintf(buf, sizeof(buf), "%.2d.%09ld0", tm.tm_sec, (long)ts->tv_nsec);
 		break;
@@ -212,9 +325,14 @@ static int bfs_printf_strftime(CFILE *cfile, const struct bfs_fmt *fmt, const st
 	}
 
 	bfs_assert(ret >= 0 && (size_t)ret < sizeof(buf));
-	(void)ret;
 
-	return bfs_fprintf(cfile, fmt, "%s", buf);
+	if (cache) {
+		cache->valid = true;
+		cache->start = start;
+		memcpy(cache->str, buf, ret + 1);
+	}
+
+	return bfs_printf_str(cfile, fmt, buf);
 }
 
 /** %b: blocks */
@@ -225,12 +343,15 @@ static int bfs_printf_b(CFILE *cfile, const struct bfs_fmt *fmt, const struct BF
 	}
 
 	uintmax_t blocks = ((uintmax_t)statbuf->blocks * BFS_STAT_BLKSIZE + 511) / 512;
-	BFS_PRINTF_BUF(buf, "%ju", blocks);
-	return bfs_fprintf(cfile, fmt, "%s", buf);
+	return bfs_printf_uint(cfile, fmt, blocks, 10);
 }
 
 /** %d: depth */
 static int bfs_printf_d(CFILE *cfile, const struct bfs_fmt *fmt, const struct BFTW *ftwbuf) {
+	if (fmt->simple) {
+		return bfs_printf_uint(cfile, fmt, ftwbuf->depth, 10);
+	}
+
 	return bfs_fprintf(cfile, fmt, "%jd", (intmax_t)ftwbuf->depth);
 }
 
@@ -241,8 +362,7 @@ static int bfs_printf_D(CFILE *cfile, const struct bfs_fmt *fmt, const struct BF
 		return -1;
 	}
 
-	BFS_PRINTF_BUF(buf, "%ju", (uintmax_t)statbuf->dev);
-	return bfs_fprintf(cfile, fmt, "%s", buf);
+	return bfs_printf_uint(cfile, fmt, statbuf->dev, 10);
 }
 
 /** %f: file name */
@@ -250,7 +370,7 @@ static int bfs_printf_f(CFILE *cfile, const struct bfs_fmt *fmt, const struct BF
 	if (should_color(cfile, fmt)) {
 		return cfprintf(cfile, "%pF", ftwbuf);
 	} else {
-		return bfs_fprintf(cfile, fmt, "%s", ftwbuf->path + ftwbuf->nameoff);
+		return bfs_printf_str(cfile, fmt, ftwbuf->path + ftwbuf->nameoff);
 	}
 }
 
@@ -266,7 +386,7 @@ static int bfs_printf_F(CFILE *cfile, const struct bfs_fmt *fmt, const struct BF
 		return -1;
 	}
 
-	return bfs_fprintf(cfile, fmt, "%s", type);
+	return bfs_printf_str(cfile, fmt, type);
 }
 
 /** %G: gid */
@@ -276,8 +396,7 @@ static int bfs_printf_G(CFILE *cfile, const struct bfs_fmt *fmt, const struct BF
 		return -1;
 	}
 
-	BFS_PRINTF_BUF(buf, "%ju", (uintmax_t)statbuf->gid);
-	return bfs_fprintf(cfile, fmt, "%s", buf);
+	return bfs_printf_uint(cfile, fmt, statbuf->gid, 10);
 }
 
 /** %g: group name */
@@ -293,7 +412,7 @@ static int bfs_printf_g(CFILE *cfile, const struct bfs_fmt *fmt, const struct BF
 		return bfs_printf_G(cfile, fmt, ftwbuf);
 	}
 
-	return bfs_fprintf(cfile, fmt, "%s", grp->gr_name);
+	return bfs_printf_str(cfile, fmt, grp->gr_name);
 }
 
 /** %h: leading directories */
@@ -322,7 +441,7 @@ static int bfs_printf_h(CFILE *cfile, const struct bfs_fmt *fmt, const struct BF
 	if (should_color(cfile, fmt)) {
 		ret = cfprintf(cfile, "${di}%pQ${rs}", buf);
 	} else {
-		ret = bfs_fprintf(cfile, fmt, "%s", buf);
+		ret = bfs_printf_str(cfile, fmt, buf);
 	}
 
 	free(copy);
@@ -338,7 +457,7 @@ static int bfs_printf_H(CFILE *cfile, const struct bfs_fmt *fmt, const struct BF
 			return cfprintf(cfile, "${di}%pQ${rs}", ftwbuf->root);
 		}
 	} else {
-		return bfs_fprintf(cfile, fmt, "%s", ftwbuf->root);
+		return bfs_printf_str(cfile, fmt, ftwbuf->root);
 	}
 }
 
@@ -349,8 +468,7 @@ static int bfs_printf_i(CFILE *cfile, const struct bfs_fmt *fmt, const struct BF
 		return -1;
 	}
 
-	BFS_PRINTF_BUF(buf, "%ju", (uintmax_t)statbuf->ino);
-	return bfs_fprintf(cfile, fmt, "%s", buf);
+	return bfs_printf_uint(cfile, fmt, statbuf->ino, 10);
 }
 
 /** %k: 1K blocks */
@@ -361,8 +479,7 @@ static int bfs_printf_k(CFILE *cfile, const struct bfs_fmt *fmt, const struct BF
 	}
 
 	uintmax_t blocks = ((uintmax_t)statbuf->blocks * BFS_STAT_BLKSIZE + 1023) / 1024;
-	BFS_PRINTF_BUF(buf, "%ju", blocks);
-	return bfs_fprintf(cfile, fmt, "%s", buf);
+	return bfs_printf_uint(cfile, fmt, blocks, 10);
 }
 
 /** %l: link target */
@@ -370,7 +487,7 @@ static int bfs_printf_l(CFILE *cfile, const struct bfs_fmt *fmt, const struct BF
 	char *buf = NULL;
 	const char *target = "";
 
-	if (ftwbuf->type == BFS_LNK) {
+	if (bftw_type(ftwbuf, ftwbuf->stat_flags) == BFS_LNK) {
 		if (should_color(cfile, fmt)) {
 			return cfprintf(cfile, "%pL", ftwbuf);
 		}
@@ -384,7 +501,7 @@ static int bfs_printf_l(CFILE *cfile, const struct bfs_fmt *fmt, const struct BF
 		}
 	}
 
-	int ret = bfs_fprintf(cfile, fmt, "%s", target);
+	int ret = bfs_printf_str(cfile, fmt, target);
 	free(buf);
 	return ret;
 }
@@ -396,7 +513,12 @@ static int bfs_printf_m(CFILE *cfile, const struct bfs_fmt *fmt, const struct BF
 		return -1;
 	}
 
-	return bfs_fprintf(cfile, fmt, "%o", (unsigned int)(statbuf->mode & 07777));
+	unsigned int mode = statbuf->mode & 07777;
+	if (fmt->simple) {
+		return bfs_printf_uint(cfile, fmt, mode, 8);
+	}
+
+	return bfs_fprintf(cfile, fmt, "%o", mode);
 }
 
 /** %M: symbolic mode */
@@ -408,7 +530,7 @@ static int bfs_printf_M(CFILE *cfile, const struct bfs_fmt *fmt, const struct BF
 
 	char buf[11];
 	xstrmode(statbuf->mode, buf);
-	return bfs_fprintf(cfile, fmt, "%s", buf);
+	return bfs_printf_str(cfile, fmt, buf);
 }
 
 /** %n: link count */
@@ -418,8 +540,7 @@ static int bfs_printf_n(CFILE *cfile, const struct bfs_fmt *fmt, const struct BF
 		return -1;
 	}
 
-	BFS_PRINTF_BUF(buf, "%ju", (uintmax_t)statbuf->nlink);
-	return bfs_fprintf(cfile, fmt, "%s", buf);
+	return bfs_printf_uint(cfile, fmt, statbuf->nlink, 10);
 }
 
 /** %p: full path */
@@ -427,7 +548,7 @@ static int bfs_printf_p(CFILE *cfile, const struct bfs_fmt *fmt, const struct BF
 	if (should_color(cfile, fmt)) {
 		return cfprintf(cfile, "%pP", ftwbuf);
 	} else {
-		return bfs_fprintf(cfile, fmt, "%s", ftwbuf->path);
+		return bfs_printf_str(cfile, fmt, ftwbuf->path);
 	}
 }
 
@@ -448,7 +569,7 @@ static int bfs_printf_P(CFILE *cfile, const struct bfs_fmt *fmt, const struct BF
 		copybuf.nameoff -= offset;
 		return cfprintf(cfile, "%pP", &copybuf);
 	} else {
-		return bfs_fprintf(cfile, fmt, "%s", ftwbuf->path + offset);
+		return bfs_printf_str(cfile, fmt, ftwbuf->path + offset);
 	}
 }
 
@@ -459,8 +580,7 @@ static int bfs_printf_s(CFILE *cfile, const struct bfs_fmt *fmt, const struct BF
 		return -1;
 	}
 
-	BFS_PRINTF_BUF(buf, "%ju", (uintmax_t)statbuf->size);
-	return bfs_fprintf(cfile, fmt, "%s", buf);
+	return bfs_printf_uint(cfile, fmt, statbuf->size, 10);
 }
 
 /** %S: sparseness */
@@ -486,8 +606,7 @@ static int bfs_printf_U(CFILE *cfile, const struct bfs_fmt *fmt, const struct BF
 		return -1;
 	}
 
-	BFS_PRINTF_BUF(buf, "%ju", (uintmax_t)statbuf->uid);
-	return bfs_fprintf(cfile, fmt, "%s", buf);
+	return bfs_printf_uint(cfile, fmt, statbuf->uid, 10);
 }
 
 /** %u: user name */
@@ -503,7 +622,7 @@ static int bfs_printf_u(CFILE *cfile, const struct bfs_fmt *fmt, const struct BF
 		return bfs_printf_U(cfile, fmt, ftwbuf);
 	}
 
-	return bfs_fprintf(cfile, fmt, "%s", pwd->pw_name);
+	return bfs_printf_str(cfile, fmt, pwd->pw_name);
 }
 
 static const char *bfs_printf_type(enum bfs_type type) {
@@ -530,8 +649,23 @@ static const char *bfs_printf_type(enum bfs_type type) {
 
 /** %y: type */
 static int bfs_printf_y(CFILE *cfile, const struct bfs_fmt *fmt, const struct BFTW *ftwbuf) {
-	const char *type = bfs_printf_type(ftwbuf->type);
-	return bfs_fprintf(cfile, fmt, "%s", type);
+	const char *type = bfs_printf_type(bftw_type(ftwbuf, ftwbuf->stat_flags));
+	return bfs_printf_str(cfile, fmt, type);
+}
+
+/** %X: SHA-256 of the contents */
+static int bfs_printf_X(CFILE *cfile, const struct bfs_fmt *fmt, const struct BFTW *ftwbuf) {
+	char buf[BFS_HASH_MAX];
+	const char *hex = "";
+
+	if (bftw_type(ftwbuf, ftwbuf->stat_flags) == BFS_REG) {
+		if (bfs_hasher_file(fmt->ptr, BFS_SHA256, ftwbuf->at_fd, ftwbuf->at_path, buf) != 0) {
+			return -1;
+		}
+		hex = buf;
+	}
+
+	return bfs_printf_str(cfile, fmt, hex);
 }
 
 /** %Y: target type */
@@ -553,7 +687,7 @@ static int bfs_printf_Y(CFILE *cfile, const struct bfs_fmt *fmt, const struct BF
 		str = bfs_printf_type(type);
 	}
 
-	int ret = bfs_fprintf(cfile, fmt, "%s", str);
+	int ret = bfs_printf_str(cfile, fmt, str);
 	if (error != 0) {
 		ret = -1;
 		errno = error;
@@ -569,7 +703,7 @@ static int bfs_printf_Z(CFILE *cfile, const struct bfs_fmt *fmt, const struct BF
 		return -1;
 	}
 
-	int ret = bfs_fprintf(cfile, fmt, "%s", con);
+	int ret = bfs_printf_str(cfile, fmt, con);
 	bfs_freecon(con);
 	return ret;
 }
@@ -588,8 +722,10 @@ static int append_literal(const struct bfs_ctx *ctx, struct bfs_printf *format,
 		return -1;
 	}
 
-	fmt->fn = bfs_printf_literal;
-	fmt->str = *literal;
+	*fmt = (struct bfs_fmt){
+		.fn = bfs_printf_literal,
+		.str = *literal,
+	};
 
 	*literal = dstralloc(0);
 	if (!*literal) {
@@ -600,6 +736,15 @@ static int append_literal(const struct bfs_ctx *ctx, struct bfs_printf *format,
 	return 0;
 }
 
+/** Free a directive. */
+static void bfs_fmt_free(struct bfs_fmt *fmt) {
+	if (fmt->fn == bfs_printf_X) {
+		bfs_hasher_free(fmt->ptr);
+	}
+	free(fmt->cache);
+	dstrfree(fmt->str);
+}
+
 /**
  * Append a printf directive to the chain.
  */
@@ -686,6 +831,7 @@ int bfs_printf_parse(const struct bfs_ctx *ctx, struct bfs_expr *expr, const cha
 
 			struct bfs_fmt fmt = {
 				.str = dstralloc(2),
+				.simple = true,
 			};
 			if (!fmt.str) {
 				goto fmt_error;
@@ -708,8 +854,12 @@ int bfs_printf_parse(const struct bfs_ctx *ctx, struct bfs_expr *expr, const cha
 				case '+':
 				case ' ':
 					must_be_numeric = true;
+					fmt.simple = false;
 					[[fallthrough]];
 				case '-':
+					if (c == '-') {
+						fmt.left = true;
+					}
 					if (strchr(fmt.str, c)) {
 						bfs_expr_error(ctx, expr);
 						bfs_error(ctx, "Duplicate flag '%c'.\n", c);
@@ -731,11 +881,19 @@ int bfs_printf_parse(const struct bfs_ctx *ctx, struct bfs_expr *expr, const cha
 					bfs_perror(ctx, "dstrapp()");
 					goto fmt_error;
 				}
+
+				// Leave huge widths to printf()
+				fmt.width = 10 * fmt.width + (c - '0');
+				if (fmt.width > BFS_PRINTF_MAX_WIDTH) {
+					fmt.simple = false;
+				}
+
 				c = *++i;
 			}
 
 			// Parse the precision
 			if (c == '.') {
+				fmt.simple = false;
 				do {
 					if (dstrapp(&fmt.str, c) != 0) {
 						bfs_perror(ctx, "dstrapp()");
@@ -840,6 +998,17 @@ int bfs_printf_parse(const struct bfs_ctx *ctx, struct bfs_expr *expr, const cha
 			case 'y':
 				fmt.fn = bfs_printf_y;
 				break;
+			case 'X':
+				fmt.fn = bfs_printf_X;
+				// To open() the file
+				expr->ephemeral_fds = 1;
+				// Read ahead on a background thread while hashing, unless we're -j1
+				fmt.ptr = bfs_hasher_new(ctx->threads > 1 ? 1 : 0, 1);
+				if (!fmt.ptr) {
+					bfs_perror(ctx, "bfs_hasher_new()");
+					goto fmt_error;
+				}
+				break;
 			case 'Y':
 				fmt.fn = bfs_printf_Y;
 				break;
@@ -881,6 +1050,15 @@ int bfs_printf_parse(const struct bfs_ctx *ctx, struct bfs_expr *expr, const cha
 					bfs_error(ctx, "Unrecognized time specifier '%%%c%c'.\n", i[-1], c);
 					goto fmt_error;
 				}
+
+				// Cache the directives that don't depend on the seconds
+				if (!strchr("+@crsSTX", c)) {
+					fmt.cache = ZALLOC(struct bfs_time_cache);
+					if (!fmt.cache) {
+						bfs_perror(ctx, "zalloc()");
+						goto fmt_error;
+					}
+				}
 				break;
 
 			case '\0':
@@ -912,7 +1090,7 @@ int bfs_printf_parse(const struct bfs_ctx *ctx, struct bfs_expr *expr, const cha
 			continue;
 
 		fmt_error:
-			dstrfree(fmt.str);
+			bfs_fmt_free(&fmt);
 			goto error;
 		}
 
@@ -958,7 +1136,7 @@ void bfs_printf_free(struct bfs_printf *format) {
 	}
 
 	for (size_t i = 0; i < format->nfmts; ++i) {
-		dstrfree(format->fmts[i].str);
+		bfs_fmt_free(&format->fmts[i]);
 	}
 	free(format->fmts);
 	free(format);
@@ -0,0 +1,282 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+#include "printjson.h"
+
+#include "bfs.h"
+#include "bftw.h"
+#include "bit.h"
+#include "color.h"
+#include "dir.h"
+#include "stat.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/** Find the first byte of a string that needs escaping in JSON. */
+static size_t json_span(const char *str, size_t n) {
+	const unsigned char *ustr = (const unsigned char *)str;
+	size_t i = 0;
+
+	// Word-at-a-time search for control characters, quotes, backslashes,
+	// and non-ASCII bytes (which need UTF-8 validation)
+	const uint64_t ones = UINT64_C(0x0101010101010101);
+	const uint64_t high = ones << 7;
+	for (; n - i >= sizeof(uint64_t); i += sizeof(uint64_t)) {
+		uint64_t word = load8_leu64(ustr + i);
+		uint64_t quote = word ^ ('"' * ones);
+		uint64_t bslash = word ^ ('\\' * ones);
+
+		// The lowest flagged byte of each (x - ones) & ~x term is exact
+		uint64_t mask = word;
+		mask |= (word - 0x20 * ones) & ~word;
+		mask |= (quote - ones) & ~quote;
+		mask |= (bslash - ones) & ~bslash;
+		mask &= high;
+		if (mask) {
+			return i + trailing_zeros(mask) / 8;
+		}
+	}
+
+	for (; i < n; ++i) {
+		unsigned char c = ustr[i];
+		if (c < 0x20 || c == '"' || c == '\\' || c >= 0x80) {
+			break;
+		}
+	}
+
+	return i;
+}
+
+/** Get the length of a valid UTF-8 sequence, or 0 if it's invalid. */
+static size_t json_utf8_len(const char *str, size_t n) {
+	const unsigned char *ustr = (const unsigned char *)str;
+	unsigned char c = ustr[0];
+
+	size_t len;
+	unsigned char min = 0x80, max = 0xBF;
+	if (c >= 0xC2 && c <= 0xDF) {
+		len = 2;
+	} else if (c >= 0xE0 && c <= 0xEF) {
+		len = 3;
+		if (c == 0xE0) {
+			// Overlong
+			min = 0xA0;
+		} else if (c == 0xED) {
+			// Surrogates
+			max = 0x9F;
+		}
+	} else if (c >= 0xF0 && c <= 0xF4) {
+		len = 4;
+		if (c == 0xF0) {
+			// Overlong
+			min = 0x90;
+		} else if (c == 0xF4) {
+			// > U+10FFFF
+			max = 0x8F;
+		}
+	} else {
+		return 0;
+	}
+
+	if (n < len || ustr[1] < min || ustr[1] > max) {
+		return 0;
+	}
+
+	for (size_t i = 2; i < len; ++i) {
+		if (ustr[i] < 0x80 || ustr[i] > 0xBF) {
+			return 0;
+		}
+	}
+
+	return len;
+}
+
+/** Print a string as JSON. */
+static int print_json_str(FILE *file, const char *str) {
+	size_t len = strlen(str);
+
+	if (putc('"', file) == EOF) {
+		return -1;
+	}
+
+	while (len > 0) {
+		size_t span = json_span(str, len);
+		if (fwrite(str, 1, span, file) != span) {
+			return -1;
+		}
+		str += span;
+		len -= span;
+		if (len == 0) {
+			break;
+		}
+
+		unsigned char c = *str;
+		if (c >= 0x80) {
+			span = json_utf8_len(str, len);
+			if (span > 0) {
+				if (fwrite(str, 1, span, file) != span) {
+					return -1;
+				}
+				str += span;
+				len -= span;
+				continue;
+			}
+		}
+
+		char buf[8];
+		const char *esc = buf;
+		switch (c) {
+		case '"':  esc = "\\\""; break;
+		case '\\': esc = "\\\\"; break;
+		case '\b': esc = "\\b";  break;
+		case '\f': esc = "\\f";  break;
+		case '\n': esc = "\\n";  break;
+		case '\r': esc = "\\r";  break;
+		case '\t': esc = "\\t";  break;
+		default:
+			// Invalid UTF-8 is escaped as a lone surrogate U+DC80-U+DCFF,
+			// like Python's "surrogateescape" error handler
+			snprintf(buf, sizeof(buf), "\\u%.4x", c < 0x80 ? c : 0xDC00 | c);
+			break;
+		}
+
+		if (fputs(esc, file) == EOF) {
+			return -1;
+		}
+		++str;
+		--len;
+	}
+
+	if (putc('"', file) == EOF) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/** Get the JSON name for a file type. */
+static const char *json_type(enum bfs_type type) {
+	const char *const names[] = {
+		[BFS_BLK] = "block",
+		[BFS_CHR] = "char",
+		[BFS_DIR] = "dir",
+		[BFS_DOOR] = "door",
+		[BFS_FIFO] = "fifo",
+		[BFS_LNK] = "link",
+		[BFS_PORT] = "port",
+		[BFS_REG] = "file",
+		[BFS_SOCK] = "socket",
+		[BFS_WHT] = "whiteout",
+	};
+
+	const char *name = NULL;
+	if ((size_t)type < countof(names)) {
+		name = names[type];
+	}
+
+	return name ? name : "unknown";
+}
+
+/** Print an integer JSON field. */
+static int print_json_uint(FILE *file, const char *key, uintmax_t value) {
+	return fprintf(file, ",\"%s\":%ju", key, value);
+}
+
+/** Print a timestamp JSON field, in seconds since the epoch. */
+static int print_json_time(FILE *file, const char *key, const struct timespec *ts) {
+	intmax_t sec = ts->tv_sec;
+	long nsec = ts->tv_nsec;
+	const char *sign = "";
+	if (sec < 0 && nsec > 0) {
+		// -1.25s is {-2, 750000000}
+		sign = "-";
+		sec = -(sec + 1);
+		nsec = 1000000000 - nsec;
+	} else if (sec < 0) {
+		sign = "-";
+		sec = -sec;
+	}
+
+	return fprintf(file, ",\"%s\":%s%jd.%09ld", key, sign, sec, nsec);
+}
+
+int bfs_printjson(CFILE *cfile, const struct BFTW *ftwbuf, const struct bfs_stat *statbuf, const char *target) {
+	FILE *file = cfile->file;
+
+	if (fputs("{\"path\":", file) == EOF) {
+		return -1;
+	}
+	if (print_json_str(file, ftwbuf->path) != 0) {
+		return -1;
+	}
+
+	enum bfs_type type = bfs_mode_to_type(statbuf->mode);
+	if (fprintf(file, ",\"type\":\"%s\"", json_type(type)) < 0) {
+		return -1;
+	}
+	if (print_json_uint(file, "depth", ftwbuf->depth) < 0) {
+		return -1;
+	}
+
+	/** The integer fields to print. */
+	const struct {
+		enum bfs_stat_field field;
+		const char *key;
+		uintmax_t value;
+	} fields[] = {
+		{BFS_STAT_DEV, "dev", statbuf->dev},
+		{BFS_STAT_INO, "ino", statbuf->ino},
+		{BFS_STAT_MODE, "mode", statbuf->mode & 07777},
+		{BFS_STAT_NLINK, "nlink", statbuf->nlink},
+		{BFS_STAT_UID, "uid", statbuf->uid},
+		{BFS_STAT_GID, "gid", statbuf->gid},
+		{BFS_STAT_SIZE, "size", statbuf->size},
+		{BFS_STAT_BLOCKS, "blocks", ((uintmax_t)statbuf->blocks * BFS_STAT_BLKSIZE + 511) / 512},
+	};
+	for (size_t i = 0; i < countof(fields); ++i) {
+		if (!(statbuf->mask & fields[i].field)) {
+			continue;
+		}
+		if (print_json_uint(file, fields[i].key, fields[i].value) < 0) {
+			return -1;
+		}
+	}
+
+	/** The timestamp fields to print. */
+	const struct {
+		enum bfs_stat_field field;
+		const char *key;
+	} times[] = {
+		{BFS_STAT_ATIME, "atime"},
+		{BFS_STAT_BTIME, "btime"},
+		{BFS_STAT_CTIME, "ctime"},
+		{BFS_STAT_MTIME, "mtime"},
+	};
+	for (size_t i = 0; i < countof(times); ++i) {
+		const struct timespec *ts = bfs_stat_time(statbuf, times[i].field);
+		if (!ts) {
+			continue;
+		}
+		if (print_json_time(file, times[i].key, ts) < 0) {
+			return -1;
+		}
+	}
+
+	if (target) {
+		if (fputs(",\"target\":", file) == EOF) {
+			return -1;
+		}
+		if (print_json_str(file, target) != 0) {
+			return -1;
+		}
+	}
+
+	if (fputs("}\n", file) == EOF) {
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,40 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+/**
+ * Implementation of -printjson.
+ *
+ * Each file gets a single line of JSON:
+ *
+ *     {"path":"./file","type":"file","depth":1,"dev":2049,...}
+ *
+ * The stat() fields are omitted if the file system doesn't provide them, and
+ * symbolic links get an extra "target" field.  Strings are escaped as needed,
+ * and bytes that aren't valid UTF-8 become the lone surrogates U+DC80-U+DCFF.
+ */
+
+#ifndef BFS_PRINTJSON_H
+#define BFS_PRINTJSON_H
+
+#include "color.h"
+
+struct BFTW;
+struct bfs_stat;
+
+/**
+ * Write a JSON record for a file.
+ *
+ * @cfile
+ *         The stream to write to.
+ * @ftwbuf
+ *         The bftw() data for the current file.
+ * @statbuf
+ *         The stat() buffer for the current file.
+ * @target
+ *         The target of a symbolic link, or NULL.
+ * @return
+ *         0 on success, -1 on failure.
+ */
+int bfs_printjson(CFILE *cfile, const struct BFTW *ftwbuf, const struct bfs_stat *statbuf, const char *target);
+
+#endif // BFS_PRINTJSON_H
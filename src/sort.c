@@ -0,0 +1,527 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+#include "sort.h"
+
+#include "alloc.h"
+#include "bfs.h"
+#include "bftw.h"
+#include "color.h"
+#include "ctx.h"
+#include "diag.h"
+#include "expr.h"
+#include "stat.h"
+#include "thread.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/** The default number of bytes of records to buffer before spilling a run. */
+#define SORT_RUN_MAX (64 << 20)
+
+/** The number of runs of the same level to merge together. */
+#define SORT_MERGE_WAYS 4
+
+/**
+ * The keys that -sort-by can order by.
+ */
+enum sort_key {
+	/** The path itself. */
+	SORT_PATH,
+	/** The file size, in bytes. */
+	SORT_SIZE,
+	/** The disk usage, in 512-byte blocks. */
+	SORT_BLOCKS,
+	/** A timestamp. */
+	SORT_TIME,
+	/** The depth in the directory tree. */
+	SORT_DEPTH,
+};
+
+/**
+ * The header of a record, as written to a run.
+ */
+struct sort_header {
+	/** The integer value, or the seconds for timestamps. */
+	intmax_t n;
+	/** The nanoseconds for timestamps, or 0. */
+	long nsec;
+	/** The length of the path. */
+	size_t len;
+};
+
+/**
+ * A buffered file.
+ */
+struct sort_record {
+	/** The value of the key, and the path length. */
+	struct sort_header header;
+	/** The path itself. */
+	char path[];
+};
+
+/**
+ * A position in a run being merged.
+ */
+struct sort_cursor {
+	/** The run to read from. */
+	FILE *file;
+	/** The current record, or NULL at the end of the run. */
+	struct sort_record *record;
+	/** The buffer for the current record. */
+	struct sort_record *buf;
+	/** The capacity of the buffer's path. */
+	size_t cap;
+};
+
+/**
+ * The records of a run, before it's spilled.
+ */
+struct sort_buffer {
+	/** The records in the run. */
+	struct sort_record **records;
+	/** The number of records in the run. */
+	size_t nrecords;
+	/** Allocates the records in the run. */
+	struct varena arena;
+};
+
+struct bfs_sort {
+	/** The key to sort by. */
+	enum sort_key key;
+	/** The timestamp to use for SORT_TIME. */
+	enum bfs_stat_field field;
+
+	/** The current run. */
+	struct sort_buffer cur;
+	/** The memory used by the current run. */
+	size_t used;
+	/** The memory to use before spilling the current run. */
+	size_t budget;
+
+	/** Whether to spill runs on a background thread. */
+	bool async;
+	/** The background thread spilling a run, if any. */
+	pthread_t thread;
+	/** Whether the background thread is running. */
+	bool spilling;
+	/** The run being spilled by the background thread. */
+	struct sort_buffer spill;
+	/** The error from the last background spill, if any. */
+	int error;
+
+	/** The sorted runs that have been spilled (owned by the thread while spilling). */
+	FILE *runs[BFS_SORT_FANIN];
+	/** The merge level of each run, i.e. how many merges it went through. */
+	unsigned int levels[BFS_SORT_FANIN];
+	/** The number of spilled runs. */
+	size_t nruns;
+};
+
+int bfs_sort_parse(const struct bfs_ctx *ctx, struct bfs_expr *expr, const char *key) {
+	struct bfs_sort *sort = ZALLOC(struct bfs_sort);
+	if (!sort) {
+		bfs_perror(ctx, "zalloc()");
+		return -1;
+	}
+
+	VARENA_INIT(&sort->cur.arena, struct sort_record, path);
+	VARENA_INIT(&sort->spill.arena, struct sort_record, path);
+	sort->budget = SORT_RUN_MAX;
+	// Sort and write full runs while the next one fills, unless we're -j1
+	sort->async = ctx->threads > 1;
+	expr->sort = sort;
+
+	if (strcmp(key, "path") == 0) {
+		sort->key = SORT_PATH;
+	} else if (strcmp(key, "size") == 0) {
+		sort->key = SORT_SIZE;
+	} else if (strcmp(key, "blocks") == 0) {
+		sort->key = SORT_BLOCKS;
+	} else if (strcmp(key, "atime") == 0) {
+		sort->key = SORT_TIME;
+		sort->field = BFS_STAT_ATIME;
+	} else if (strcmp(key, "ctime") == 0) {
+		sort->key = SORT_TIME;
+		sort->field = BFS_STAT_CTIME;
+	} else if (strcmp(key, "mtime") == 0) {
+		sort->key = SORT_TIME;
+		sort->field = BFS_STAT_MTIME;
+	} else if (strcmp(key, "depth") == 0) {
+		sort->key = SORT_DEPTH;
+	} else {
+		bfs_expr_error(ctx, expr);
+		bfs_error(ctx, "Unknown key ${bld}%pq${rs}.\n", key);
+		bfs_error(ctx, "Use one of ${bld}path${rs}, ${bld}size${rs}, ${bld}blocks${rs}, ${bld}mtime${rs}, ${bld}atime${rs}, ${bld}ctime${rs}, or ${bld}depth${rs}.\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+void bfs_sort_set_budget(struct bfs_sort *sort, size_t budget) {
+	sort->budget = budget;
+}
+
+bool bfs_sort_needs_stat(const struct bfs_sort *sort) {
+	return sort->key != SORT_PATH && sort->key != SORT_DEPTH;
+}
+
+/** Fill in the value of the key for a file. */
+static void sort_value(const struct bfs_sort *sort, struct sort_header *header, const struct BFTW *ftwbuf, const struct bfs_stat *statbuf) {
+	const struct timespec *ts;
+
+	header->n = 0;
+	header->nsec = 0;
+
+	switch (sort->key) {
+	case SORT_PATH:
+		break;
+	case SORT_SIZE:
+		header->n = statbuf->size;
+		break;
+	case SORT_BLOCKS:
+		header->n = ((intmax_t)statbuf->blocks * BFS_STAT_BLKSIZE + 511) / 512;
+		break;
+	case SORT_TIME:
+		ts = bfs_stat_time(statbuf, sort->field);
+		if (ts) {
+			header->n = ts->tv_sec;
+			header->nsec = ts->tv_nsec;
+		} else {
+			header->n = INTMAX_MIN;
+		}
+		break;
+	case SORT_DEPTH:
+		header->n = ftwbuf->depth;
+		break;
+	}
+}
+
+/** Compare two records.  Ties are broken by path. */
+static int sort_cmp(const struct sort_record *lhs, const struct sort_record *rhs) {
+	if (lhs->header.n != rhs->header.n) {
+		return lhs->header.n < rhs->header.n ? -1 : 1;
+	}
+
+	if (lhs->header.nsec != rhs->header.nsec) {
+		return lhs->header.nsec < rhs->header.nsec ? -1 : 1;
+	}
+
+	return strcmp(lhs->path, rhs->path);
+}
+
+/** qsort() comparator for records. */
+static int sort_qsort_cmp(const void *a, const void *b) {
+	const struct sort_record *lhs = *(const struct sort_record *const *)a;
+	const struct sort_record *rhs = *(const struct sort_record *const *)b;
+	return sort_cmp(lhs, rhs);
+}
+
+/** Sort a run in memory. */
+static void sort_run(struct sort_buffer *buf) {
+	qsort(buf->records, buf->nrecords, sizeof(*buf->records), sort_qsort_cmp);
+}
+
+/** Write a record to a run. */
+static int sort_write(FILE *file, const struct sort_record *record) {
+	size_t len = record->header.len;
+	if (fwrite(&record->header, sizeof(record->header), 1, file) != 1) {
+		return -1;
+	}
+	if (fwrite(record->path, 1, len, file) != len) {
+		return -1;
+	}
+	return 0;
+}
+
+/** Read the next record from a run. */
+static int sort_read(struct sort_cursor *cursor) {
+	struct sort_header header;
+	if (fread(&header, sizeof(header), 1, cursor->file) != 1) {
+		if (ferror(cursor->file)) {
+			errno = EIO;
+			return -1;
+		}
+		cursor->record = NULL;
+		return 0;
+	}
+
+	if (cursor->cap < header.len + 1) {
+		struct sort_record *buf = REALLOC_FLEX(struct sort_record, path, cursor->buf, cursor->cap, header.len + 1);
+		if (!buf) {
+			return -1;
+		}
+		cursor->buf = buf;
+		cursor->cap = header.len + 1;
+	}
+
+	struct sort_record *record = cursor->buf;
+	record->header = header;
+	if (fread(record->path, 1, header.len, cursor->file) != header.len) {
+		// A short read means the run was truncated
+		errno = EIO;
+		return -1;
+	}
+	record->path[header.len] = '\0';
+
+	cursor->record = record;
+	return 0;
+}
+
+/** Output a record, either to another run or to the final output. */
+static int sort_emit(const struct sort_record *record, FILE *run, CFILE *cfile) {
+	if (run) {
+		return sort_write(run, record);
+	} else {
+		return cfputpath(cfile, record->path);
+	}
+}
+
+/**
+ * Merge some spilled runs together, closing them.
+ *
+ * @sort
+ *         The -sort-by state.
+ * @start
+ *         The index of the first run to merge.  All the runs after it are
+ *         merged too.
+ * @run
+ *         The run to merge into, or NULL to print to cfile instead.
+ * @cfile
+ *         The final output stream.
+ */
+static int sort_merge(struct bfs_sort *sort, size_t start, FILE *run, CFILE *cfile) {
+	int ret = -1;
+	FILE **runs = sort->runs + start;
+	size_t nruns = sort->nruns - start;
+
+	struct sort_cursor cursors[BFS_SORT_FANIN] = {0};
+	for (size_t i = 0; i < nruns; ++i) {
+		cursors[i].file = runs[i];
+		rewind(cursors[i].file);
+		if (sort_read(&cursors[i]) != 0) {
+			goto done;
+		}
+	}
+
+	while (true) {
+		// The fan-in is small enough that a linear scan beats a heap
+		struct sort_cursor *min = NULL;
+		for (size_t i = 0; i < nruns; ++i) {
+			struct sort_cursor *cursor = &cursors[i];
+			if (cursor->record && (!min || sort_cmp(cursor->record, min->record) < 0)) {
+				min = cursor;
+			}
+		}
+
+		if (!min) {
+			break;
+		}
+
+		if (sort_emit(min->record, run, cfile) != 0) {
+			goto done;
+		}
+
+		if (sort_read(min) != 0) {
+			goto done;
+		}
+	}
+
+	ret = 0;
+done:
+	for (size_t i = 0; i < nruns; ++i) {
+		free(cursors[i].buf);
+		fclose(runs[i]);
+	}
+	sort->nruns = start;
+	return ret;
+}
+
+/** Merge the runs starting at the given index into a single bigger run. */
+static int sort_collapse(struct bfs_sort *sort, size_t start) {
+	FILE *run = tmpfile();
+	if (!run) {
+		return -1;
+	}
+
+	// Levels never increase along the stack, so the first run is the biggest
+	unsigned int level = sort->levels[start] + 1;
+	if (sort_merge(sort, start, run, NULL) != 0) {
+		fclose(run);
+		return -1;
+	}
+
+	sort->runs[sort->nruns] = run;
+	sort->levels[sort->nruns] = level;
+	++sort->nruns;
+	return 0;
+}
+
+/** Sort a run and write it to a temporary file. */
+static int sort_spill_run(struct bfs_sort *sort, struct sort_buffer *buf) {
+	// Too many open runs, so merge them all into one
+	if (sort->nruns == BFS_SORT_FANIN && sort_collapse(sort, 0) != 0) {
+		return -1;
+	}
+
+	FILE *run = tmpfile();
+	if (!run) {
+		return -1;
+	}
+
+	sort_run(buf);
+	for (size_t i = 0; i < buf->nrecords; ++i) {
+		if (sort_write(run, buf->records[i]) != 0) {
+			fclose(run);
+			return -1;
+		}
+	}
+
+	free(buf->records);
+	buf->records = NULL;
+	buf->nrecords = 0;
+	varena_clear(&buf->arena);
+
+	sort->runs[sort->nruns] = run;
+	sort->levels[sort->nruns] = 0;
+	++sort->nruns;
+
+	// Merge runs of the same size together, like a binary counter with
+	// SORT_MERGE_WAYS digits, so each record is only rewritten O(log n) times
+	while (sort->nruns >= SORT_MERGE_WAYS) {
+		size_t start = sort->nruns - SORT_MERGE_WAYS;
+		if (sort->levels[start] != sort->levels[sort->nruns - 1]) {
+			break;
+		}
+		if (sort_collapse(sort, start) != 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/** Background thread entry point for spilling a run. */
+static void *sort_spill_work(void *ptr) {
+	struct bfs_sort *sort = ptr;
+	if (sort_spill_run(sort, &sort->spill) != 0) {
+		sort->error = errno;
+	}
+	return NULL;
+}
+
+/** Wait for any background spill to finish. */
+static int sort_wait(struct bfs_sort *sort) {
+	if (sort->spilling) {
+		thread_join(sort->thread, NULL);
+		sort->spilling = false;
+	}
+
+	if (sort->error) {
+		errno = sort->error;
+		return -1;
+	}
+
+	return 0;
+}
+
+/** Spill the current run, in the background if possible. */
+static int sort_spill(struct bfs_sort *sort) {
+	// Only one run is spilled at a time
+	if (sort_wait(sort) != 0) {
+		return -1;
+	}
+
+	sort->used = 0;
+
+	if (!sort->async) {
+		return sort_spill_run(sort, &sort->cur);
+	}
+
+	// Hand the full run to the thread, and fill the next one in the
+	// (empty) buffer from the last spill
+	struct sort_buffer tmp = sort->spill;
+	sort->spill = sort->cur;
+	sort->cur = tmp;
+
+	if (thread_create(&sort->thread, NULL, sort_spill_work, sort) != 0) {
+		return sort_spill_run(sort, &sort->spill);
+	}
+	thread_setname(sort->thread, "sort");
+	sort->spilling = true;
+	return 0;
+}
+
+int bfs_sort_add(struct bfs_sort *sort, const struct BFTW *ftwbuf, const struct bfs_stat *statbuf) {
+	size_t len = strlen(ftwbuf->path);
+	struct sort_record *record = varena_alloc(&sort->cur.arena, len + 1);
+	if (!record) {
+		return -1;
+	}
+
+	sort_value(sort, &record->header, ftwbuf, statbuf);
+	record->header.len = len;
+	memcpy(record->path, ftwbuf->path, len + 1);
+
+	struct sort_record **slot = RESERVE(struct sort_record *, &sort->cur.records, &sort->cur.nrecords);
+	if (!slot) {
+		varena_free(&sort->cur.arena, record, len + 1);
+		return -1;
+	}
+	*slot = record;
+
+	sort->used += sizeof_flex(struct sort_record, path, len + 1) + sizeof(*slot);
+	if (sort->used >= sort->budget) {
+		return sort_spill(sort);
+	}
+
+	return 0;
+}
+
+int bfs_sort_print(struct bfs_sort *sort, CFILE *cfile) {
+	if (sort_wait(sort) != 0) {
+		return -1;
+	}
+
+	struct sort_buffer *buf = &sort->cur;
+	if (sort->nruns > 0) {
+		// Everything has to go through the merge
+		if (buf->nrecords > 0 && sort_spill_run(sort, buf) != 0) {
+			return -1;
+		}
+		return sort_merge(sort, 0, NULL, cfile);
+	}
+
+	sort_run(buf);
+	for (size_t i = 0; i < buf->nrecords; ++i) {
+		if (sort_emit(buf->records[i], NULL, cfile) != 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+void bfs_sort_free(struct bfs_sort *sort) {
+	if (!sort) {
+		return;
+	}
+
+	sort_wait(sort);
+
+	for (size_t i = 0; i < sort->nruns; ++i) {
+		fclose(sort->runs[i]);
+	}
+
+	free(sort->spill.records);
+	varena_destroy(&sort->spill.arena);
+	free(sort->cur.records);
+	varena_destroy(&sort->cur.arena);
+	free(sort);
+}
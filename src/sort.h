@@ -0,0 +1,91 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+/**
+ * Implementation of -sort-by.
+ *
+ * Matching files are buffered in memory until a budget is reached, at which
+ * point the buffer is sorted and spilled to a temporary file as a "run".  With
+ * more than one thread, a background thread sorts and spills each full run
+ * while the next one fills.  At the end, the runs are merged to produce the
+ * sorted output.
+ */
+
+#ifndef BFS_SORT_H
+#define BFS_SORT_H
+
+#include "color.h"
+
+struct BFTW;
+struct bfs_ctx;
+struct bfs_expr;
+struct bfs_stat;
+
+/**
+ * The maximum number of runs that are kept open at once.
+ */
+#define BFS_SORT_FANIN 16
+
+/**
+ * The buffered output of -sort-by.
+ */
+struct bfs_sort;
+
+/**
+ * Parse a -sort-by key.
+ *
+ * @ctx
+ *         The bfs context.
+ * @expr
+ *         The expression to fill in.
+ * @key
+ *         The key to sort by.
+ * @return
+ *         0 on success, -1 on failure.
+ */
+int bfs_sort_parse(const struct bfs_ctx *ctx, struct bfs_expr *expr, const char *key);
+
+/**
+ * Set the number of bytes of records to buffer before spilling a run.  The
+ * default is 64 MiB; smaller budgets are mainly useful for testing.
+ */
+void bfs_sort_set_budget(struct bfs_sort *sort, size_t budget);
+
+/**
+ * Check whether a key needs a stat() buffer.
+ */
+bool bfs_sort_needs_stat(const struct bfs_sort *sort);
+
+/**
+ * Add a file to the sorted output.
+ *
+ * @sort
+ *         The -sort-by state.
+ * @ftwbuf
+ *         The bftw() data for the current file.
+ * @statbuf
+ *         The stat() buffer for the current file, or NULL if the key doesn't
+ *         need one.
+ * @return
+ *         0 on success, -1 on failure.
+ */
+int bfs_sort_add(struct bfs_sort *sort, const struct BFTW *ftwbuf, const struct bfs_stat *statbuf);
+
+/**
+ * Print the sorted output.
+ *
+ * @sort
+ *         The -sort-by state.  The buffered files are consumed.
+ * @cfile
+ *         The stream to print to.
+ * @return
+ *         0 on success, -1 on failure.
+ */
+int bfs_sort_print(struct bfs_sort *sort, CFILE *cfile);
+
+/**
+ * Free the -sort-by state.
+ */
+void bfs_sort_free(struct bfs_sort *sort);
+
+#endif // BFS_SORT_H
@@ -0,0 +1,380 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+#include "summary.h"
+
+#include "alloc.h"
+#include "bfs.h"
+#include "bfstd.h"
+#include "bftw.h"
+#include "color.h"
+#include "ctx.h"
+#include "diag.h"
+#include "dstring.h"
+#include "expr.h"
+#include "pwcache.h"
+#include "stat.h"
+#include "trie.h"
+#include "xtime.h"
+
+#include <errno.h>
+#include <grp.h>
+#include <pwd.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * The different ways to group files.
+ */
+enum summary_key {
+	/** The file extension. */
+	SUMMARY_EXT,
+	/** The owning user. */
+	SUMMARY_USER,
+	/** The owning group. */
+	SUMMARY_GROUP,
+	/** The first N path components below the root. */
+	SUMMARY_PREFIX,
+	/** A range of file sizes. */
+	SUMMARY_SIZE,
+	/** A range of modification times. */
+	SUMMARY_AGE,
+};
+
+/** Labels for the size buckets. */
+static const char *const size_buckets[] = {
+	"0", "<1K", "<1M", "<1G", "<1T", "<1P", "<1E", ">=1E",
+};
+
+/** Upper bounds for the age buckets, in seconds. */
+static const time_t age_limits[] = {
+	60 * 60,
+	24 * 60 * 60,
+	7 * 24 * 60 * 60,
+	30 * 24 * 60 * 60,
+	365 * 24 * 60 * 60,
+};
+
+/** Labels for the age buckets. */
+static const char *const age_buckets[] = {
+	"future", "<1h", "<1d", "<1w", "<30d", "<1y", ">=1y",
+};
+
+/**
+ * The running totals for a single group.
+ */
+struct summary_group {
+	/** The key for this group. */
+	const char *key;
+	/** The bucket index, to keep ranges in order. */
+	size_t bucket;
+	/** The number of files. */
+	uintmax_t count;
+	/** The total size, in bytes. */
+	uintmax_t size;
+	/** The total number of blocks, in units of BFS_STAT_BLKSIZE. */
+	uintmax_t blocks;
+	/** The oldest modification time. */
+	struct timespec min_mtime;
+	/** The newest modification time. */
+	struct timespec max_mtime;
+};
+
+struct bfs_summary {
+	/** The key to group by. */
+	enum summary_key key;
+	/** The number of components for SUMMARY_PREFIX. */
+	size_t depth;
+	/** The current time, for SUMMARY_AGE. */
+	struct timespec now;
+	/** The user table, for SUMMARY_USER. */
+	struct bfs_users *users;
+	/** The group table, for SUMMARY_GROUP. */
+	struct bfs_groups *groups;
+
+	/** Maps keys to groups. */
+	struct trie trie;
+	/** Allocates the groups. */
+	struct arena totals;
+	/** The number of groups. */
+	size_t ngroups;
+	/** A buffer for the current key. */
+	dchar *buf;
+};
+
+int bfs_summary_parse(const struct bfs_ctx *ctx, struct bfs_expr *expr, const char *key) {
+	struct bfs_summary *summary = ZALLOC(struct bfs_summary);
+	if (!summary) {
+		bfs_perror(ctx, "zalloc()");
+		return -1;
+	}
+
+	trie_init(&summary->trie);
+	ARENA_INIT(&summary->totals, struct summary_group);
+	expr->summary = summary;
+
+	if (strcmp(key, "ext") == 0) {
+		summary->key = SUMMARY_EXT;
+	} else if (strcmp(key, "user") == 0) {
+		summary->key = SUMMARY_USER;
+		summary->users = ctx->users;
+	} else if (strcmp(key, "group") == 0) {
+		summary->key = SUMMARY_GROUP;
+		summary->groups = ctx->groups;
+	} else if (strcmp(key, "size") == 0) {
+		summary->key = SUMMARY_SIZE;
+	} else if (strcmp(key, "age") == 0) {
+		summary->key = SUMMARY_AGE;
+		summary->now = ctx->now;
+	} else if (strcmp(key, "prefix") == 0) {
+		summary->key = SUMMARY_PREFIX;
+		summary->depth = 1;
+	} else if (strncmp(key, "prefix:", 7) == 0) {
+		summary->key = SUMMARY_PREFIX;
+		unsigned long depth;
+		if (xstrtoul(key + 7, NULL, 10, &depth) != 0 || depth == 0) {
+			bfs_expr_error(ctx, expr);
+			bfs_error(ctx, "Invalid prefix depth ${bld}%pq${rs}.\n", key + 7);
+			return -1;
+		}
+		summary->depth = depth;
+	} else {
+		bfs_expr_error(ctx, expr);
+		bfs_error(ctx, "Unknown key ${bld}%pq${rs}.\n", key);
+		bfs_error(ctx, "Use one of ${bld}ext${rs}, ${bld}user${rs}, ${bld}group${rs}, ${bld}size${rs}, ${bld}age${rs}, or ${bld}prefix[:N]${rs}.\n");
+		return -1;
+	}
+
+	summary->buf = dstralloc(0);
+	if (!summary->buf) {
+		bfs_perror(ctx, "dstralloc()");
+		return -1;
+	}
+
+	return 0;
+}
+
+/** Get the extension of a file, or "" if it has none. */
+static const char *summary_ext(const struct BFTW *ftwbuf) {
+	const char *name = ftwbuf->path + ftwbuf->nameoff;
+	const char *dot = strrchr(name, '.');
+
+	// Hidden files like .bashrc don't have an extension
+	if (!dot || dot == name) {
+		return "";
+	}
+
+	return dot + 1;
+}
+
+/** Get the size bucket for a file. */
+static size_t summary_size(const struct bfs_stat *statbuf) {
+	uintmax_t size = statbuf->size;
+	if (size == 0) {
+		return 0;
+	}
+
+	size_t i = 1;
+	uintmax_t limit = 1024;
+	while (i < countof(size_buckets) - 1 && size >= limit) {
+		++i;
+		limit <<= 10;
+	}
+	return i;
+}
+
+/** Get the age bucket for a file. */
+static size_t summary_age(const struct bfs_summary *summary, const struct bfs_stat *statbuf) {
+	const struct timespec *mtime = bfs_stat_time(statbuf, BFS_STAT_MTIME);
+	if (timespec_cmp(mtime, &summary->now) > 0) {
+		return 0;
+	}
+
+	time_t age = summary->now.tv_sec - mtime->tv_sec;
+	size_t i = 0;
+	while (i < countof(age_limits) && age >= age_limits[i]) {
+		++i;
+	}
+	return i + 1;
+}
+
+/** Compute the key for a file. */
+static const char *summary_key(struct bfs_summary *summary, const struct BFTW *ftwbuf, const struct bfs_stat *statbuf, size_t *bucket) {
+	const struct passwd *pwd;
+	const struct group *grp;
+	const char *path;
+	size_t len;
+
+	*bucket = 0;
+
+	switch (summary->key) {
+	case SUMMARY_EXT:
+		return summary_ext(ftwbuf);
+
+	case SUMMARY_USER:
+		pwd = bfs_getpwuid(summary->users, statbuf->uid);
+		if (pwd) {
+			return pwd->pw_name;
+		}
+		dstrshrink(summary->buf, 0);
+		if (dstrcatf(&summary->buf, "%ju", (uintmax_t)statbuf->uid) != 0) {
+			return NULL;
+		}
+		return summary->buf;
+
+	case SUMMARY_GROUP:
+		grp = bfs_getgrgid(summary->groups, statbuf->gid);
+		if (grp) {
+			return grp->gr_name;
+		}
+		dstrshrink(summary->buf, 0);
+		if (dstrcatf(&summary->buf, "%ju", (uintmax_t)statbuf->gid) != 0) {
+			return NULL;
+		}
+		return summary->buf;
+
+	case SUMMARY_PREFIX:
+		path = ftwbuf->path;
+		len = strlen(ftwbuf->root);
+		for (size_t i = 0; i < summary->depth && path[len]; ++i) {
+			len += strspn(path + len, "/");
+			len += strcspn(path + len, "/");
+		}
+		if (dstrxcpy(&summary->buf, path, len) != 0) {
+			return NULL;
+		}
+		return summary->buf;
+
+	case SUMMARY_SIZE:
+		*bucket = summary_size(statbuf);
+		return size_buckets[*bucket];
+
+	case SUMMARY_AGE:
+		*bucket = summary_age(summary, statbuf);
+		return age_buckets[*bucket];
+	}
+
+	bfs_bug("Unexpected summary key %d", (int)summary->key);
+	errno = EINVAL;
+	return NULL;
+}
+
+int bfs_summary_add(struct bfs_summary *summary, const struct BFTW *ftwbuf, const struct bfs_stat *statbuf) {
+	size_t bucket;
+	const char *key = summary_key(summary, ftwbuf, statbuf, &bucket);
+	if (!key) {
+		return -1;
+	}
+
+	struct trie_leaf *leaf = trie_insert_str(&summary->trie, key);
+	if (!leaf) {
+		return -1;
+	}
+
+	const struct timespec *mtime = bfs_stat_time(statbuf, BFS_STAT_MTIME);
+
+	struct summary_group *group = leaf->value;
+	if (!group) {
+		group = arena_alloc(&summary->totals);
+		if (!group) {
+			trie_remove(&summary->trie, leaf);
+			return -1;
+		}
+
+		*group = (struct summary_group){
+			.key = leaf->key,
+			.bucket = bucket,
+			.min_mtime = *mtime,
+			.max_mtime = *mtime,
+		};
+		leaf->value = group;
+		++summary->ngroups;
+	}
+
+	++group->count;
+	group->size += statbuf->size;
+	group->blocks += statbuf->blocks;
+
+	if (timespec_cmp(mtime, &group->min_mtime) < 0) {
+		group->min_mtime = *mtime;
+	}
+	if (timespec_cmp(mtime, &group->max_mtime) > 0) {
+		group->max_mtime = *mtime;
+	}
+
+	return 0;
+}
+
+/** qsort() comparator for groups. */
+static int summary_cmp(const void *a, const void *b) {
+	const struct summary_group *lhs = *(const struct summary_group *const *)a;
+	const struct summary_group *rhs = *(const struct summary_group *const *)b;
+
+	if (lhs->bucket != rhs->bucket) {
+		return lhs->bucket < rhs->bucket ? -1 : 1;
+	}
+
+	return strcmp(lhs->key, rhs->key);
+}
+
+int bfs_summary_print(const struct bfs_summary *summary, CFILE *cfile) {
+	size_t ngroups = summary->ngroups;
+	if (ngroups == 0) {
+		return 0;
+	}
+
+	struct summary_group **groups = ALLOC_ARRAY(struct summary_group *, ngroups);
+	if (!groups) {
+		return -1;
+	}
+
+	size_t i = 0;
+	for_trie (leaf, &summary->trie) {
+		groups[i++] = leaf->value;
+	}
+	qsort(groups, ngroups, sizeof(*groups), summary_cmp);
+
+	int ret = 0;
+	for (i = 0; i < ngroups; ++i) {
+		const struct summary_group *group = groups[i];
+		uintmax_t blocks = (group->blocks * BFS_STAT_BLKSIZE + 511) / 512;
+		const char *key = group->key[0] ? group->key : "(none)";
+
+		if (fprintf(cfile->file, "%ju\t%ju\t%ju\t%jd\t%jd\t",
+		            group->count, group->size, blocks,
+		            (intmax_t)group->min_mtime.tv_sec,
+		            (intmax_t)group->max_mtime.tv_sec) < 0) {
+			ret = -1;
+			break;
+		}
+
+		if (summary->key == SUMMARY_PREFIX && group->key[0]) {
+			ret = cfputpath(cfile, key);
+		} else if (cfile->colors) {
+			ret = cfprintf(cfile, "%pQ\n", key);
+		} else {
+			ret = cfprintf(cfile, "%s\n", key);
+		}
+		if (ret != 0) {
+			ret = -1;
+			break;
+		}
+	}
+
+	free(groups);
+	return ret;
+}
+
+void bfs_summary_free(struct bfs_summary *summary) {
+	if (!summary) {
+		return;
+	}
+
+	dstrfree(summary->buf);
+	arena_destroy(&summary->totals);
+	trie_destroy(&summary->trie);
+	free(summary);
+}
@@ -0,0 +1,76 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+/**
+ * Implementation of -summarize.
+ *
+ * Files are grouped by a key, and each group gets a line of output once the
+ * traversal is complete:
+ *
+ *     COUNT  SIZE  BLOCKS  MIN_MTIME  MAX_MTIME  KEY
+ *
+ * separated by tabs, where BLOCKS is in 512-byte units and the times are in
+ * seconds since the epoch.
+ */
+
+#ifndef BFS_SUMMARY_H
+#define BFS_SUMMARY_H
+
+#include "color.h"
+
+struct BFTW;
+struct bfs_ctx;
+struct bfs_expr;
+struct bfs_stat;
+
+/**
+ * The running totals for -summarize.
+ */
+struct bfs_summary;
+
+/**
+ * Parse a -summarize key.
+ *
+ * @ctx
+ *         The bfs context.
+ * @expr
+ *         The expression to fill in.
+ * @key
+ *         The key to group by.
+ * @return
+ *         0 on success, -1 on failure.
+ */
+int bfs_summary_parse(const struct bfs_ctx *ctx, struct bfs_expr *expr, const char *key);
+
+/**
+ * Add a file to the summary.
+ *
+ * @summary
+ *         The summary to update.
+ * @ftwbuf
+ *         The bftw() data for the current file.
+ * @statbuf
+ *         The stat() buffer for the current file.
+ * @return
+ *         0 on success, -1 on failure.
+ */
+int bfs_summary_add(struct bfs_summary *summary, const struct BFTW *ftwbuf, const struct bfs_stat *statbuf);
+
+/**
+ * Print the summary.
+ *
+ * @summary
+ *         The summary to print.
+ * @cfile
+ *         The stream to print to.
+ * @return
+ *         0 on success, -1 on failure.
+ */
+int bfs_summary_print(const struct bfs_summary *summary, CFILE *cfile);
+
+/**
+ * Free a summary.
+ */
+void bfs_summary_free(struct bfs_summary *summary);
+
+#endif // BFS_SUMMARY_H
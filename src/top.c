@@ -0,0 +1,314 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+#include "top.h"
+
+#include "alloc.h"
+#include "bfs.h"
+#include "bftw.h"
+#include "color.h"
+#include "ctx.h"
+#include "diag.h"
+#include "expr.h"
+#include "stat.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * The keys that -top can order by.
+ */
+enum top_key {
+	/** The file size, in bytes. */
+	TOP_SIZE,
+	/** The disk usage, in 512-byte blocks. */
+	TOP_BLOCKS,
+	/** A timestamp. */
+	TOP_TIME,
+	/** The depth in the directory tree. */
+	TOP_DEPTH,
+};
+
+/**
+ * A value to order by.
+ */
+struct top_value {
+	/** The integer value, or the seconds for timestamps. */
+	intmax_t n;
+	/** The nanoseconds for timestamps, or 0. */
+	long nsec;
+};
+
+/**
+ * A candidate file.
+ */
+struct top_entry {
+	/** The value of the key for this file. */
+	struct top_value value;
+	/** The length of the path. */
+	size_t len;
+	/** The path itself. */
+	char path[];
+};
+
+struct bfs_top {
+	/** The key to order by. */
+	enum top_key key;
+	/** The timestamp to use for TOP_TIME. */
+	enum bfs_stat_field field;
+	/** Whether we want the smallest values instead of the largest. */
+	bool reverse;
+
+	/** The heap of candidates, with the worst one at the root. */
+	struct top_entry **heap;
+	/** The number of candidates. */
+	size_t size;
+	/** The maximum number of candidates to keep. */
+	size_t capacity;
+	/** Interns the candidate paths. */
+	struct varena entries;
+};
+
+int bfs_top_parse(const struct bfs_ctx *ctx, struct bfs_expr *expr, long long count, const char *key) {
+	struct bfs_top *top = ZALLOC(struct bfs_top);
+	if (!top) {
+		bfs_perror(ctx, "zalloc()");
+		return -1;
+	}
+
+	VARENA_INIT(&top->entries, struct top_entry, path);
+	expr->top = top;
+
+	if (strcmp(key, "size") == 0) {
+		top->key = TOP_SIZE;
+	} else if (strcmp(key, "blocks") == 0) {
+		top->key = TOP_BLOCKS;
+	} else if (strcmp(key, "atime") == 0) {
+		top->key = TOP_TIME;
+		top->field = BFS_STAT_ATIME;
+	} else if (strcmp(key, "ctime") == 0) {
+		top->key = TOP_TIME;
+		top->field = BFS_STAT_CTIME;
+	} else if (strcmp(key, "mtime") == 0) {
+		top->key = TOP_TIME;
+		top->field = BFS_STAT_MTIME;
+	} else if (strcmp(key, "depth") == 0) {
+		top->key = TOP_DEPTH;
+	} else {
+		bfs_expr_error(ctx, expr);
+		bfs_error(ctx, "Unknown key ${bld}%pq${rs}.\n", key);
+		bfs_error(ctx, "Use one of ${bld}size${rs}, ${bld}blocks${rs}, ${bld}mtime${rs}, ${bld}atime${rs}, ${bld}ctime${rs}, or ${bld}depth${rs}.\n");
+		return -1;
+	}
+
+	unsigned long long capacity = count;
+	if (count < 0) {
+		top->reverse = true;
+		capacity = -capacity;
+	}
+
+	// The heap grows on demand, so huge limits are fine
+	top->capacity = capacity < SIZE_MAX ? capacity : SIZE_MAX;
+	return 0;
+}
+
+bool bfs_top_needs_stat(const struct bfs_top *top) {
+	return top->key != TOP_DEPTH;
+}
+
+/** Get the value of the key for a file. */
+static struct top_value top_value(const struct bfs_top *top, const struct BFTW *ftwbuf, const struct bfs_stat *statbuf) {
+	const struct timespec *ts;
+
+	switch (top->key) {
+	case TOP_SIZE:
+		return (struct top_value){ .n = statbuf->size };
+	case TOP_BLOCKS:
+		return (struct top_value){ .n = ((intmax_t)statbuf->blocks * BFS_STAT_BLKSIZE + 511) / 512 };
+	case TOP_TIME:
+		ts = bfs_stat_time(statbuf, top->field);
+		if (!ts) {
+			return (struct top_value){ .n = INTMAX_MIN };
+		}
+		return (struct top_value){ .n = ts->tv_sec, .nsec = ts->tv_nsec };
+	case TOP_DEPTH:
+		return (struct top_value){ .n = ftwbuf->depth };
+	}
+
+	bfs_bug("Unexpected top key %d", (int)top->key);
+	return (struct top_value){0};
+}
+
+/**
+ * Check if one candidate beats another.  Ties are broken by path, so the
+ * result doesn't depend on the traversal order.
+ */
+static bool top_better(const struct bfs_top *top, const struct top_value *value, const char *path, const struct top_entry *entry) {
+	const struct top_value *other = &entry->value;
+
+	int cmp;
+	if (value->n != other->n) {
+		cmp = value->n < other->n ? -1 : 1;
+	} else if (value->nsec != other->nsec) {
+		cmp = value->nsec < other->nsec ? -1 : 1;
+	} else {
+		return strcmp(path, entry->path) < 0;
+	}
+
+	return top->reverse ? cmp < 0 : cmp > 0;
+}
+
+/** Move an entry down the heap to restore the heap property. */
+static void top_sift_down(struct bfs_top *top, size_t i, size_t size) {
+	struct top_entry **heap = top->heap;
+	struct top_entry *entry = heap[i];
+
+	while (true) {
+		size_t child = 2 * i + 1;
+		if (child >= size) {
+			break;
+		}
+
+		// Pick the worse child
+		struct top_entry *worse = heap[child];
+		if (child + 1 < size && top_better(top, &worse->value, worse->path, heap[child + 1])) {
+			++child;
+			worse = heap[child];
+		}
+
+		if (!top_better(top, &entry->value, entry->path, worse)) {
+			break;
+		}
+
+		heap[i] = worse;
+		i = child;
+	}
+
+	heap[i] = entry;
+}
+
+/** Move an entry up the heap to restore the heap property. */
+static void top_sift_up(struct bfs_top *top, size_t i) {
+	struct top_entry **heap = top->heap;
+	struct top_entry *entry = heap[i];
+
+	while (i > 0) {
+		size_t parent = (i - 1) / 2;
+		if (!top_better(top, &heap[parent]->value, heap[parent]->path, entry)) {
+			break;
+		}
+
+		heap[i] = heap[parent];
+		i = parent;
+	}
+
+	heap[i] = entry;
+}
+
+/** Copy a candidate into the arena. */
+static struct top_entry *top_entry_new(struct bfs_top *top, const struct top_value *value, const char *path) {
+	size_t len = strlen(path);
+	struct top_entry *entry = varena_alloc(&top->entries, len + 1);
+	if (!entry) {
+		return NULL;
+	}
+
+	entry->value = *value;
+	entry->len = len;
+	memcpy(entry->path, path, len + 1);
+	return entry;
+}
+
+/** Free a candidate. */
+static void top_entry_free(struct bfs_top *top, struct top_entry *entry) {
+	varena_free(&top->entries, entry, entry->len + 1);
+}
+
+int bfs_top_add(struct bfs_top *top, const struct BFTW *ftwbuf, const struct bfs_stat *statbuf) {
+	struct top_value value = top_value(top, ftwbuf, statbuf);
+	const char *path = ftwbuf->path;
+
+	if (top->size < top->capacity) {
+		struct top_entry *entry = top_entry_new(top, &value, path);
+		if (!entry) {
+			return -1;
+		}
+
+		struct top_entry **slot = RESERVE(struct top_entry *, &top->heap, &top->size);
+		if (!slot) {
+			top_entry_free(top, entry);
+			return -1;
+		}
+
+		*slot = entry;
+		top_sift_up(top, top->size - 1);
+		return 0;
+	}
+
+	// The common case: not good enough to be kept, so don't copy the path
+	struct top_entry *worst = top->heap[0];
+	if (!top_better(top, &value, path, worst)) {
+		return 0;
+	}
+
+	struct top_entry *entry = top_entry_new(top, &value, path);
+	if (!entry) {
+		return -1;
+	}
+
+	top_entry_free(top, worst);
+	top->heap[0] = entry;
+	top_sift_down(top, 0, top->size);
+	return 0;
+}
+
+/** Print a single candidate. */
+static int top_print_entry(const struct bfs_top *top, const struct top_entry *entry, CFILE *cfile) {
+	const struct top_value *value = &entry->value;
+
+	int ret;
+	if (top->key == TOP_TIME) {
+		ret = fprintf(cfile->file, "%jd.%09ld\t", value->n, value->nsec);
+	} else {
+		ret = fprintf(cfile->file, "%jd\t", value->n);
+	}
+	if (ret < 0) {
+		return -1;
+	}
+
+	return cfputpath(cfile, entry->path);
+}
+
+int bfs_top_print(struct bfs_top *top, CFILE *cfile) {
+	// Heapsort in place: repeatedly moving the worst candidate to the end
+	// leaves the best one at the front
+	struct top_entry **heap = top->heap;
+	for (size_t i = top->size; i-- > 1;) {
+		struct top_entry *worst = heap[0];
+		heap[0] = heap[i];
+		heap[i] = worst;
+		top_sift_down(top, 0, i);
+	}
+
+	for (size_t i = 0; i < top->size; ++i) {
+		if (top_print_entry(top, heap[i], cfile) != 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+void bfs_top_free(struct bfs_top *top) {
+	if (!top) {
+		return;
+	}
+
+	varena_destroy(&top->entries);
+	free(top->heap);
+	free(top);
+}
@@ -0,0 +1,80 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+/**
+ * Implementation of -top.
+ *
+ * Only the best N candidates seen so far are kept, in a bounded heap, so the
+ * memory use is O(N) rather than O(files).
+ */
+
+#ifndef BFS_TOP_H
+#define BFS_TOP_H
+
+#include "color.h"
+
+struct BFTW;
+struct bfs_ctx;
+struct bfs_expr;
+struct bfs_stat;
+
+/**
+ * The candidates for -top.
+ */
+struct bfs_top;
+
+/**
+ * Parse a -top key.
+ *
+ * @ctx
+ *         The bfs context.
+ * @expr
+ *         The expression to fill in.
+ * @count
+ *         The number of files to keep.  If negative, the smallest -count
+ *         files are kept instead of the largest.
+ * @key
+ *         The key to order by.
+ * @return
+ *         0 on success, -1 on failure.
+ */
+int bfs_top_parse(const struct bfs_ctx *ctx, struct bfs_expr *expr, long long count, const char *key);
+
+/**
+ * Consider a file for the top N.
+ *
+ * @top
+ *         The -top state.
+ * @ftwbuf
+ *         The bftw() data for the current file.
+ * @statbuf
+ *         The stat() buffer for the current file, or NULL if the key doesn't
+ *         need one.
+ * @return
+ *         0 on success, -1 on failure.
+ */
+int bfs_top_add(struct bfs_top *top, const struct BFTW *ftwbuf, const struct bfs_stat *statbuf);
+
+/**
+ * Check whether a key needs a stat() buffer.
+ */
+bool bfs_top_needs_stat(const struct bfs_top *top);
+
+/**
+ * Print the top N files, best first.
+ *
+ * @top
+ *         The -top state.  The candidates are consumed.
+ * @cfile
+ *         The stream to print to.
+ * @return
+ *         0 on success, -1 on failure.
+ */
+int bfs_top_print(struct bfs_top *top, CFILE *cfile);
+
+/**
+ * Free the -top state.
+ */
+void bfs_top_free(struct bfs_top *top);
+
+#endif // BFS_TOP_H
@@ -27,6 +27,29 @@
 #  include <spawn.h>
 #endif
 
+#if BFS_HAS_CLONE
+#  include <sched.h>
+#endif
+
+/**
+ * Whether to use clone() rather than fork() when posix_spawn() won't do.
+ *
+ * The child runs on a borrowed stack, so this is disabled where the stack grows
+ * up (HP PA-RISC), and under sanitizers that don't expect another process to
+ * share their memory.
+ */
+#ifndef BFS_USE_CLONE
+#  if BFS_HAS_CLONE \
+	&& !__hppa__ \
+	&& !__SANITIZE_ADDRESS__ \
+	&& !__SANITIZE_MEMORY__ \
+	&& !__SANITIZE_THREAD__
+#    define BFS_USE_CLONE true
+#  else
+#    define BFS_USE_CLONE false
+#  endif
+#endif
+
 /**
  * Types of spawn actions.
  */
@@ -585,89 +608,103 @@ static bool bfs_use_posix_spawn(const struct bfs_resolver *res, const struct bfs
 
 #endif // BFS_POSIX_SPAWN >= 0
 
-/** Actually exec() the new process. */
-[[_noreturn]]
-static void bfs_spawn_exec(struct bfs_resolver *res, const struct bfs_spawn *ctx, char **argv, char **envp, const sigset_t *mask, int pipefd[2]) {
-	xclose(pipefd[0]);
-
+/**
+ * Actually exec() the new process, from the child.
+ *
+ * @errfd
+ *         The error-reporting pipe to keep out of the way of the file actions,
+ *         or -1 if there is none.
+ * @return
+ *         -1 with errno set, if anything goes wrong.
+ */
+static int bfs_spawn_exec(struct bfs_resolver *res, const struct bfs_spawn *ctx, char **argv, char **envp, const sigset_t *mask, int *errfd) {
 	for_slist (const struct bfs_spawn_action, action, ctx) {
 		int fd;
 
-		// Move the error-reporting pipe out of the way if necessary...
-		if (action->out_fd == pipefd[1]) {
-			fd = dup_cloexec(pipefd[1]);
-			if (fd < 0) {
-				goto fail;
+		if (*errfd >= 0) {
+			// Move the error-reporting pipe out of the way if necessary...
+			if (action->out_fd == *errfd) {
+				fd = dup_cloexec(*errfd);
+				if (fd < 0) {
+					return -1;
+				}
+				xclose(*errfd);
+				*errfd = fd;
 			}
-			xclose(pipefd[1]);
-			pipefd[1] = fd;
-		}
 
-		// ... and pretend the pipe doesn't exist
-		if (action->in_fd == pipefd[1]) {
-			errno = EBADF;
-			goto fail;
+			// ... and pretend the pipe doesn't exist
+			if (action->in_fd == *errfd) {
+				errno = EBADF;
+				return -1;
+			}
 		}
 
 		switch (action->op) {
 		case BFS_SPAWN_OPEN:
 			fd = open(action->path, action->flags, action->mode);
 			if (fd < 0) {
-				goto fail;
+				return -1;
 			}
 			if (fd != action->out_fd) {
 				if (dup2(fd, action->out_fd) < 0) {
-					goto fail;
+					return -1;
 				}
 			}
 			break;
 		case BFS_SPAWN_CLOSE:
 			if (close(action->out_fd) != 0) {
-				goto fail;
+				return -1;
 			}
 			break;
 		case BFS_SPAWN_DUP2:
 			if (dup2(action->in_fd, action->out_fd) < 0) {
-				goto fail;
+				return -1;
 			}
 			break;
 		case BFS_SPAWN_FCHDIR:
 #if BFS_HAS_FCHDIR
 			if (fchdir(action->in_fd) != 0) {
-				goto fail;
+				return -1;
 			}
 			break;
 #else
 			errno = ENOTSUP;
-			goto fail;
+			return -1;
 #endif
 		case BFS_SPAWN_SETRLIMIT:
 			if (setrlimit(action->resource, &action->rlimit) != 0) {
-				goto fail;
+				return -1;
 			}
 			break;
 		}
 	}
 
 	if (bfs_resolve_late(res) != 0) {
-		goto fail;
+		return -1;
 	}
 
 	// Reset signal handlers to their original values before we unblock
 	// signals, so that handlers don't run in both the parent and the child
 	if (sigreset() != 0) {
-		goto fail;
+		return -1;
 	}
 
 	// Restore the original signal mask for the child process
 	errno = pthread_sigmask(SIG_SETMASK, mask, NULL);
 	if (errno != 0) {
-		goto fail;
+		return -1;
 	}
 
 	execve(res->exe, argv, envp);
+	return -1;
+}
 
-fail:;
+/** The child half of bfs_fork_spawn(). */
+[[_noreturn]]
+static void bfs_fork_child(struct bfs_resolver *res, const struct bfs_spawn *ctx, char **argv, char **envp, const sigset_t *mask, int pipefd[2]) {
+	xclose(pipefd[0]);
+
+	bfs_spawn_exec(res, ctx, argv, envp, mask, &pipefd[1]);
 	int error = errno;
 
 	// In case of a write error, the parent will still see that we exited
@@ -679,6 +716,7 @@ fail:;
 }
 
 /** bfs_spawn() implementation using fork()/exec(). */
+[[_maybe_unused]]
 static pid_t bfs_fork_spawn(struct bfs_resolver *res, const struct bfs_spawn *ctx, char **argv, char **envp) {
 	// Use a pipe to report errors from the child
 	int pipefd[2];
@@ -704,7 +742,7 @@ static pid_t bfs_fork_spawn(struct bfs_resolver *res, const struct bfs_spawn *ct
 #endif
 	if (pid == 0) {
 		// Child
-		bfs_spawn_exec(res, ctx, argv, envp, &old_mask, pipefd);
+		bfs_fork_child(res, ctx, argv, envp, &old_mask, pipefd);
 	}
 
 	// Restore the original signal mask
@@ -735,6 +773,86 @@ fail:
 	return -1;
 }
 
+#if BFS_USE_CLONE
+
+/** Arguments for bfs_clone_child(). */
+struct bfs_clone_args {
+	struct bfs_resolver *res;
+	const struct bfs_spawn *ctx;
+	char **argv;
+	char **envp;
+	const sigset_t *mask;
+	/** The child's errno, if it fails to exec(). */
+	int error;
+};
+
+/** The child half of bfs_clone_spawn(). */
+static int bfs_clone_child(void *ptr) {
+	struct bfs_clone_args *args = ptr;
+
+	int errfd = -1;
+	bfs_spawn_exec(args->res, args->ctx, args->argv, args->envp, args->mask, &errfd);
+
+	// We share memory with the parent, which is suspended until we exit
+	args->error = errno;
+	_Exit(127);
+}
+
+/** The stack size for bfs_clone_child(). */
+#define BFS_CLONE_STACK (16 << 10)
+
+/**
+ * bfs_spawn() implementation using clone(CLONE_VM | CLONE_VFORK).  Unlike
+ * fork(), this doesn't have to copy the page tables, which gets expensive for
+ * large processes.  It's what posix_spawn() does internally, but we can also
+ * handle file actions that it doesn't support, like setrlimit().
+ */
+static pid_t bfs_clone_spawn(struct bfs_resolver *res, const struct bfs_spawn *ctx, char **argv, char **envp) {
+	// Block signals so handlers don't run in the child, which shares our memory
+	sigset_t new_mask;
+	if (sigfillset(&new_mask) != 0) {
+		return -1;
+	}
+	sigset_t old_mask;
+	errno = pthread_sigmask(SIG_BLOCK, &new_mask, &old_mask);
+	if (errno != 0) {
+		return -1;
+	}
+
+	struct bfs_clone_args args = {
+		.res = res,
+		.ctx = ctx,
+		.argv = argv,
+		.envp = envp,
+		.mask = &old_mask,
+	};
+
+	// We're suspended until the child exec()s or exits, so it can borrow
+	// some of our stack
+	alignas(max_align_t) char stack[BFS_CLONE_STACK];
+	pid_t pid = clone(bfs_clone_child, stack + sizeof(stack), CLONE_VM | CLONE_VFORK | SIGCHLD, &args);
+	int error = errno;
+
+	// Restore the original signal mask
+	errno = pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+	bfs_everify(errno == 0, "pthread_sigmask()");
+
+	if (pid < 0) {
+		errno = error;
+		return -1;
+	}
+
+	if (args.error != 0) {
+		xwaitpid(pid, NULL, 0);
+		errno = args.error;
+		return -1;
+	}
+
+	return pid;
+}
+
+#endif // BFS_USE_CLONE
+
 /** Call the right bfs_spawn() implementation. */
 static pid_t bfs_spawn_impl(struct bfs_resolver *res, const struct bfs_spawn *ctx, char **argv, char **envp) {
 #if BFS_POSIX_SPAWN >= 0
@@ -743,7 +861,11 @@ static pid_t bfs_spawn_impl(struct bfs_resolver *res, const struct bfs_spawn *ct
 	}
 #endif
 
+#if BFS_USE_CLONE
+	return bfs_clone_spawn(res, ctx, argv, envp);
+#else
 	return bfs_fork_spawn(res, ctx, argv, envp);
+#endif
 }
 
 pid_t bfs_spawn(const char *exe, const struct bfs_spawn *ctx, char **argv, char **envp) {
@@ -38,6 +38,61 @@ int xmktime(struct tm *tm, time_t *timep) {
 	return 0;
 }
 
+/** A cached localtime_r() result. */
+struct localtime_cache {
+	/** Whether the cache is filled. */
+	bool valid;
+	/** The time that was converted. */
+	time_t time;
+	/** The broken-down local time. */
+	struct tm tm;
+	/** The tzset() time zone names at the time. */
+	const char *tzname[2];
+	/** The tzset() UTC offset at the time. */
+	long timezone;
+};
+
+/**
+ * Check whether the time zone is the same as when the cache was filled.  A new
+ * time zone only takes effect through tzset() (explicitly, or implicitly from
+ * localtime() etc.), which updates these globals, so this avoids looking up TZ
+ * on every call.
+ */
+static bool localtime_cache_tz(const struct localtime_cache *cache) {
+	return cache->tzname[0] == tzname[0]
+		&& cache->tzname[1] == tzname[1]
+		&& cache->timezone == timezone;
+}
+
+struct tm *xlocaltime(const time_t *timep, struct tm *result) {
+	static thread_local struct localtime_cache cache;
+
+	time_t time = *timep;
+	if (cache.valid && time >= cache.time - 60 && time <= cache.time + 60 && localtime_cache_tz(&cache)) {
+		// UTC offsets only change at the start of a local minute, so
+		// another time in the same minute differs only in tm_sec.  This
+		// also handles leap seconds, where tm_sec can be 60.
+		int sec = cache.tm.tm_sec + (int)(time - cache.time);
+		if (sec >= 0 && sec < 60 && cache.tm.tm_sec < 60) {
+			*result = cache.tm;
+			result->tm_sec = sec;
+			return result;
+		}
+	}
+
+	if (!localtime_r(timep, result)) {
+		return NULL;
+	}
+
+	cache.valid = true;
+	cache.time = time;
+	cache.tm = *result;
+	cache.tzname[0] = tzname[0];
+	cache.tzname[1] = tzname[1];
+	cache.timezone = timezone;
+	return result;
+}
+
 // FreeBSD is missing an interceptor
 #if BFS_HAS_TIMEGM && !(__FreeBSD__ && __SANITIZE_MEMORY__)
 
@@ -22,6 +22,20 @@
  */
 int xmktime(struct tm *tm, time_t *timep);
 
+/**
+ * localtime_r() with a per-thread cache.  Converting many times from the same
+ * minute only does the expensive time zone lookup once.  The cache is dropped
+ * when tzset() changes the time zone.
+ *
+ * @timep
+ *         The time to convert.
+ * @result[out]
+ *         The broken-down local time.
+ * @return
+ *         The result on success, or NULL on failure.
+ */
+struct tm *xlocaltime(const time_t *timep, struct tm *result);
+
 /**
  * A portable timegm(), the inverse of gmtime().
  *
@@ -0,0 +1,2 @@
+# -O4 prunes directories that can't contain any -path matches
+bfs_diff -O4 basic inaccessible -path 'basic/l/*'
@@ -0,0 +1,10 @@
+# Matches that span two reads
+cd "$TEST"
+printf '%65535s' "" >split
+printf 'needle' >>split
+printf '%65536s' "" >after
+printf 'needle' >>after
+printf '%65536s' "" >none
+printf 'needl' >>none
+
+bfs_diff . -contains needle
@@ -0,0 +1,9 @@
+# -delete is asynchronous when its result is ignored, but errors still count
+cd "$TEST"
+
+"$XTOUCH" -p foo/bar baz/qux
+chmod -w foo
+defer chmod +w foo
+
+! invoke_bfs . -delete || fail
+bfs_diff .
@@ -0,0 +1,8 @@
+# Compare the directory totals to du -k
+cd "$TEST"
+mkdir -p foo/bar baz
+printf '%8192s' "" >foo/bar/file
+printf '%100s' "" >baz/file
+
+invoke_bfs . -type d -du | sort >"$OUT"
+du -k . | sort | diff -u - "$OUT" >&2
@@ -0,0 +1,7 @@
+# -O4 shouldn't prune the subtrees that -du needs to add up
+cd "$TEST"
+mkdir -p foo/bar
+printf '%8192s' "" >foo/bar/file
+
+[ "$(invoke_bfs -O4 . -depth 0 -du)" = "$(du -sk .)" ]
+[ "$(invoke_bfs -O4 . -depth 1 -du)" = "$(invoke_bfs -O1 . -depth 1 -du)" ]
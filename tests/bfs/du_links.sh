@@ -0,0 +1,7 @@
+# Hard links should only be counted once
+cd "$TEST"
+mkdir foo bar
+printf '%8192s' "" >foo/file
+ln foo/file bar/link
+
+[ "$(invoke_bfs . -depth 0 -du)" = "$(du -sk .)" ]
@@ -0,0 +1,12 @@
+cd "$TEST"
+mkdir foo bar
+printf 'hello' >foo/a
+printf 'hello' >bar/a
+printf 'hellp' >bar/b
+printf 'goodbye' >foo/c
+printf 'goodbye' >bar/c
+printf 'goodbye' >c
+touch empty1 empty2
+
+invoke_bfs . -duplicates >"$OUT"
+diff_output
@@ -0,0 +1,8 @@
+# Symbolic links to the same file aren't duplicates of each other
+cd "$TEST"
+printf 'hello' >a
+ln -s a b
+printf 'hello' >c
+
+invoke_bfs -L . -duplicates | wc -l | tr -d ' ' >"$OUT"
+diff_output
@@ -0,0 +1,11 @@
+# Same size and same first block, different contents
+cd "$TEST"
+for i in 1 2 3; do
+    printf '%8192s' "" >"file$i"
+done
+printf 'x' >>file1
+printf 'x' >>file2
+printf 'y' >>file3
+
+invoke_bfs . -duplicates >"$OUT"
+diff_output
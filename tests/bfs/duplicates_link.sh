@@ -0,0 +1,8 @@
+# Hard links aren't duplicates of each other
+cd "$TEST"
+printf 'hello' >a
+ln a b
+printf 'hello' >c
+
+invoke_bfs . -duplicates | wc -l | tr -d ' ' >"$OUT"
+diff_output
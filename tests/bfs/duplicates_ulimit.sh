@@ -0,0 +1,10 @@
+# Reading the candidates in parallel shouldn't run out of file descriptors
+cd "$TEST"
+i=0
+while [ $i -lt 64 ]; do
+    printf '%8192s' "" >"file$i"
+    i=$((i + 1))
+done
+
+ulimit -n $((NOPENFD + 13))
+[ "$(invoke_bfs -j4 . -duplicates | wc -l)" -eq 64 ]
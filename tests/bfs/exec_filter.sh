@@ -0,0 +1 @@
+bfs_diff basic -exec-filter bash -c 'while IFS= read -rd "" f; do test -s "$f"; echo $?; done' bash \; -print
@@ -0,0 +1,2 @@
+# A filter that buffers its output should time out, not hang
+! invoke_bfs basic -exec-filter-timeout 1 -exec-filter tr '\0' '\n' \;
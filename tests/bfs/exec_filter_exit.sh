@@ -0,0 +1,2 @@
+# A filter that exits without answering is an error
+! invoke_bfs basic -exec-filter true \;
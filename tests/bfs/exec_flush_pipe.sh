@@ -0,0 +1,6 @@
+# Output to a pipe (which may be written asynchronously) must be flushed
+# before each -exec
+invoke_bfs basic -print -exec echo {} \; | uniq -c >"$TEST/counts"
+
+# Every path should be printed twice in a row
+! grep -v '^ *2 ' "$TEST/counts" || fail
@@ -0,0 +1 @@
+bfs_diff basic -exec-jobs 4 -exec "$TESTS/sort-args.sh" {} +
@@ -0,0 +1 @@
+bfs_diff basic -exec-jobs 2000000000 -exec "$TESTS/sort-args.sh" {} +
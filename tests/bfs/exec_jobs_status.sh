@@ -0,0 +1,2 @@
+# Failures should be reported even if the batch was still running
+! bfs_diff basic -exec-jobs 4 -execdir sh -c 'sleep 0.1; false' sh {} + -print
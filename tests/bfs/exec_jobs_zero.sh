@@ -0,0 +1 @@
+! invoke_bfs basic -exec-jobs 0 -exec echo {} +
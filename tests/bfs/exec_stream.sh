@@ -0,0 +1 @@
+bfs_diff basic -exec-stream tr '\0' '\n' \;
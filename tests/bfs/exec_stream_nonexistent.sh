@@ -0,0 +1,2 @@
+invoke_bfs basic -exec-stream "$TESTS/nonexistent" \; 2>"$TEST/err" && fail
+test -s "$TEST/err"
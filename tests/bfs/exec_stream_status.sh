@@ -0,0 +1,2 @@
+# The command's exit status should be reported after it reads everything
+! invoke_bfs basic -exec-stream sh -c 'cat >/dev/null; false' sh \;
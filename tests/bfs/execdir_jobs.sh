@@ -0,0 +1,2 @@
+# Each directory gets its own batch, so these can run concurrently
+bfs_diff basic -exec-jobs 4 -execdir printf '%s\n' {} +
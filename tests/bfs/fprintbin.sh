@@ -0,0 +1,9 @@
+# Decode the records and compare them to the same fields from -fprintf
+invoke_bfs basic links rainbow weirdnames -fprintbin "$TEST/out.bin" \
+    \( -type l -fprintf "$TEST/out.txt" '%p type=%y depth=%d dev=%D ino=%i mode=%m nlink=%n uid=%U gid=%G size=%s blocks=%b atime=%A@ ctime=%C@ mtime=%T@ target=%l\n' \) \
+    -o -fprintf "$TEST/out.txt" '%p type=%y depth=%d dev=%D ino=%i mode=%m nlink=%n uid=%U gid=%G size=%s blocks=%b atime=%A@ ctime=%C@ mtime=%T@\n'
+
+# btime isn't always available, and %T@ has an extra trailing zero
+"$READBIN" "$TEST/out.bin" | sed 's/ btime=[^ ]*//' >"$TEST/decoded.txt"
+sed 's/\(time=[0-9]*\.[0-9]\{9\}\)0/\1/g' "$TEST/out.txt" >"$TEST/expected.txt"
+diff -u "$TEST/expected.txt" "$TEST/decoded.txt" >&2
@@ -0,0 +1,2 @@
+# Delta-encoded streams can't share a file
+! invoke_bfs basic -fprintbin "$TEST/out.bin" -fprintbin "$TEST/out.bin"
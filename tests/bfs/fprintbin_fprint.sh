@@ -0,0 +1,3 @@
+# Nothing else can write to a -fprintbin file, in either order
+! invoke_bfs basic -fprintbin "$TEST/out" -fprint "$TEST/out" || fail
+! invoke_bfs basic -fprint "$TEST/out" -fprintbin "$TEST/out"
@@ -0,0 +1,2 @@
+# -fprintbin /dev/stdout can't be mixed with -print
+! invoke_bfs basic -fprintbin /dev/stdout -print
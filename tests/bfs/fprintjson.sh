@@ -0,0 +1,4 @@
+invoke_bfs links -type l -fprintjson "$TEST/json"
+sed 's/,"depth".*,"target"/,"target"/' "$TEST/json" >"$OUT"
+sort_output
+diff_output
@@ -0,0 +1,6 @@
+# Files that span several read buffers, with a partial one at the end
+cd "$TEST"
+seq 1 40000 >odd
+seq 2 2 100000 >even
+
+bfs_diff . -j4 -type f -hash sha256
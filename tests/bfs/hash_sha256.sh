@@ -0,0 +1,8 @@
+cd "$TEST"
+mkdir foo
+touch empty
+printf 'abc' >foo/abc
+printf '%100s' "" >spaces
+ln -s foo/abc link
+
+bfs_diff . -hash sha256
@@ -0,0 +1,8 @@
+cd "$TEST"
+mkdir foo
+printf 'hello world' >foo/a
+printf 'HELLO' >foo/b
+printf 'goodbye' >c
+ln -s foo/a link
+
+bfs_diff . -icontains hello
@@ -0,0 +1,7 @@
+cd "$TEST"
+mkdir -p node_modules/foo src/build keep logs
+"$XTOUCH" node_modules/foo/bar src/main.c src/main.o src/build/out keep/a.o logs/a.log logs/keep.log
+printf '%s\n' 'node_modules/' '*.o' '!keep/*.o' '/logs/*' '!/logs/keep.log' >.gitignore
+printf '%s\n' 'build' >src/.gitignore
+
+bfs_diff . -ignore-vcs
@@ -0,0 +1,7 @@
+cd "$TEST"
+mkdir -p foo/bar
+"$XTOUCH" foo/a.log foo/b.log foo/bar/c.log
+printf '%s\n' '*.log' >.gitignore
+printf '%s\n' '!b.log' >foo/.ignore
+
+bfs_diff . -ignore-vcs
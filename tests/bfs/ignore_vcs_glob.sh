@@ -0,0 +1,6 @@
+cd "$TEST"
+mkdir -p a/b/c a/x/c b/c
+"$XTOUCH" a/b/c/file a/x/c/file b/c/file a/file.tmp b/file.tmp1 'a/[x]'
+printf '%s\n' 'a/**/c/' '*.tmp' '\[x]' >.gitignore
+
+bfs_diff . -ignore-vcs
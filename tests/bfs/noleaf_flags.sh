@@ -0,0 +1,3 @@
+# -noleaf turns off the directory link count optimization
+invoke_bfs -D search basic -quit 2>&1 >/dev/null | grep BFTW_NLINK >/dev/null
+! invoke_bfs -D search basic -noleaf -quit 2>&1 >/dev/null | grep BFTW_NLINK >/dev/null
@@ -0,0 +1,7 @@
+# Skipping stat() on leaves shouldn't change any file types
+invoke_bfs basic rainbow -noleaf -printf '%p %y %Y\n' | sort >"$OUT"
+invoke_bfs basic rainbow -printf '%p %y %Y\n' | sort | diff -u "$OUT" - >&2 || fail
+
+# Even if readdir() doesn't tell us the types
+invoke_bfs -D dtype basic rainbow -printf '%p %y %Y\n' | sort | diff -u "$OUT" - >&2 || fail
+invoke_bfs -D dtype basic rainbow -j4 -printf '%p %y %Y\n' | sort | diff -u "$OUT" - >&2
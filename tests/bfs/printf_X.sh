@@ -0,0 +1,6 @@
+cd "$TEST"
+mkdir foo
+printf 'abc' >foo/abc
+ln -s foo/abc link
+
+bfs_diff . -printf '%X %p\n'
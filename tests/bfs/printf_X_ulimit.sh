@@ -0,0 +1,2 @@
+ulimit -n $((NOPENFD + 13))
+[ "$(invoke_bfs deep -type f -printf '%X\n' | uniq)" = "$(sha256sum </dev/null | cut -d' ' -f1)" ]
@@ -0,0 +1,10 @@
+cd "$TEST"
+
+# Quotes, backslashes, control characters, and valid and invalid UTF-8, both
+# inside and after the first 8 bytes (which are scanned a word at a time)
+touch 'quote"' 'back\slash' "$(printf 'ctl\001\t\r\037')" "$(printf 'utf8-\303\251\342\202\254\360\237\230\200')"
+touch "$(printf 'invalid-\377')" "$(printf 'truncated-\342\202')" "$(printf 'overlong-\300\257')" "$(printf 'surrogate-\355\240\200')"
+
+invoke_bfs . -mindepth 1 -printjson | sed 's/,"type".*}$/}/' >"$OUT"
+sort_output
+diff_output
@@ -0,0 +1,6 @@
+cd "$TEST"
+mkdir -p a/b/c cache/x keep/n nb/y
+"$XTOUCH" a/b/c/f cache/CACHEDIR.TAG cache/x/y keep/n/f nb/.nobackup nb/y/z
+mkdir a/b/.nobackup
+
+bfs_diff . -prune-if-contains CACHEDIR.TAG -prune-if-contains .nobackup
@@ -0,0 +1 @@
+! invoke_bfs basic -prune-if-contains a/b
@@ -0,0 +1,3 @@
+# Sorted paths are colored like -print
+invoke_bfs rainbow -color -sort-by path >"$OUT"
+diff_output
@@ -0,0 +1,2 @@
+invoke_bfs basic -sort-by path >"$OUT"
+diff_output
@@ -0,0 +1,9 @@
+cd "$TEST"
+mkdir foo
+printf '%4s' "" >foo/a.txt
+printf '%2s' "" >b.txt
+printf '%8s' "" >c.tar.gz
+touch .hidden README
+
+invoke_bfs . -type f -summarize ext | cut -f1,2,6 >"$OUT"
+diff_output
@@ -0,0 +1,5 @@
+cd "$TEST"
+"$XTOUCH" -p foo/bar/baz foo/qux bar/baz qux
+
+invoke_bfs . -type f -summarize prefix:2 | cut -f1,6 >"$OUT"
+diff_output
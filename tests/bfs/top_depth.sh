@@ -0,0 +1,2 @@
+invoke_bfs basic -top 4 depth >"$OUT"
+diff_output
@@ -0,0 +1,7 @@
+cd "$TEST"
+for i in 3 1 4 1 5 9 2 6; do
+    printf "%${i}s" "" >"file$i"
+done
+
+invoke_bfs . -type f -top -3 size >"$OUT"
+diff_output
@@ -0,0 +1,19 @@
+# -readable, -writable, and -executable should agree with test(1), whether
+# or not they're answered from the permission bits
+for flag in r w x; do
+    case "$flag" in
+        r) pred=-readable ;;
+        w) pred=-writable ;;
+        x) pred=-executable ;;
+    esac
+
+    invoke_bfs perms links -exec test -"$flag" {} \; -print >"$TEST/test" || fail
+    sort -o "$TEST/test" "$TEST/test"
+
+    for hook in "" -Daccess; do
+        # -links forces a stat(), so the permission bits are available
+        invoke_bfs $hook perms links -links +0 "$pred" >"$TEST/bfs" || fail
+        sort -o "$TEST/bfs" "$TEST/bfs"
+        diff -u "$TEST/test" "$TEST/bfs" || fail
+    done
+done
@@ -0,0 +1,86 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+#include "tests.h"
+
+#include "diag.h"
+#include "idset.h"
+
+#include <stddef.h>
+
+void check_idset(void) {
+	struct idset set;
+	idset_init(&set);
+
+	bfs_check(!idset_contains(&set, 0, 0));
+	bfs_check(!idset_contains(&set, 1, 1));
+	bfs_check(idset_memory(&set) == 0);
+
+	// Enough entries to force a few resizes
+	const size_t n = 10000;
+	for (size_t i = 0; i < n; ++i) {
+		dev_t dev = i % 3;
+		ino_t ino = i / 3;
+		bfs_check(!idset_contains(&set, dev, ino));
+		bfs_echeck(idset_insert(&set, dev, ino) == 1);
+		bfs_check(idset_contains(&set, dev, ino));
+	}
+	bfs_check(set.size == n);
+
+	for (size_t i = 0; i < n; ++i) {
+		dev_t dev = i % 3;
+		ino_t ino = i / 3;
+		bfs_check(idset_contains(&set, dev, ino));
+		bfs_echeck(idset_insert(&set, dev, ino) == 0);
+	}
+	bfs_check(set.size == n);
+
+	bfs_check(!idset_contains(&set, 3, 0));
+	bfs_check(!idset_contains(&set, 0, n));
+	bfs_check(idset_memory(&set) >= n * sizeof(struct bfs_id));
+
+	idset_destroy(&set);
+}
+
+void check_idmap(void) {
+	struct idmap map;
+	idmap_init(&map);
+
+	bfs_check(!idmap_get(&map, 0, 0));
+
+	// Enough entries to force a few resizes, with two references each
+	const size_t n = 10000;
+	for (size_t i = 0; i < n; ++i) {
+		dev_t dev = i % 3;
+		ino_t ino = i / 3;
+		struct idmap_entry *entry = idmap_ref(&map, dev, ino);
+		bfs_everify(entry, "idmap_ref()");
+		bfs_check(entry->refs == 1 && !entry->ptr);
+		entry->ptr = &map;
+		bfs_check(idmap_ref(&map, dev, ino) == entry);
+		bfs_check(entry->refs == 2);
+	}
+	bfs_check(map.size == n);
+
+	// Drop every other entry, shifting its neighbors back
+	for (size_t i = 0; i < n; i += 2) {
+		idmap_unref(&map, i % 3, i / 3);
+		bfs_check(idmap_get(&map, i % 3, i / 3));
+		idmap_unref(&map, i % 3, i / 3);
+		bfs_check(!idmap_get(&map, i % 3, i / 3));
+	}
+	bfs_check(map.size == n / 2);
+
+	for (size_t i = 1; i < n; i += 2) {
+		const struct idmap_entry *entry = idmap_get(&map, i % 3, i / 3);
+		if (bfs_check(entry)) {
+			bfs_check(entry->refs == 2 && entry->ptr == &map);
+		}
+	}
+
+	// Unknown files are ignored
+	idmap_unref(&map, 3, 0);
+	bfs_check(map.size == n / 2);
+
+	idmap_destroy(&map);
+}
@@ -8,7 +8,9 @@
 #include "ioq.h"
 
 #include <fcntl.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 /**
  * Test for blocking within ioq_slot_push().
@@ -71,6 +73,47 @@ static void check_ioq_push_block(void) {
 	ioq_destroy(ioq);
 }
 
+/** Test ioq_read(), including short reads at EOF. */
+static void check_ioq_read(void) {
+	static const char data[] = "0123456789abcdef";
+	const size_t len = sizeof(data) - 1;
+
+	FILE *file = tmpfile();
+	bfs_everify(file, "tmpfile()");
+	bfs_everify(fwrite(data, 1, len, file) == len, "fwrite()");
+	bfs_everify(fflush(file) == 0, "fflush()");
+	int fd = fileno(file);
+
+	struct ioq *ioq = ioq_create(4, 2);
+	bfs_everify(ioq, "ioq_create()");
+
+	// Read the file in chunks, with the last one running past EOF
+	char bufs[3][8];
+	for (size_t i = 0; i < countof(bufs); ++i) {
+		int ret = ioq_read(ioq, fd, bufs[i], sizeof(bufs[i]), 6 * i, bufs[i]);
+		bfs_everify(ret == 0, "ioq_read()");
+	}
+	ioq_submit(ioq);
+
+	for (size_t i = 0; i < countof(bufs); ++i) {
+		struct ioq_ent *ent = ioq_pop(ioq, true);
+		bfs_verify(ent && ent->op == IOQ_READ);
+
+		size_t j = (char (*)[8])ent->ptr - bufs;
+		size_t offset = 6 * j;
+		size_t expected = len - offset < 8 ? len - offset : 8;
+		bfs_check(ent->result == (int)expected, "%d != %zu", ent->result, expected);
+		bfs_check(memcmp(bufs[j], data + offset, expected) == 0);
+
+		ioq_free(ioq, ent);
+	}
+	bfs_verify(!ioq_pop(ioq, true));
+
+	ioq_destroy(ioq);
+	fclose(file);
+}
+
 void check_ioq(void) {
 	check_ioq_push_block();
+	check_ioq_read();
 }
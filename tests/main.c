@@ -259,9 +259,13 @@ int main(int argc, char *argv[]) {
 	run_test(&ctx, "alloc", check_alloc);
 	run_test(&ctx, "bfstd", check_bfstd);
 	run_test(&ctx, "bit", check_bit);
+	run_test(&ctx, "idmap", check_idmap);
+	run_test(&ctx, "idset", check_idset);
 	run_test(&ctx, "ioq", check_ioq);
 	run_test(&ctx, "list", check_list);
+	run_test(&ctx, "outq", check_outq);
 	run_test(&ctx, "sighook", check_sighook);
+	run_test(&ctx, "sort", check_sort);
 	run_test(&ctx, "trie", check_trie);
 	run_test(&ctx, "xspawn", check_xspawn);
 	run_test(&ctx, "xtime", check_xtime);
@@ -0,0 +1,83 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+#include "tests.h"
+
+#include "bfstd.h"
+#include "diag.h"
+#include "outq.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+
+/** Check that data comes out in order, through a tiny ring. */
+static void check_outq_order(void) {
+	int fds[2];
+	if (!bfs_echeck(pipe(fds) == 0)) {
+		return;
+	}
+
+	// Smaller than the writes, so they wrap around and block
+	struct outq *outq = outq_create(fds[1], 13);
+	if (!bfs_echeck(outq, "outq_create()")) {
+		goto done;
+	}
+
+	// Less than the capacity of a pipe, so we can read it afterwards
+	char buf[4096];
+	for (size_t i = 0; i < sizeof(buf); ++i) {
+		buf[i] = i % 251;
+	}
+
+	for (size_t i = 0, len = 1; i < sizeof(buf); i += len, ++len) {
+		if (len > sizeof(buf) - i) {
+			len = sizeof(buf) - i;
+		}
+		bfs_echeck(outq_write(outq, buf + i, len) == 0);
+	}
+
+	bfs_echeck(outq_drain(outq) == 0);
+	bfs_echeck(outq_destroy(outq) == 0);
+
+	char out[sizeof(buf)];
+	bfs_echeck(xread(fds[0], out, sizeof(out)) == sizeof(out));
+	bfs_check(memcmp(buf, out, sizeof(buf)) == 0);
+
+done:
+	xclose(fds[1]);
+	xclose(fds[0]);
+}
+
+/** Check that write errors are reported. */
+static void check_outq_error(void) {
+	int fd = open("/dev/full", O_WRONLY | O_CLOEXEC);
+	if (fd < 0) {
+		// Not every platform has /dev/full
+		return;
+	}
+
+	struct outq *outq = outq_create(fd, 64);
+	if (!bfs_echeck(outq, "outq_create()")) {
+		goto done;
+	}
+
+	bfs_echeck(outq_write(outq, "Hello world!", 12) == 0);
+	bfs_check(outq_drain(outq) == -1 && errno == ENOSPC);
+
+	// The error should only be reported once
+	bfs_echeck(outq_drain(outq) == 0);
+
+	bfs_echeck(outq_write(outq, "Goodbye!", 8) == 0);
+	bfs_check(outq_destroy(outq) == -1 && errno == ENOSPC);
+
+done:
+	xclose(fd);
+}
+
+void check_outq(void) {
+	check_outq_order();
+	check_outq_error();
+}
@@ -0,0 +1,278 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+/**
+ * A reader for the output of -fprintbin, which prints each record as a line of
+ * text.  See src/printbin.h for a description of the format.
+ */
+
+#include "bfstd.h"
+#include "bit.h"
+#include "dstring.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** A field from the header. */
+struct field {
+	/** The field type. */
+	char type;
+	/** The field name. */
+	const char *name;
+};
+
+/** A position in the input. */
+struct cursor {
+	/** The current byte. */
+	const char *ptr;
+	/** The end of the input. */
+	const char *end;
+};
+
+/** Read some bytes. */
+static const char *read_bytes(struct cursor *cur, size_t len) {
+	if ((size_t)(cur->end - cur->ptr) < len) {
+		return NULL;
+	}
+
+	const char *ret = cur->ptr;
+	cur->ptr += len;
+	return ret;
+}
+
+/** Read a varint. */
+static bool read_uint(struct cursor *cur, uintmax_t *n) {
+	*n = 0;
+	for (int shift = 0; shift < UINTMAX_WIDTH; shift += 7) {
+		const char *byte = read_bytes(cur, 1);
+		if (!byte) {
+			return false;
+		}
+
+		unsigned char c = *byte;
+		*n |= (uintmax_t)(c & 0x7F) << shift;
+		if (!(c & 0x80)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/** Read a length-prefixed string. */
+static const char *read_str(struct cursor *cur, size_t *len) {
+	uintmax_t n;
+	if (!read_uint(cur, &n) || n > SIZE_MAX) {
+		return NULL;
+	}
+
+	*len = n;
+	return read_bytes(cur, n);
+}
+
+/** Read a whole file into memory. */
+static dchar *read_file(const char *path) {
+	FILE *file = fopen(path, "rb");
+	if (!file) {
+		return NULL;
+	}
+
+	dchar *ret = dstralloc(0);
+	if (!ret) {
+		goto fail;
+	}
+
+	char buf[4096];
+	size_t len;
+	while ((len = fread(buf, 1, sizeof(buf), file)) > 0) {
+		if (dstrxcat(&ret, buf, len) != 0) {
+			goto fail;
+		}
+	}
+
+	if (ferror(file)) {
+		errno = EIO;
+		goto fail;
+	}
+
+	fclose(file);
+	return ret;
+
+fail:
+	dstrfree(ret);
+	fclose(file);
+	return NULL;
+}
+
+/** Parse the header. */
+static size_t read_header(struct cursor *cur, struct field *fields, size_t max) {
+	const char *magic = read_bytes(cur, 6);
+	if (!magic || memcmp(magic, "bfsbin", 6) != 0) {
+		return 0;
+	}
+
+	const char *bytes = read_bytes(cur, 2);
+	if (!bytes || bytes[0] != 1) {
+		return 0;
+	}
+
+	size_t nfields = (unsigned char)bytes[1];
+	if (nfields == 0 || nfields > max) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < nfields; ++i) {
+		const char *type = read_bytes(cur, 1);
+		if (!type) {
+			return 0;
+		}
+		fields[i].type = *type;
+
+		const char *nul = memchr(cur->ptr, '\0', cur->end - cur->ptr);
+		if (!nul) {
+			return 0;
+		}
+		fields[i].name = cur->ptr;
+		cur->ptr = nul + 1;
+	}
+
+	return nfields;
+}
+
+/** Print a single field. */
+static bool print_field(struct cursor *cur, const struct field *field) {
+	uintmax_t n;
+	intmax_t sec;
+	const char *str;
+	size_t len;
+
+	printf(" %s=", field->name);
+
+	switch (field->type) {
+	case 'u':
+		if (!read_uint(cur, &n)) {
+			return false;
+		}
+		// Match the octal output of -printf %m
+		printf(strcmp(field->name, "mode") == 0 ? "%jo" : "%ju", n);
+		return true;
+
+	case 't':
+		if (!read_uint(cur, &n)) {
+			return false;
+		}
+		sec = (n & 1) ? -(intmax_t)(n >> 1) - 1 : (intmax_t)(n >> 1);
+		if (!read_uint(cur, &n)) {
+			return false;
+		}
+		printf("%jd.%09ju", sec, n);
+		return true;
+
+	case 's':
+		str = read_str(cur, &len);
+		if (!str) {
+			return false;
+		}
+		fwrite(str, 1, len, stdout);
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+/** Print all the records. */
+static bool print_records(struct cursor *cur, const struct field *fields, size_t nfields, dchar **path) {
+	while (cur->ptr < cur->end) {
+		uintmax_t n;
+		if (!read_uint(cur, &n) || n > SIZE_MAX) {
+			return false;
+		}
+
+		const char *start = read_bytes(cur, n);
+		if (!start) {
+			return false;
+		}
+		struct cursor record = {start, start + n};
+
+		const char *type = read_bytes(&record, 1);
+		uintmax_t depth, shared, mask;
+		if (!type || !read_uint(&record, &depth) || !read_uint(&record, &shared)) {
+			return false;
+		}
+
+		size_t len;
+		const char *suffix = read_str(&record, &len);
+		if (!suffix || shared > dstrlen(*path)) {
+			return false;
+		}
+
+		dstrshrink(*path, shared);
+		if (dstrxcat(path, suffix, len) != 0) {
+			return false;
+		}
+
+		if (!read_uint(&record, &mask) || (nfields < UINTMAX_WIDTH && mask >> nfields)) {
+			return false;
+		}
+
+		fwrite(*path, 1, dstrlen(*path), stdout);
+		printf(" type=%c depth=%ju", *type, depth);
+
+		for (size_t i = 0; i < nfields; ++i) {
+			if ((mask & (UINTMAX_C(1) << i)) && !print_field(&record, &fields[i])) {
+				return false;
+			}
+		}
+
+		putchar('\n');
+	}
+
+	return true;
+}
+
+int main(int argc, char *argv[]) {
+	const char *cmd = argc > 0 ? argv[0] : "readbin";
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s FILE\n", cmd);
+		return EXIT_FAILURE;
+	}
+
+	const char *path = argv[1];
+	dchar *data = read_file(path);
+	if (!data) {
+		fprintf(stderr, "%s: '%s': %s.\n", cmd, path, xstrerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	int ret = EXIT_FAILURE;
+	struct cursor cur = {data, data + dstrlen(data)};
+
+	struct field fields[UINTMAX_WIDTH];
+	size_t nfields = read_header(&cur, fields, countof(fields));
+	if (nfields == 0) {
+		fprintf(stderr, "%s: '%s': Invalid header.\n", cmd, path);
+		goto done;
+	}
+
+	dchar *prev = dstralloc(0);
+	if (!prev) {
+		fprintf(stderr, "%s: %s.\n", cmd, xstrerror(errno));
+		goto done;
+	}
+
+	if (print_records(&cur, fields, nfields, &prev)) {
+		ret = EXIT_SUCCESS;
+	} else {
+		fprintf(stderr, "%s: '%s': Invalid record.\n", cmd, path);
+	}
+
+	dstrfree(prev);
+done:
+	dstrfree(data);
+	return ret;
+}
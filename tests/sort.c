@@ -0,0 +1,101 @@
+// Copyright © Tavian Barnes <tavianator@tavianator.com>
+// SPDX-License-Identifier: 0BSD
+
+#include "tests.h"
+
+#include "bfstd.h"
+#include "bftw.h"
+#include "color.h"
+#include "ctx.h"
+#include "diag.h"
+#include "eval.h"
+#include "expr.h"
+#include "sort.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/** The number of files to sort. */
+#define NFILES 1000
+
+/** The depth of each file, so the output isn't just in path order. */
+static size_t file_depth(size_t i) {
+	return i % 7;
+}
+
+/** Sort some files by depth with the given budget, and check the output. */
+static void check_sort_budget(int threads, size_t budget) {
+	struct bfs_ctx *ctx = bfs_ctx_new();
+	bfs_everify(ctx, "bfs_ctx_new()");
+	ctx->threads = threads;
+
+	struct bfs_expr *expr = bfs_expr_new(ctx, eval_sort_by, 0, NULL, BFS_ACTION);
+	bfs_everify(expr, "bfs_expr_new()");
+	bfs_everify(bfs_sort_parse(ctx, expr, "depth") == 0);
+
+	struct bfs_sort *sort = expr->sort;
+	bfs_sort_set_budget(sort, budget);
+
+	// Add the files in a scrambled order
+	for (size_t k = 0; k < NFILES; ++k) {
+		size_t i = (k * 389) % NFILES;
+		char path[16];
+		snprintf(path, sizeof(path), "%03zu", i);
+
+		struct BFTW ftwbuf = {
+			.path = path,
+			.depth = file_depth(i),
+		};
+		bfs_echeck(bfs_sort_add(sort, &ftwbuf, NULL) == 0);
+	}
+
+	// Print to a separate stream, so closing it frees its buffer
+	FILE *file = tmpfile();
+	bfs_everify(file, "tmpfile()");
+	FILE *out = fdopen(dup_cloexec(fileno(file)), "w");
+	bfs_everify(out, "fdopen()");
+	CFILE *cfile = cfwrap(out, NULL, true);
+	bfs_everify(cfile, "cfwrap()");
+	bfs_echeck(bfs_sort_print(sort, cfile) == 0);
+	bfs_echeck(cfclose(cfile) == 0);
+
+	// Files should come out by depth, then by path
+	rewind(file);
+	for (size_t depth = 0; depth < 7; ++depth) {
+		for (size_t i = 0; i < NFILES; ++i) {
+			if (file_depth(i) != depth) {
+				continue;
+			}
+
+			char expected[16], line[16];
+			snprintf(expected, sizeof(expected), "%03zu\n", i);
+			if (!bfs_check(fgets(line, sizeof(line), file), "Output ended early (-j%d, budget %zu)", threads, budget)) {
+				goto done;
+			}
+			if (!bfs_check(strcmp(line, expected) == 0, "Expected %s, got %s (-j%d, budget %zu)", expected, line, threads, budget)) {
+				goto done;
+			}
+		}
+	}
+
+	char line[16];
+	bfs_check(!fgets(line, sizeof(line), file));
+
+done:
+	fclose(file);
+	bfs_ctx_free(ctx);
+}
+
+void check_sort(void) {
+	// Spill runs on the main thread, then in the background
+	for (int threads = 1; threads <= 2; ++threads) {
+		// Everything in memory
+		check_sort_budget(threads, SIZE_MAX);
+		// A few runs, merged at the end
+		check_sort_budget(threads, 16 << 10);
+		// One run per file, enough to collapse the runs many times
+		check_sort_budget(threads, 1);
+	}
+}
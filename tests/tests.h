@@ -21,15 +21,27 @@ void check_bfstd(void);
 /** Bit manipulation tests. */
 void check_bit(void);
 
+/** File identity map tests. */
+void check_idmap(void);
+
+/** File identity set tests. */
+void check_idset(void);
+
 /** I/O queue tests. */
 void check_ioq(void);
 
 /** Linked list tests. */
 void check_list(void);
 
+/** Output queue tests. */
+void check_outq(void);
+
 /** Signal hook tests. */
 void check_sighook(void);
 
+/** External sorting tests. */
+void check_sort(void);
+
 /** Trie tests. */
 void check_trie(void);
 
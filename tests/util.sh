@@ -17,6 +17,7 @@ TESTS="$ROOT/tests"
 BIN="$ROOT/bin"
 MKSOCK="$BIN/tests/mksock"
 PTYX="$BIN/tests/ptyx"
+READBIN="$BIN/tests/readbin"
 XTOUCH="$BIN/tests/xtouch"
 UNAME=$(uname)
 
@@ -10,6 +10,7 @@
 #include <errno.h>
 #include <limits.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <time.h>
 
 static bool tm_equal(const struct tm *tma, const struct tm *tmb) {
@@ -180,8 +181,82 @@ static void check_xtimegm(void) {
 #endif // !BFS_HAS_TIMEGM
 }
 
+/** Check one xlocaltime() result. */
+static bool check_one_xlocaltime(time_t time) {
+	struct tm expected, actual;
+	if (!localtime_r(&time, &expected)) {
+		bfs_ediag("localtime_r(%jd)", (intmax_t)time);
+		return false;
+	}
+
+	bool ret = bfs_echeck(xlocaltime(&time, &actual), "xlocaltime(%jd)", (intmax_t)time)
+		&& bfs_check(tm_equal(&actual, &expected), "xlocaltime(%jd)", (intmax_t)time);
+	if (!ret) {
+		bfs_diag("localtime_r(): " TM_FORMAT, TM_PRINTF(expected));
+		bfs_diag("xlocaltime():  " TM_FORMAT, TM_PRINTF(actual));
+	}
+	return ret;
+}
+
+/** xlocaltime() tests. */
+static void check_xlocaltime(void) {
+	// Forwards and backwards across a minute boundary
+	for (time_t time = 692705400 - 90; time <= 692705400 + 90; ++time) {
+		check_one_xlocaltime(time);
+	}
+	for (time_t time = 692705400 + 90; time >= 692705400 - 90; --time) {
+		check_one_xlocaltime(time);
+	}
+
+	// Across DST transitions, including an odd offset
+	const char *tz = getenv("TZ");
+	if (!bfs_echeck(setenv("TZ", "EST5EDT,M3.2.0,M11.1.0", true) == 0)) {
+		return;
+	}
+	tzset();
+
+	// 2024-03-10T07:00:00Z and 2024-11-03T06:00:00Z
+	for (time_t time = 1710053880; time <= 1710054120; time += 7) {
+		check_one_xlocaltime(time);
+	}
+	for (time_t time = 1730613720; time <= 1730613960; time += 7) {
+		check_one_xlocaltime(time);
+	}
+
+	bfs_echeck(setenv("TZ", "<+0530>-5:30", true) == 0);
+	tzset();
+	for (time_t time = 692705400 - 90; time <= 692705400 + 90; time += 11) {
+		check_one_xlocaltime(time);
+	}
+
+	// Changing the time zone invalidates the cache, even in the same minute
+	check_one_xlocaltime(692705400);
+	bfs_echeck(setenv("TZ", "UTC0", true) == 0);
+	tzset();
+	check_one_xlocaltime(692705401);
+	bfs_echeck(setenv("TZ", "<+0530>-5:30", true) == 0);
+	tzset();
+	check_one_xlocaltime(692705402);
+
+	// Same names, different offset
+	bfs_echeck(setenv("TZ", "<ABC>5", true) == 0);
+	tzset();
+	check_one_xlocaltime(692705403);
+	bfs_echeck(setenv("TZ", "<ABC>3", true) == 0);
+	tzset();
+	check_one_xlocaltime(692705404);
+
+	if (tz) {
+		bfs_echeck(setenv("TZ", tz, true) == 0);
+	} else {
+		bfs_echeck(unsetenv("TZ") == 0);
+	}
+	tzset();
+}
+
 void check_xtime(void) {
 	check_xgetdate();
 	check_xmktime();
 	check_xtimegm();
+	check_xlocaltime();
 }